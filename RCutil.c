@@ -29,13 +29,85 @@ double getcap(double sp_heat, double thickness, double area)
 	return C_FACTOR * sp_heat * thickness * area;
 }
 
+/* 
+ * Cholesky decomposition a = l * l^T of a symmetric positive 
+ * definite matrix. l is stored in-place in the lower triangle
+ * of 'a' (the upper triangle is left untouched). it is blocked
+ * (right-looking) for cache friendliness: a CHOL_BLOCK wide 
+ * column panel is factored and the trailing lower triangle is 
+ * then updated with it in one sweep. since 'a' is row-major, 
+ * all the inner loops are dot products of contiguous row 
+ * segments. it needs half the flops of the LUP decomposition 
+ * and no pivoting
+ */
+#define CHOL_BLOCK	32
+void choldcmp(double **a, int n)
+{
+	int i, j, k, k0, k1;
+	double sum;
+
+	for (k0 = 0; k0 < n; k0 += CHOL_BLOCK) {
+		k1 = MIN(k0 + CHOL_BLOCK, n);
+
+		/* factor the diagonal block and the panel below it	*/
+		for (j = k0; j < k1; j++) {
+			for (k = k0, sum = a[j][j]; k < j; k++)
+				sum -= a[j][k] * a[j][k];
+			if (sum <= 0)
+				fatal("matrix not positive definite in choldcmp\n");
+			a[j][j] = sqrt(sum);
+			for (i = j+1; i < n; i++) {
+				for (k = k0, sum = a[i][j]; k < j; k++)
+					sum -= a[i][k] * a[j][k];
+				a[i][j] = sum / a[j][j];
+			}
+		}
+
+		/* update the trailing lower triangle with the panel	*/
+		for (i = k1; i < n; i++)
+			for (j = k1; j <= i; j++) {
+				for (k = k0, sum = 0; k < k1; k++)
+					sum += a[i][k] * a[j][k];
+				a[i][j] -= sum;
+			}
+	}
+}
+
+/* 
+ * solves ax = b where 'a' holds the Cholesky factor l in
+ * its lower triangle. ly = b and l^T x = y are solved in 
+ * place in x. the backward substitution is column-oriented 
+ * so that it walks the rows of l contiguously
+ */
+void cholsolve(double **a, int n, double *b, double *x)
+{
+	int i, j;
+	double sum;
+
+	/* forward substitution - solves ly = b	*/
+	for (i = 0; i < n; i++) {
+		for (j = 0, sum = b[i]; j < i; j++)
+			sum -= a[i][j] * x[j];
+		x[i] = sum / a[i][i];
+	}
+
+	/* backward substitution - solves l^T x = y	*/
+	for (i = n-1; i >= 0; i--) {
+		x[i] /= a[i][i];
+		for (j = 0; j < i; j++)
+			x[j] -= a[i][j] * x[i];
+	}
+}
+
 /*
  * LUP decomposition from the pseudocode given in the CLR 
  * 'Introduction to Algorithms' textbook. The matrix 'a' is
  * transformed into an in-place lower/upper triangular matrix
  * and the vector'p' carries the permutation vector such that
  * Pa = lu, where 'P' is the matrix form of 'p'. The 'spd' flag 
- * indicates that 'a' is symmetric and positive definite 
+ * indicates that 'a' is symmetric and positive definite. In
+ * that case, the Cholesky decomposition is computed instead
+ * and 'p' is just the identity permutation
  */
  
 void lupdcmp(double**a, int n, int *p, int spd)
@@ -79,6 +151,11 @@ void lupdcmp(double**a, int n, int *p, int spd)
 	for (i=0; i < n; i++)
 		p[i] = i;
 
+	if (spd) {
+		choldcmp(a, n);
+		return;
+	}
+
 	for (k=0; k < n-1; k++)	 {
 		max = 0;
 		for (i = k; i < n; i++)	{
@@ -117,7 +194,8 @@ void lupdcmp(double**a, int n, int *p, int spd)
  * in the CLR 'Introduction to Algorithms' textbook. It solves ax = b
  * where, 'a' is an in-place lower/upper triangular matrix. The vector
  * 'x' carries the solution vector. 'p' is the permutation vector. The
- * 'spd' flag indicates that 'a' is symmetric and positive definite
+ * 'spd' flag indicates that 'a' is symmetric and positive definite,
+ * i.e., that it holds the Cholesky factor computed by lupdcmp
  */
 
 void lusolve(double **a, int n, int *p, double *b, double *x, int spd)
@@ -160,9 +238,16 @@ void lusolve(double **a, int n, int *p, double *b, double *x, int spd)
 	assert(info == 0);	
 	#else
 	int i, j;
-	double *y = dvector (n);
+	double *y;
 	double sum;
 
+	if (spd) {
+		cholsolve(a, n, b, x);
+		return;
+	}
+
+	y = dvector (n);
+
 	/* forward substitution	- solves ly = pb	*/
 	for (i=0; i < n; i++) {
 		for (j=0, sum=0; j < i; j++)
@@ -181,6 +266,241 @@ void lusolve(double **a, int n, int *p, double *b, double *x, int spd)
 	#endif
 }
 
+/* 
+ * solves ax = b for 'nrhs' right hand sides at once. b and x are
+ * nrhs x n matrices with one right hand side / solution per row.
+ * 'a', 'p' and 'spd' are as in lusolve. with the math acceleration,
+ * the whole batch goes to LAPACK in one call. otherwise, the right
+ * hand sides are solved LUSOLVE_BATCH at a time. each such chunk
+ * is transposed into a scratch matrix so that every element of
+ * the triangular factors is loaded once per chunk and applied 
+ * to a contiguous row of LUSOLVE_BATCH values. the factors are
+ * walked in LUSOLVE_TILE square tiles so that the rows of the 
+ * scratch matrix they touch stay in the cache
+ */
+#define LUSOLVE_BATCH	16
+#define LUSOLVE_TILE	64
+void lusolve_batch(double **a, int n, int *p, double **b, double **x, int nrhs, int spd)
+{
+	#if(MATHACCEL == MA_INTEL || MATHACCEL == MA_AMD || MATHACCEL == MA_APPLE || MATHACCEL == MA_SUN)
+	int i, j, info = 0;
+	/* LAPACK needs the solutions contiguous	*/
+	double **y = dmatrix(nrhs, n);
+	for (i = 0; i < nrhs; i++)
+		for (j = 0; j < n; j++)
+			y[i][j] = b[i][j];
+	#if(MATHACCEL == MA_INTEL)
+	if (!spd)
+		dgetrs("T", &n, &nrhs, a[0], &n, p, y[0], &n, &info);
+	else	
+		dpotrs("U", &n, &nrhs, a[0], &n, y[0], &n, &info);
+	#elif(MATHACCEL == MA_AMD)
+	if (!spd)
+		dgetrs_("T", &n, &nrhs, a[0], &n, p, y[0], &n, &info, 1);
+	else	
+		dpotrs_("U", &n, &nrhs, a[0], &n, y[0], &n, &info, 1);
+	#elif(MATHACCEL == MA_APPLE)
+	if (!spd)
+		dgetrs_("T", (__CLPK_integer *)&n, (__CLPK_integer *)&nrhs, a[0],
+				(__CLPK_integer *)&n, (__CLPK_integer *)p, y[0],
+				(__CLPK_integer *)&n, (__CLPK_integer *)&info);
+	else	
+		dpotrs_("U", (__CLPK_integer *)&n, (__CLPK_integer *)&nrhs, a[0],
+				(__CLPK_integer *)&n, y[0], (__CLPK_integer *)&n,
+				(__CLPK_integer *)&info);
+	#else
+	if (!spd)
+		dgetrs_("T", &n, &nrhs, a[0], &n, p, y[0], &n, &info);
+	else	
+		dpotrs_("U", &n, &nrhs, a[0], &n, y[0], &n, &info);
+	#endif
+	assert(info == 0);	
+	for (i = 0; i < nrhs; i++)
+		for (j = 0; j < n; j++)
+			x[i][j] = y[i][j];
+	free_dmatrix(y);
+	#else
+	int i, j, r, i0, i1, j0, j1, r0, nb;
+	double **y, l;
+	/* 
+	 * local copies of the row being solved. they cannot alias
+	 * the rows of y. so, the compiler vectorizes the loops over
+	 * the LUSOLVE_BATCH values
+	 */
+	double acc[LUSOLVE_BATCH], yi[LUSOLVE_BATCH];
+
+	y = dmatrix(n, LUSOLVE_BATCH);
+
+	for (r0 = 0; r0 < nrhs; r0 += LUSOLVE_BATCH) {
+		nb = MIN(LUSOLVE_BATCH, nrhs - r0);
+
+		/* 
+		 * y = transpose of this chunk of b (permuted for LUP).
+		 * the columns of a partial chunk are zero padded so that
+		 * the innermost loops always run over LUSOLVE_BATCH values
+		 */
+		for (i = 0; i < n; i++)
+			for (r = 0; r < LUSOLVE_BATCH; r++)
+				y[i][r] = (r < nb) ? b[r0+r][spd ? i : p[i]] : 0;
+
+		/* 
+		 * forward substitution - solves ly = pb (ly = b for spd).
+		 * one LUSOLVE_TILE row block at a time. the off-diagonal 
+		 * tiles to its left are applied first and then the 
+		 * diagonal tile is solved
+		 */
+		for (i0 = 0; i0 < n; i0 += LUSOLVE_TILE) {
+			i1 = MIN(i0 + LUSOLVE_TILE, n);
+			for (j0 = 0; j0 < i0; j0 += LUSOLVE_TILE) {
+				j1 = j0 + LUSOLVE_TILE;
+				for (i = i0; i < i1; i++) {
+					for (r = 0; r < LUSOLVE_BATCH; r++)
+						acc[r] = y[i][r];
+					for (j = j0; j < j1; j++) {
+						l = a[i][j];
+						for (r = 0; r < LUSOLVE_BATCH; r++)
+							acc[r] -= l * y[j][r];
+					}
+					for (r = 0; r < LUSOLVE_BATCH; r++)
+						y[i][r] = acc[r];
+				}
+			}
+			for (i = i0; i < i1; i++) {
+				for (r = 0; r < LUSOLVE_BATCH; r++)
+					acc[r] = y[i][r];
+				for (j = i0; j < i; j++) {
+					l = a[i][j];
+					for (r = 0; r < LUSOLVE_BATCH; r++)
+						acc[r] -= l * y[j][r];
+				}
+				/* l has a unit diagonal in the LUP case	*/
+				l = spd ? 1.0 / a[i][i] : 1.0;
+				for (r = 0; r < LUSOLVE_BATCH; r++)
+					y[i][r] = acc[r] * l;
+			}
+		}
+
+		/* backward substitution - one row block at a time, bottom up	*/
+		for (i1 = n; i1 > 0; i1 = i0) {
+			i0 = ((i1 - 1) / LUSOLVE_TILE) * LUSOLVE_TILE;
+			if (spd) {
+				/* 
+				 * solves l^T x = y. column-oriented: the diagonal
+				 * tile is solved first and the solved rows are then
+				 * eliminated from the tiles above
+				 */
+				for (i = i1-1; i >= i0; i--) {
+					l = 1.0 / a[i][i];
+					for (r = 0; r < LUSOLVE_BATCH; r++)
+						y[i][r] = yi[r] = y[i][r] * l;
+					for (j = i0; j < i; j++) {
+						l = a[i][j];
+						for (r = 0; r < LUSOLVE_BATCH; r++)
+							y[j][r] -= l * yi[r];
+					}
+				}
+				for (j0 = 0; j0 < i0; j0 += LUSOLVE_TILE) {
+					j1 = j0 + LUSOLVE_TILE;
+					for (j = j0; j < j1; j++) {
+						for (r = 0; r < LUSOLVE_BATCH; r++)
+							acc[r] = y[j][r];
+						for (i = i0; i < i1; i++) {
+							l = a[i][j];
+							for (r = 0; r < LUSOLVE_BATCH; r++)
+								acc[r] -= l * y[i][r];
+						}
+						for (r = 0; r < LUSOLVE_BATCH; r++)
+							y[j][r] = acc[r];
+					}
+				}
+			} else {
+				/* 
+				 * solves ux = y. the solved tiles to the right are
+				 * applied first and then the diagonal tile is solved
+				 */
+				for (j0 = i1; j0 < n; j0 += LUSOLVE_TILE) {
+					j1 = MIN(j0 + LUSOLVE_TILE, n);
+					for (i = i0; i < i1; i++) {
+						for (r = 0; r < LUSOLVE_BATCH; r++)
+							acc[r] = y[i][r];
+						for (j = j0; j < j1; j++) {
+							l = a[i][j];
+							for (r = 0; r < LUSOLVE_BATCH; r++)
+								acc[r] -= l * y[j][r];
+						}
+						for (r = 0; r < LUSOLVE_BATCH; r++)
+							y[i][r] = acc[r];
+					}
+				}
+				for (i = i1-1; i >= i0; i--) {
+					for (r = 0; r < LUSOLVE_BATCH; r++)
+						acc[r] = y[i][r];
+					for (j = i+1; j < i1; j++) {
+						l = a[i][j];
+						for (r = 0; r < LUSOLVE_BATCH; r++)
+							acc[r] -= l * y[j][r];
+					}
+					l = 1.0 / a[i][i];
+					for (r = 0; r < LUSOLVE_BATCH; r++)
+						y[i][r] = acc[r] * l;
+				}
+			}
+		}
+
+		/* transpose back	*/
+		for (r = 0; r < nb; r++)
+			for (i = 0; i < n; i++)
+				x[r0+r][i] = y[i][r];
+	}
+
+	free_dmatrix(y);
+	#endif
+}
+
+/* 
+ * allocate the scratch vectors needed by rk4 for a system
+ * of up to 'n' equations. the thermal models own one of
+ * these so that the transient solver does not have to
+ * allocate any memory
+ */
+rk4_workspace_t *alloc_rk4_workspace(int n)
+{
+	rk4_workspace_t *ws = (rk4_workspace_t *) calloc (1, sizeof(rk4_workspace_t));
+	if (!ws)
+		fatal("memory allocation error\n");
+	ws->n = n;
+	ws->k1 = dvector(n);
+	ws->k2 = dvector(n);
+	ws->k3 = dvector(n);
+	ws->k4 = dvector(n);
+	ws->t = dvector(n);
+	ws->t1 = dvector(n);
+	ws->t2 = dvector(n);
+	ws->ytemp = dvector(n);
+	ws->scratch = dvector(n);
+	return ws;
+}
+
+void free_rk4_workspace(rk4_workspace_t *ws)
+{
+	free_dvector(ws->k1);
+	free_dvector(ws->k2);
+	free_dvector(ws->k3);
+	free_dvector(ws->k4);
+	free_dvector(ws->t);
+	free_dvector(ws->t1);
+	free_dvector(ws->t2);
+	free_dvector(ws->ytemp);
+	free_dvector(ws->scratch);
+	free(ws);
+}
+
+/* the vector updates of rk4 are split among the threads of an
+ * OpenMP team only for vectors longer than this (MATHACCEL = none.
+ * the built-in vector kernels and the BLAS libraries do their own)
+ */
+#define RK4_PAR_SIZE	16384
+
 /* core of the 4th order Runge-Kutta method, where the Euler step
  * (y(n+1) = y(n) + h * k1 where k1 = dydx(n)) is provided as an input.
  * to evaluate dydx at different points, a call back function f (slope
@@ -189,15 +509,15 @@ void lusolve(double **a, int n, int *p, double *b, double *x, int spd)
  * the solution in yout. For details, see the discussion in "Numerical 
  * Recipes in C", Chapter 16, from 
  * http://www.nrbook.com/a/bookcpdf/c16-1.pdf
+ * the intermediate slopes are stored in the workspace 'ws'
  */
-void rk4_core(void *model, double *y, double *k1, void *p, int n, double h, double *yout, slope_fn_ptr f)
+void rk4_core(void *model, double *y, double *k1, void *p, int n, double h, double *yout, slope_fn_ptr f,
+			  rk4_workspace_t *ws)
 {
+	#if (MATHACCEL == MA_NONE)
 	int i;
-	double *t, *k2, *k3, *k4;
-	k2 = dvector(n);
-	k3 = dvector(n);
-	k4 = dvector(n);
-	t = dvector(n);
+	#endif
+	double *t = ws->t, *k2 = ws->k2, *k3 = ws->k3, *k4 = ws->k4;
 
 	/* k2 is the slope at the trial midpoint (t) found using 
 	 * slope k1 (which is at the starting point).
@@ -209,12 +529,17 @@ void rk4_core(void *model, double *y, double *k1, void *p, int n, double h, doub
 	#elif (MATHACCEL == MA_AMD || MATHACCEL == MA_SUN)
 	dcopy(n, y, 1, t, 1);
 	daxpy(n, h/2.0, k1, 1, t, 1);
+	#elif (MATHACCEL == MA_SIMD)
+	simd_axpy(t, y, h/2.0, k1, n);
 	#else
+	#ifdef _OPENMP
+	#pragma omp parallel for if (n >= RK4_PAR_SIZE)
+	#endif
 	for(i=0; i < n; i++)
 		t[i] = y[i] + h/2.0 * k1[i];
 	#endif	
 	/* k2 = slope at t */
-	(*f)(model, t, p, k2); 
+	(*f)(model, t, p, k2, ws); 
 
 	/* k3 is the slope at the trial midpoint (t) found using
 	 * slope k2 found above.
@@ -226,12 +551,17 @@ void rk4_core(void *model, double *y, double *k1, void *p, int n, double h, doub
 	#elif (MATHACCEL == MA_AMD || MATHACCEL == MA_SUN)
 	dcopy(n, y, 1, t, 1);
 	daxpy(n, h/2.0, k2, 1, t, 1);
+	#elif (MATHACCEL == MA_SIMD)
+	simd_axpy(t, y, h/2.0, k2, n);
 	#else
+	#ifdef _OPENMP
+	#pragma omp parallel for if (n >= RK4_PAR_SIZE)
+	#endif
 	for(i=0; i < n; i++)
 		t[i] = y[i] + h/2.0 * k2[i];
 	#endif	
 	/* k3 = slope at t */
-	(*f)(model, t, p, k3);
+	(*f)(model, t, p, k3, ws);
 
 	/* k4 is the slope at trial endpoint (t) found using
 	 * slope k3 found above.
@@ -243,12 +573,17 @@ void rk4_core(void *model, double *y, double *k1, void *p, int n, double h, doub
 	#elif (MATHACCEL == MA_AMD || MATHACCEL == MA_SUN)
 	dcopy(n, y, 1, t, 1);
 	daxpy(n, h, k3, 1, t, 1);
+	#elif (MATHACCEL == MA_SIMD)
+	simd_axpy(t, y, h, k3, n);
 	#else
+	#ifdef _OPENMP
+	#pragma omp parallel for if (n >= RK4_PAR_SIZE)
+	#endif
 	for(i=0; i < n; i++)
 		t[i] = y[i] + h * k3[i];
 	#endif	
 	/* k4 = slope at t */
-	(*f)(model, t, p, k4);
+	(*f)(model, t, p, k4, ws);
 
 	/* yout = y + h*(k1/6 + k2/3 + k3/3 + k4/6)	*/
 	#if (MATHACCEL == MA_INTEL || MATHACCEL == MA_APPLE)
@@ -272,15 +607,16 @@ void rk4_core(void *model, double *y, double *k1, void *p, int n, double h, doub
 	daxpy(n, h/3.0, k3, 1, yout, 1);
 	/* yout += h*k4/6	*/
 	daxpy(n, h/6.0, k4, 1, yout, 1);
+	#elif (MATHACCEL == MA_SIMD)
+	/* all in a single pass	*/
+	simd_rk4_combine(yout, y, k1, k2, k3, k4, h, n);
 	#else
+	#ifdef _OPENMP
+	#pragma omp parallel for if (n >= RK4_PAR_SIZE)
+	#endif
 	for (i =0; i < n; i++) 
 		yout[i] = y[i] + h * (k1[i] + 2*k2[i] + 2*k3[i] + k4[i])/6.0;
 	#endif
-
-	free_dvector(k2);
-	free_dvector(k3);
-	free_dvector(k4);
-	free_dvector(t);
 }
 
 /* 
@@ -288,40 +624,43 @@ void rk4_core(void *model, double *y, double *k1, void *p, int n, double h, doub
  * It integrates and solves the ODE dy + cy = p between
  * t and t+h. It returns the correct step size to be used 
  * next time. slope function f is the call back used to 
- * evaluate the derivative at each point
+ * evaluate the derivative at each point. all the scratch
+ * space comes from the preallocated workspace 'ws'
  */
 #define RK4_SAFETY		0.95
 #define RK4_MAXUP		5.0
 #define RK4_MAXDOWN		10.0
 #define RK4_PRECISION	0.01
-double rk4(void *model, double *y, void *p, int n, double *h, double *yout, slope_fn_ptr f)
+double rk4(void *model, double *y, void *p, int n, double *h, double *yout, slope_fn_ptr f,
+		   rk4_workspace_t *ws)
 {
+	#if (MATHACCEL == MA_NONE)
 	int i;
-	double *k1, *t1, *t2, *ytemp, max, new_h = (*h);
+	#endif
+	double *k1 = ws->k1, *t1 = ws->t1, *t2 = ws->t2, *ytemp = ws->ytemp;
+	double max, new_h = (*h);
 
-	k1 = dvector(n);
-	t1 = dvector(n);
-	t2 = dvector(n);
-	ytemp = dvector(n); 
+	if (n > ws->n)
+		fatal("rk4 workspace too small\n");
 
 	/* evaluate the slope k1 at the beginning */
-	(*f)(model, y, p, k1);
+	(*f)(model, y, p, k1, ws);
 
 	/* try until accuracy is achieved	*/
 	do {
 		(*h) = new_h;
 
 		/* try RK4 once with normal step size	*/
-		rk4_core(model, y, k1, p, n, (*h), ytemp, f);
+		rk4_core(model, y, k1, p, n, (*h), ytemp, f, ws);
 
 		/* repeat it with two half-steps	*/
-		rk4_core(model, y, k1, p, n, (*h)/2.0, t1, f);
+		rk4_core(model, y, k1, p, n, (*h)/2.0, t1, f, ws);
 
 		/* y after 1st half-step is in t1. re-evaluate k1 for this	*/
-		(*f)(model, t1, p, k1);
+		(*f)(model, t1, p, k1, ws);
 
 		/* get output of the second half-step in t2	*/	
-		rk4_core(model, t1, k1, p, n, (*h)/2.0, t2, f);
+		rk4_core(model, t1, k1, p, n, (*h)/2.0, t2, f, ws);
 
 		/* find the max diff between these two results:
 		 * use t1 to store the diff
@@ -344,10 +683,18 @@ double rk4(void *model, double *y, void *p, int n, double *h, double *yout, slop
 		 * indices start from 0
 		 */
 		max = fabs(t1[idamax(n, t1, 1)-1]);
+		#elif (MATHACCEL == MA_SIMD)
+		max = simd_max_abs_diff(ytemp, t2, n);
 		#else
+		#ifdef _OPENMP
+		#pragma omp parallel for if (n >= RK4_PAR_SIZE)
+		#endif
 		for(i=0; i < n; i++)
 			t1[i] = fabs(ytemp[i] - t2[i]);
 		max = t1[0];
+		#ifdef _OPENMP
+		#pragma omp parallel for if (n >= RK4_PAR_SIZE) reduction(max:max)
+		#endif
 		for(i=1; i < n; i++)
 			if (max < t1[i])
 				max = t1[i];
@@ -381,16 +728,190 @@ double rk4(void *model, double *y, void *p, int n, double *h, double *yout, slop
 	copy_dvector(yout, ytemp, n);
 	#endif
 
-	/* clean up */
-	free_dvector(k1);
-	free_dvector(t1);
-	free_dvector(t2);
-	free_dvector(ytemp);
-
 	/* return the step-size	*/
 	return new_h;
 }
 
+/* 
+ * one step of size h of an implicit (unconditionally stable) 
+ * integrator for the transient equation A dy + B y = p. all 
+ * of them are built out of backward Euler solves with a step
+ * size h' - f(model, y0, p, y1, h') solves (A/h' + B) y1 = 
+ * A/h' y0 + p. 'method' is one of
+ * TRANSIENT_BE:	backward Euler with h' = h (1st order, L-stable)
+ * TRANSIENT_CN:	Crank-Nicolson (trapezoidal, 2nd order). a 
+ * 					backward Euler half step extrapolated to
+ * 					the full step (h' = h/2)
+ * TRANSIENT_TRBDF2:TR-BDF2 (2nd order, L-stable). a trapezoidal 
+ * 					step to t + g*h followed by a BDF2 step to
+ * 					t + h. with g = 2 - sqrt(2), both stages
+ * 					have h' = g*h/2
+ * so, the model has to factor / set up (A/h' + B) only once per
+ * step size. y is updated in place. k1 and k2 of the workspace
+ * 'ws' are used as scratch
+ */
+void implicit_step(void *model, double *y, void *p, int n, double h, int method,
+				   implicit_fn_ptr f, rk4_workspace_t *ws)
+{
+	int i;
+	double *x = ws->k1, *z = ws->k2;
+	double g = 2.0 - sqrt(2.0);
+
+	switch (method) {
+		case TRANSIENT_BE:
+			(*f)(model, y, p, y, h);
+			break;
+		case TRANSIENT_CN:
+			(*f)(model, y, p, x, h / 2.0);
+			for (i = 0; i < n; i++)
+				y[i] = 2.0 * x[i] - y[i];
+			break;
+		case TRANSIENT_TRBDF2:
+			/* trapezoidal stage: z = y(t + g*h)	*/
+			(*f)(model, y, p, x, g * h / 2.0);
+			for (i = 0; i < n; i++)
+				z[i] = 2.0 * x[i] - y[i];
+			/* 
+			 * BDF2 stage: y(t+h) - (1-g)/(2-g) * h * dy(t+h) = 
+			 * (z - (1-g)^2 * y(t)) / (g * (2-g)). (1-g)/(2-g) = g/2
+			 */
+			for (i = 0; i < n; i++)
+				z[i] = (z[i] - (1.0 - g) * (1.0 - g) * y[i]) / (g * (2.0 - g));
+			(*f)(model, z, p, y, g * h / 2.0);
+			break;
+		default:
+			fatal("unknown implicit integration method\n");
+	}
+}
+
+/* 
+ * allocate the history needed by the Anderson accelerated 
+ * fixed point iteration of a map x = g(x) in 'n' unknowns,
+ * using up to 'm' previous iterates
+ */
+anderson_workspace_t *alloc_anderson_workspace(int n, int m)
+{
+	anderson_workspace_t *ws = (anderson_workspace_t *) calloc (1, sizeof(anderson_workspace_t));
+	if (!ws)
+		fatal("memory allocation error\n");
+	ws->n = n;
+	ws->m = m;
+	ws->k = 0;
+	ws->df = dmatrix(m, n);
+	ws->dg = dmatrix(m, n);
+	ws->f = dvector(n);
+	ws->f_old = dvector(n);
+	ws->g_old = dvector(n);
+	ws->ftf = dmatrix(m, m);
+	ws->p = ivector(m);
+	ws->ftr = dvector(m);
+	ws->gamma = dvector(m);
+	return ws;
+}
+
+void free_anderson_workspace(anderson_workspace_t *ws)
+{
+	free_dmatrix(ws->df);
+	free_dmatrix(ws->dg);
+	free_dvector(ws->f);
+	free_dvector(ws->f_old);
+	free_dvector(ws->g_old);
+	free_dmatrix(ws->ftf);
+	free_ivector(ws->p);
+	free_dvector(ws->ftr);
+	free_dvector(ws->gamma);
+	free(ws);
+}
+
+/* 
+ * one step of the Anderson accelerated fixed point iteration.
+ * given the current iterate x and g = g(x), x is replaced by
+ * the next iterate. instead of x = g as in the plain iteration,
+ * the next iterate is the combination of the last few g's whose
+ * residuals f = g - x combine to the least norm. i.e., with the
+ * differences of successive residuals DF and of successive
+ * g's DG, x = g - DG * gamma where gamma minimizes
+ * |f - DF * gamma|. the small least squares problem is solved 
+ * through its (slightly regularized) normal equations. returns
+ * the largest absolute residual max|g(x) - x|
+ */
+double anderson_step(anderson_workspace_t *ws, double *x, double *g)
+{
+	int i, j, l, mk;
+	double max = 0, diag;
+	int n = ws->n;
+	double *f = ws->f;
+
+	for (i = 0; i < n; i++) {
+		f[i] = g[i] - x[i];
+		if (fabs(f[i]) > max)
+			max = fabs(f[i]);
+	}
+
+	/* 
+	 * append the latest differences. the history is 
+	 * circular - row (k-1) % m is the most recent
+	 */
+	if (ws->k) {
+		l = (ws->k - 1) % ws->m;
+		for (i = 0; i < n; i++) {
+			ws->df[l][i] = f[i] - ws->f_old[i];
+			ws->dg[l][i] = g[i] - ws->g_old[i];
+		}
+	}
+	copy_dvector(ws->f_old, f, n);
+	copy_dvector(ws->g_old, g, n);
+	mk = MIN(ws->k, ws->m);
+	ws->k++;
+
+	/* first iterate - plain fixed point step	*/
+	if (!mk) {
+		copy_dvector(x, g, n);
+		return max;
+	}
+
+	/* 
+	 * normal equations: (DF^T DF) gamma = DF^T f. lupdcmp and 
+	 * lusolve need an mk x mk matrix with the row stride mk
+	 */
+	resize_dmatrix(ws->ftf, mk, mk);
+	diag = 0;
+	for (j = 0; j < mk; j++) {
+		for (l = 0; l <= j; l++) {
+			ws->ftf[j][l] = 0;
+			for (i = 0; i < n; i++)
+				ws->ftf[j][l] += ws->df[j][i] * ws->df[l][i];
+			ws->ftf[l][j] = ws->ftf[j][l];
+		}
+		ws->ftr[j] = 0;
+		for (i = 0; i < n; i++)
+			ws->ftr[j] += ws->df[j][i] * f[i];
+		diag = MAX(diag, ws->ftf[j][j]);
+	}
+	/* no change in the residuals - plain step	*/
+	if (diag == 0) {
+		copy_dvector(x, g, n);
+		return max;
+	}
+	/* 
+	 * successive residuals become nearly parallel close to
+	 * convergence. regularize to keep the system positive definite
+	 */
+	for (j = 0; j < mk; j++)
+		ws->ftf[j][j] += ANDERSON_REG * diag;
+	lupdcmp(ws->ftf, mk, ws->p, 1);
+	lusolve(ws->ftf, mk, ws->p, ws->ftr, ws->gamma, 1);
+	resize_dmatrix(ws->ftf, ws->m, ws->m);
+
+	/* x = g - DG * gamma	*/
+	for (i = 0; i < n; i++) {
+		x[i] = g[i];
+		for (j = 0; j < mk; j++)
+			x[i] -= ws->dg[j][i] * ws->gamma[j];
+	}
+	return max;
+}
+
 /* matmult: C = AB, A, B are n x n square matrices	*/
 void matmult(double **c, double **a, double **b, int n) 
 {
@@ -441,6 +962,8 @@ void matvectmult(double *vout, double **m, double *vin, int n)
 				n, vin, 1, 0.0, vout, 1);
 	#elif (MATHACCEL == MA_AMD  || MATHACCEL == MA_SUN)
 	dgemv('T', n, n, 1.0, m[0], n, vin, 1, 0.0, vout, 1);
+	#elif (MATHACCEL == MA_SIMD)
+	simd_matvect(vout, m, vin, n);
 	#else
 	int i, j;
 
@@ -460,6 +983,8 @@ void diagmatvectmult(double *vout, double *m, double *vin, int n)
 				1, 0.0, vout, 1);
 	#elif (MATHACCEL == MA_AMD  || MATHACCEL == MA_SUN)
 	dsbmv('U', n, 0, 1.0, m, 1, vin, 1, 0.0, vout, 1);
+	#elif (MATHACCEL == MA_SIMD)
+	simd_diagmatvect(vout, m, vin, n);
 	#else
 	int i;
 
@@ -479,7 +1004,7 @@ void matinv(double **inv, double **m, int n, int spd)
 	int *p, lwork;
 	double *work;
 	int i, j;
-	#if (MATHACCEL != MA_NONE)
+	#if (MATHACCEL != MA_NONE && MATHACCEL != MA_SIMD)
 	int info;
 	#endif
 	double *col;
@@ -573,6 +1098,391 @@ void matinv(double **inv, double **m, int n, int spd)
 	free_dvector(work);
 }
 
+/*
+ * e = exp(scale * m), e, m are n by n matrices. computed
+ * using scaling and squaring: scale*m is first divided by
+ * 2^s so that its infinity norm is below 1/2, the truncated
+ * Taylor series of that is summed up and the result is
+ * squared s times. with MATEXP_TERMS terms, the truncation
+ * error is below (1/2)^(MATEXP_TERMS+1)/(MATEXP_TERMS+1)!
+ */
+#define MATEXP_TERMS	12
+void matexp(double **e, double **m, double scale, int n)
+{
+	int i, j, k, s = 0;
+	double norm = 0, sum;
+	double **term, **tmp;
+
+	term = dmatrix(n, n);
+	tmp = dmatrix(n, n);
+
+	/* infinity norm of scale * m	*/
+	for (i = 0; i < n; i++) {
+		for (j = 0, sum = 0; j < n; j++)
+			sum += fabs(scale * m[i][j]);
+		if (sum > norm)
+			norm = sum;
+	}
+	while (norm > 0.5) {
+		norm /= 2.0;
+		scale /= 2.0;
+		s++;
+	}
+
+	/* e = I + x + x^2/2! + ... where x = scale * m	*/
+	zero_dmatrix(e, n, n);
+	zero_dmatrix(term, n, n);
+	for (i = 0; i < n; i++)
+		e[i][i] = term[i][i] = 1.0;
+	for (k = 1; k <= MATEXP_TERMS; k++) {
+		/* term = term * x / k	*/
+		matmult(tmp, term, m, n);
+		for (i = 0; i < n; i++)
+			for (j = 0; j < n; j++) {
+				term[i][j] = tmp[i][j] * scale / k;
+				e[i][j] += term[i][j];
+			}
+	}
+
+	/* undo the scaling: e = e^(2^s)	*/
+	for (k = 0; k < s; k++) {
+		matmult(tmp, e, e, n);
+		copy_dmatrix(e, tmp, n, n);
+	}
+
+	free_dmatrix(term);
+	free_dmatrix(tmp);
+}
+
+/*
+ * eigen decomposition of a symmetric n by n matrix 'a' using
+ * the cyclic Jacobi method. the eigenvalues are returned in 
+ * 'w' in ascending order and the corresponding eigenvectors
+ * in the columns of 'v'. 'a' is destroyed. an off-diagonal
+ * element is rotated away only when it is significant relative
+ * to its diagonal elements. so, the small eigenvalues of the 
+ * widely graded thermal matrices are still found accurately
+ */
+#define JACOBI_MAX_SWEEPS	50
+#define JACOBI_TOL			1.0e-15
+void symeig(double **a, int n, double *w, double **v)
+{
+	int i, j, k, r, sweep, rotated = TRUE;
+	double theta, t, c, s, x, y;
+
+	zero_dmatrix(v, n, n);
+	for (i = 0; i < n; i++)
+		v[i][i] = 1.0;
+
+	for (sweep = 0; sweep < JACOBI_MAX_SWEEPS && rotated; sweep++) {
+		rotated = FALSE;
+		for (i = 0; i < n-1; i++)
+			for (j = i+1; j < n; j++) {
+				if (fabs(a[i][j]) <= JACOBI_TOL * sqrt(fabs(a[i][i] * a[j][j])))
+					continue;
+				rotated = TRUE;
+				/* rotation that zeroes a[i][j]	*/
+				theta = (a[j][j] - a[i][i]) / (2.0 * a[i][j]);
+				t = 1.0 / (fabs(theta) + sqrt(theta * theta + 1.0));
+				if (theta < 0)
+					t = -t;
+				c = 1.0 / sqrt(t * t + 1.0);
+				s = t * c;
+				/* a = a * rot	*/
+				for (r = 0; r < n; r++) {
+					x = a[r][i];
+					y = a[r][j];
+					a[r][i] = c * x - s * y;
+					a[r][j] = s * x + c * y;
+				}
+				/* a = rot^T * a	*/
+				for (r = 0; r < n; r++) {
+					x = a[i][r];
+					y = a[j][r];
+					a[i][r] = c * x - s * y;
+					a[j][r] = s * x + c * y;
+				}
+				a[i][j] = a[j][i] = 0;
+				/* v = v * rot	*/
+				for (r = 0; r < n; r++) {
+					x = v[r][i];
+					y = v[r][j];
+					v[r][i] = c * x - s * y;
+					v[r][j] = s * x + c * y;
+				}
+			}
+	}
+	if (rotated)
+		fatal("Jacobi eigen decomposition did not converge\n");
+
+	/* sort the eigenpairs in ascending order of eigenvalues	*/
+	for (i = 0; i < n; i++)
+		w[i] = a[i][i];
+	for (i = 0; i < n-1; i++) {
+		for (k = i, j = i+1; j < n; j++)
+			if (w[j] < w[k])
+				k = j;
+		if (k == i)
+			continue;
+		x = w[i]; w[i] = w[k]; w[k] = x;
+		for (r = 0; r < n; r++) {
+			x = v[r][i]; v[r][i] = v[r][k]; v[r][k] = x;
+		}
+	}
+}
+
+/* 
+ * sparse matrices in compressed sparse row (CSR) format. 
+ * space for the non-zeros is grown on demand as the matrix 
+ * is (re)built. 'n' is the max. no. of rows 
+ */
+sparse_matrix_t *alloc_sparse_matrix(int n)
+{
+	sparse_matrix_t *m = (sparse_matrix_t *) calloc (1, sizeof(sparse_matrix_t));
+	if (!m)
+		fatal("memory allocation error\n");
+	m->row_ptr = ivector(n+1);
+	return m;
+}
+
+void free_sparse_matrix(sparse_matrix_t *m)
+{
+	free_ivector(m->row_ptr);
+	if (m->max_nnz) {
+		free_ivector(m->col_idx);
+		free_dvector(m->val);
+	}
+	free(m);
+}
+
+/* make room for 'nnz' non-zeros	*/
+void reserve_sparse_matrix(sparse_matrix_t *m, int nnz)
+{
+	if (nnz <= m->max_nnz)
+		return;
+	if (m->max_nnz) {
+		free_ivector(m->col_idx);
+		free_dvector(m->val);
+	}
+	m->col_idx = ivector(nnz);
+	m->val = dvector(nnz);
+	m->max_nnz = nnz;
+}
+
+/* s = m, where m is an n x n dense matrix	*/
+void dense_to_sparse(sparse_matrix_t *s, double **m, int n)
+{
+	int i, j, k, nnz = 0;
+
+	for (i = 0; i < n; i++)
+		for (j = 0; j < n; j++)
+			if (m[i][j] != 0.0)
+				nnz++;
+	reserve_sparse_matrix(s, nnz);
+
+	for (i = 0, k = 0; i < n; i++) {
+		s->row_ptr[i] = k;
+		for (j = 0; j < n; j++)
+			if (m[i][j] != 0.0) {
+				s->col_idx[k] = j;
+				s->val[k++] = m[i][j];
+			}
+	}
+	s->row_ptr[n] = k;
+	s->n = n;
+	s->nnz = nnz;
+}
+
+/* m = s, where m is an n x n dense matrix	*/
+void sparse_to_dense(double **m, sparse_matrix_t *s)
+{
+	int i, k;
+
+	zero_dmatrix(m, s->n, s->n);
+	for (i = 0; i < s->n; i++)
+		for (k = s->row_ptr[i]; k < s->row_ptr[i+1]; k++)
+			m[i][s->col_idx[k]] = s->val[k];
+}
+
+/* same as diagmatmult but 'b' and 'c' are sparse	*/
+void sparse_diagmatmult(sparse_matrix_t *c, double *a, sparse_matrix_t *b)
+{
+	int i, k;
+
+	reserve_sparse_matrix(c, b->nnz);
+	copy_ivector(c->row_ptr, b->row_ptr, b->n+1);
+	copy_ivector(c->col_idx, b->col_idx, b->nnz);
+	for (i = 0; i < b->n; i++)
+		for (k = b->row_ptr[i]; k < b->row_ptr[i+1]; k++)
+			c->val[k] = a[i] * b->val[k];
+	c->n = b->n;
+	c->nnz = b->nnz;
+}
+
+/* same as matvectmult but 'm' is sparse	*/
+void sparse_matvectmult(double *vout, sparse_matrix_t *m, double *vin)
+{
+	int i, k;
+	double sum;
+
+	for (i = 0; i < m->n; i++) {
+		for (k = m->row_ptr[i], sum = 0; k < m->row_ptr[i+1]; k++)
+			sum += m->val[k] * vin[m->col_idx[k]];
+		vout[i] = sum;
+	}
+}
+
+/* 
+ * incomplete Cholesky factor (IC(0)) of a symmetric positive 
+ * definite sparse 'm' whose rows are sorted by column. 'l' is 
+ * lower triangular with the same non-zero pattern as the lower 
+ * triangle of 'm' and l * l^T agrees with 'm' on it. it exists 
+ * for the diagonally dominant conductance matrices of the thermal 
+ * models. each row of 'l' ends with its diagonal element
+ */
+void sparse_ichol(sparse_matrix_t *l, sparse_matrix_t *m)
+{
+	int i, j, k, ki, kj, nnz = 0;
+	double sum;
+
+	for (i = 0; i < m->n; i++)
+		for (k = m->row_ptr[i]; k < m->row_ptr[i+1]; k++)
+			if (m->col_idx[k] <= i)
+				nnz++;
+	reserve_sparse_matrix(l, nnz);
+
+	for (i = 0, nnz = 0; i < m->n; i++) {
+		l->row_ptr[i] = nnz;
+		for (k = m->row_ptr[i]; k < m->row_ptr[i+1] && m->col_idx[k] <= i; k++) {
+			j = m->col_idx[k];
+			/* sum = m[i][j] - l[i][0:j-1] . l[j][0:j-1] over the common pattern	*/
+			sum = m->val[k];
+			for (ki = l->row_ptr[i], kj = l->row_ptr[j]; ki < nnz && l->col_idx[kj] < j;)
+				if (l->col_idx[ki] < l->col_idx[kj])
+					ki++;
+				else if (l->col_idx[ki] > l->col_idx[kj])
+					kj++;
+				else
+					sum -= l->val[ki++] * l->val[kj++];
+			l->col_idx[nnz] = j;
+			if (j < i)
+				l->val[nnz++] = sum / l->val[l->row_ptr[j+1]-1];
+			else {
+				if (sum <= 0)
+					fatal("matrix not positive definite in sparse_ichol\n");
+				l->val[nnz++] = sqrt(sum);
+			}
+		}
+	}
+	l->row_ptr[m->n] = nnz;
+	l->n = m->n;
+	l->nnz = nnz;
+}
+
+/* z = (l * l^T)^-1 * r for the factor 'l' of sparse_ichol	*/
+static void sparse_icholsolve(sparse_matrix_t *l, double *r, double *z)
+{
+	int i, k, n = l->n;
+	double sum;
+
+	/* forward substitution with l	*/
+	for (i = 0; i < n; i++) {
+		for (k = l->row_ptr[i], sum = r[i]; k < l->row_ptr[i+1]-1; k++)
+			sum -= l->val[k] * z[l->col_idx[k]];
+		z[i] = sum / l->val[k];
+	}
+	/* backward substitution with l^T, a column at a time	*/
+	for (i = n-1; i >= 0; i--) {
+		z[i] /= l->val[l->row_ptr[i+1]-1];
+		for (k = l->row_ptr[i]; k < l->row_ptr[i+1]-1; k++)
+			z[l->col_idx[k]] -= l->val[k] * z[i];
+	}
+}
+
+/* 
+ * solve m * x = b for a symmetric positive definite sparse 'm' 
+ * by the preconditioned conjugate gradient method. the 
+ * preconditioner is the incomplete Cholesky factor 'l' of 'm'
+ * from sparse_ichol, or the diagonal of 'm' (Jacobi) if 'l' is 
+ * NULL. 'x' holds the initial estimate. the iterations stop when 
+ * no unknown would change by more than 'tol' in a Jacobi update 
+ * or after 'max_iter' of them. 'work' holds SPARSE_PCG_N_VECTORS 
+ * vectors of m->n elements as scratch. returns the no. of 
+ * iterations - max_iter if it did not converge
+ */
+int sparse_pcg(sparse_matrix_t *m, sparse_matrix_t *l, double *b, double *x, 
+			   double **work, double tol, int max_iter)
+{
+	int i, k, iter, n = m->n;
+	double *r = work[0], *z = work[1], *d = work[2], *q = work[3];
+	double *diag = work[4];
+	double rz = 0, rz_old, alpha, max;
+
+	for (i = 0; i < n; i++)
+		for (k = m->row_ptr[i]; k < m->row_ptr[i+1]; k++)
+			if (m->col_idx[k] == i)
+				diag[i] = m->val[k];
+
+	/* r = b - m * x	*/
+	sparse_matvectmult(r, m, x);
+	for (i = 0; i < n; i++)
+		r[i] = b[i] - r[i];
+
+	for (iter = 0; iter < max_iter; iter++) {
+		/* r / diag is the Jacobi update	*/
+		for (i = 0, max = 0; i < n; i++)
+			if (fabs(r[i] / diag[i]) > max)
+				max = fabs(r[i] / diag[i]);
+		if (max <= tol)
+			break;
+		/* z = M^-1 * r for the preconditioner M	*/
+		if (l)
+			sparse_icholsolve(l, r, z);
+		else
+			for (i = 0; i < n; i++)
+				z[i] = r[i] / diag[i];
+		rz_old = rz;
+		rz = dot_dvector(r, z, n);
+		/* new search direction	*/
+		if (iter)
+			scaleadd_dvector(d, z, d, n, rz / rz_old);
+		else
+			copy_dvector(d, z, n);
+		sparse_matvectmult(q, m, d);
+		alpha = rz / dot_dvector(d, q, n);
+		scaleadd_dvector(x, x, d, n, alpha);
+		scaleadd_dvector(r, r, q, n, -alpha);
+	}
+
+	return iter;
+}
+
+void dump_sparse_matrix(sparse_matrix_t *m)
+{
+	int i, k;
+
+	fprintf(stdout, "%d x %d, %d non-zeros\n", m->n, m->n, m->nnz);
+	for (i = 0; i < m->n; i++)
+		for (k = m->row_ptr[i]; k < m->row_ptr[i+1]; k++)
+			fprintf(stdout, "%d\t%d\t%.5f\n", i, m->col_idx[k], m->val[k]);
+}
+
+/* returns x . y	*/
+double dot_dvector (double *x, double *y, int n)
+{
+	#if (MATHACCEL == MA_INTEL || MATHACCEL == MA_APPLE)
+	return cblas_ddot(n, x, 1, y, 1);
+	#elif (MATHACCEL == MA_AMD || MATHACCEL == MA_SUN)
+	return ddot(n, x, 1, y, 1);
+	#else
+	int i;
+	double sum = 0.0;
+	for(i=0; i < n; i++)
+		sum += x[i] * y[i];
+	return sum;
+	#endif
+}
+
 /* dst = src1 + scale * src2	*/
 void scaleadd_dvector (double *dst, double *src1, double *src2, int n, double scale)
 {
@@ -580,6 +1490,8 @@ void scaleadd_dvector (double *dst, double *src1, double *src2, int n, double sc
 	int i;
 	for(i=0; i < n; i++)
 		dst[i] = src1[i] + scale * src2[i];
+	#elif (MATHACCEL == MA_SIMD)
+	simd_axpy(dst, src1, scale, src2, n);
 	#else
 	/* dst == src2. so, dst *= scale, dst += src1	*/
 	if (dst == src2 && dst != src1) {
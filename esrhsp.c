@@ -41,7 +41,7 @@
 #include "stats_generator.h"		/* Stats Generation */
 #include "trace_logging.h"			/* Data Trace Logging */
 
- void schedule_sim_esrhsp(int simulation_cycles, int no_cores, int syncsleep_flag, char *power_trace_file, char *temperature_trace_file)
+ void schedule_sim_esrhsp(hotspot_ctx_t *thermal, int simulation_cycles, int no_cores, int syncsleep_flag, char *power_trace_file, char *temperature_trace_file)
 {
 	int sim_count = 0, i;
 	struct task_struct_sim *task;
@@ -97,7 +97,7 @@
 		run_queue[i].utilized_cycles = 0;
 	}
 	// Initialize Hotspot
-	initialize_hotspot();
+	initialize_hotspot(thermal);
 	
 	// Simulate the scheduler
 	while(sim_count<simulation_cycles)
@@ -194,7 +194,7 @@
 		}
 
 	    // Run Hotspot
-	    hotspot_main(sim_step_size, 0, core_power, total_l3_power, temperature, no_cores);
+	    hotspot_main(thermal, sim_step_size, 0, core_power, total_l3_power, temperature, no_cores);
 		sim_count++;
 	}
 	// Compute Stats
@@ -214,7 +214,7 @@
 	move_run_to_wait(&wait_q, run_queue, no_cores);
 
 	//Exit Hotspot
-	hotspot_exit();
+	hotspot_exit(thermal);
 
 	// Free all the memory allocated
 	free(core_power);
@@ -42,7 +42,7 @@
 #include "trace_logging.h"			/* Data Trace Logging */
 	
 
- void schedule_sim_esrms(int simulation_cycles, int no_cores, int syncsleep_flag, char *power_trace_file, char *temperature_trace_file)
+ void schedule_sim_esrms(hotspot_ctx_t *thermal, int simulation_cycles, int no_cores, int syncsleep_flag, char *power_trace_file, char *temperature_trace_file)
 {
 	int sim_count = 0;
 	struct task_struct_sim *task;
@@ -103,7 +103,7 @@
 	}
 	
 	// Initialize Hotspot
-	initialize_hotspot();
+	initialize_hotspot(thermal);
 
 	// Simulate the scheduler
 	while(sim_count<simulation_cycles)
@@ -247,7 +247,7 @@
 			power_data[i][sim_count] = core_power[i];
 		}
 	    // Run Hotspot
-	    hotspot_main(sim_step_size, 0, core_power, total_l3_power, temperature, no_cores);
+	    hotspot_main(thermal, sim_step_size, 0, core_power, total_l3_power, temperature, no_cores);
 		sim_count++;
 	}
 	// Get the stats
@@ -27,6 +27,8 @@
 #ifndef __SIM_ESRMS_INFERNO_H_
 #define __SIM_ESRMS_INFERNO_H_
 
+#include "interface_hotspot.h"		/* Hotspot Interface */
+
 // ES-RMS function
-void schedule_sim_esrms(int simulation_cycles, int no_cores, int syncsleep_flag, char *power_trace_file, char *temperature_trace_file);
+void schedule_sim_esrms(hotspot_ctx_t *thermal, int simulation_cycles, int no_cores, int syncsleep_flag, char *power_trace_file, char *temperature_trace_file);
 #endif
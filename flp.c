@@ -1013,7 +1013,7 @@ int flp_count_units(FILE *fp)
 	char name[STR_SIZE];
 	double leftx, bottomy, width, height;
 	double cp, res;
-	char *ptr;
+	char *ptr, *save;
     int count = 0;
 
 	fseek(fp, 0, SEEK_SET);
@@ -1024,7 +1024,7 @@ int flp_count_units(FILE *fp)
 		strcpy(str2, str1);
 		
 		/* ignore comments and empty lines	*/
-		ptr = strtok(str1, " \r\t\n");
+		ptr = strtok_r(str1, " \r\t\n", &save);
 		if (!ptr || ptr[0] == '#')
 			continue;
 
@@ -1065,7 +1065,7 @@ void flp_populate_blks(flp_t *flp, FILE *fp)
 	char name1[STR_SIZE], name2[STR_SIZE];
 	double width, height, leftx, bottomy, cp, res, temp;
 	double wire_density;
-	char *ptr;
+	char *ptr, *save;
 
 	fseek(fp, 0, SEEK_SET);
 	while(!feof(fp)) {		/* second pass	*/
@@ -1075,7 +1075,7 @@ void flp_populate_blks(flp_t *flp, FILE *fp)
 		strcpy(copy, str);
 
 		/* ignore comments and empty lines	*/
-		ptr = strtok(str, " \r\t\n");
+		ptr = strtok_r(str, " \r\t\n", &save);
 		if (!ptr || ptr[0] == '#')
 			continue;
 		cp = res = 0.0;
@@ -1127,7 +1127,7 @@ void flp_populate_connects(flp_t *flp, FILE *fp)
 	/* dummy fields	*/
 	double f1, f2, f3, f4, f5, f6;
 	double wire_density;
-	char *ptr;
+	char *ptr, *save;
 	int x, y, temp;
 
 	/* initialize wire_density	*/
@@ -1143,7 +1143,7 @@ void flp_populate_connects(flp_t *flp, FILE *fp)
 		strcpy(str2, str1);
 
 		/* ignore comments and empty lines	*/
-		ptr = strtok(str1, " \r\t\n");
+		ptr = strtok_r(str1, " \r\t\n", &save);
 		if (!ptr || ptr[0] == '#')
 			continue;
 
@@ -43,7 +43,7 @@ int desc_count_units(FILE *fp)
 	char name[STR_SIZE];
 	double area, min, max;
 	int rotable;
-	char *ptr;
+	char *ptr, *save;
     int count = 0;
 
 	fseek(fp, 0, SEEK_SET);
@@ -54,7 +54,7 @@ int desc_count_units(FILE *fp)
 		strcpy(str2, str1);
 
 		/* ignore comments and empty lines	*/
-		ptr = strtok(str1, " \r\t\n");
+		ptr = strtok_r(str1, " \r\t\n", &save);
 		if (!ptr || ptr[0] == '#')
 			continue;
 
@@ -95,7 +95,7 @@ void desc_populate_blks(flp_desc_t *flp_desc, FILE *fp)
 	char name1[STR_SIZE], name2[STR_SIZE];
 	double area, min, max, wire_density;
 	int rotable;
-	char *ptr;
+	char *ptr, *save;
 	int wrap_l2 = FALSE;
 
 	fseek(fp, 0, SEEK_SET);
@@ -106,7 +106,7 @@ void desc_populate_blks(flp_desc_t *flp_desc, FILE *fp)
 		strcpy(str2, str1);
 
 		/* ignore comments and empty lines	*/
-		ptr = strtok(str1, " \r\t\n");
+		ptr = strtok_r(str1, " \r\t\n", &save);
 		if (!ptr || ptr[0] == '#')
 			continue;
 
@@ -148,7 +148,7 @@ void desc_populate_connects(flp_desc_t *flp_desc, FILE *fp)
 	char name1[STR_SIZE], name2[STR_SIZE];
 	double area, min, max, wire_density;
 	int rotable;
-	char *ptr;
+	char *ptr, *save;
 
 	fseek(fp, 0, SEEK_SET);
 	while(!feof(fp)) {
@@ -158,7 +158,7 @@ void desc_populate_connects(flp_desc_t *flp_desc, FILE *fp)
 		strcpy(str2, str1);
 
 		/* ignore comments and empty lines	*/
-		ptr = strtok(str1, " \r\t\n");
+		ptr = strtok_r(str1, " \r\t\n", &save);
 		if (!ptr || ptr[0] == '#')
 			continue;
 			
@@ -379,6 +379,12 @@ int main(int argc, char **argv)
   if (do_transient)
     populate_C_model(model, flp);
 
+  /* report the accuracy of the reduced-order model, if chosen	*/
+  if (do_transient && model->type == BLOCK_MODEL && model->block->modal_k)
+    printf("reduced-order model: %d of %d modes, error bound %g K/W\n", model->block->modal_k,
+           model->block->n_nodes, modal_error_bound_block(model->block, model->block->modal_k,
+           model->config->sampling_intvl));
+
 #if VERBOSE > 2
   debug_print_model(model);
 #endif
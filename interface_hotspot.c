@@ -25,6 +25,8 @@
  * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
 
 #include "temperature.h"
 #include "temperature_grid.h"	/* for dump_steady_temp_grid	*/
@@ -32,27 +34,216 @@
 #include "util.h"
 #include "interface_hotspot.h"
 
-/* floorplan	*/
-static flp_t *flp;
-/* hotspot temperature model	*/
-static RC_model_t *model;
-/* instantaneous temperature and power values	*/
-static double *temp, *power;
-/* steady state temperature and power values	*/
-static double *overall_power, *steady_temp;
-/* Simulation Time */
-static double total_elapsed_cycles = 0;
+/* 
+ * units the scheduler reports power for - the cores "Core0", "Core1", 
+ * ... and the shared "L3" - and the floorplan blocks they map to. a 
+ * block belongs to a unit if its name is the unit's name, optionally 
+ * followed by a suffix that does not start with a digit (e.g. 
+ * "Core2_fpu"). in the grid model, all the power dissipating layers 
+ * are searched. the table is resolved by name once in hotspot_init so 
+ * that hotspot_main does no string lookups. the blocks of unit u are 
+ * unit_blk[unit_start[u]] to unit_blk[unit_start[u+1]-1] as indices
+ * into the power and temperature vectors. a unit's power is split 
+ * among its blocks in proportion to their areas (unit_share) and its 
+ * temperature is the likewise weighted average of theirs. unit 
+ * n_cores is the L3
+ */
+#define UNIT_NONE	-1
+#define UNIT_L3		-2
+
+/* 
+ * thermal context of a simulation. there is no state outside of it.
+ * so, independent simulations (e.g. one per thread) can each have
+ * their own
+ */
+struct hotspot_ctx_t_st {
+	/* floorplan	*/
+	flp_t *flp;
+	/* hotspot temperature model	*/
+	RC_model_t *model;
+	/* instantaneous temperature and power values	*/
+	double *temp, *power;
+	/* steady state temperature and power values	*/
+	double *overall_power, *steady_temp;
+	/* temperatures every run starts from (see hotspot_reset)	*/
+	double *initial_temp;
+	/* Simulation Time */
+	double total_elapsed_cycles;
+	/* the unit table above	*/
+	int n_cores;
+	int *unit_start, *unit_blk;
+	double *unit_share;
+	/* 
+	 * lazy thermal advance (see hotspot_set_lazy). the temperatures
+	 * lag behind by pending_steps ticks of pending_step seconds each, 
+	 * throughout which the units' power was unit_power. pending_first 
+	 * is set if the span includes the first call since hotspot_init 
+	 * (or the caller says so)
+	 */
+	int lazy;
+	double pending_step;
+	int pending_steps;
+	int pending_first;
+	double *unit_power;
+};
+
+/* unit of the block named 'name' - a core no., UNIT_L3 or UNIT_NONE	*/
+static int block_unit(char *name)
+{
+	if (!strncasecmp(name, "Core", 4) && isdigit((unsigned char) name[4]))
+		return (int) strtol(name + 4, NULL, 10);
+	if (!strncasecmp(name, "L3", 2) && !isdigit((unsigned char) name[2]))
+		return UNIT_L3;
+	return UNIT_NONE;
+}
+
+/* build the unit to block table above	*/
+static void build_unit_table(hotspot_ctx_t *ctx)
+{
+	int l, i, u, base, n_layers, n_blocks;
+	int *blk_unit, *next;
+	double *blk_area, *unit_area;
+	flp_t *f;
+
+	if (ctx->model->type == BLOCK_MODEL) {
+		n_layers = 1;
+		n_blocks = ctx->flp->n_units;
+	} else {
+		n_layers = ctx->model->grid->n_layers;
+		n_blocks = ctx->model->grid->total_n_blocks;
+	}
+	blk_unit = ivector(n_blocks);
+	blk_area = dvector(n_blocks);
+
+	/* unit of every block. the no. of cores is the highest core no. + 1	*/
+	ctx->n_cores = 0;
+	for(l=0, base=0; l < n_layers; l++) {
+		f = (ctx->model->type == BLOCK_MODEL) ? ctx->flp : ctx->model->grid->layers[l].flp;
+		for(i=0; i < f->n_units; i++) {
+			if (ctx->model->type == GRID_MODEL && !ctx->model->grid->layers[l].has_power)
+				blk_unit[base+i] = UNIT_NONE;
+			else
+				blk_unit[base+i] = block_unit(f->units[i].name);
+			blk_area[base+i] = f->units[i].width * f->units[i].height;
+			ctx->n_cores = MAX(ctx->n_cores, blk_unit[base+i] + 1);
+		}
+		base += f->n_units;
+	}
+
+	/* group the blocks by unit	*/
+	ctx->unit_start = ivector(ctx->n_cores + 2);
+	unit_area = dvector(ctx->n_cores + 1);
+	for(i=0; i < n_blocks; i++) {
+		if (blk_unit[i] == UNIT_L3)
+			blk_unit[i] = ctx->n_cores;
+		if (blk_unit[i] != UNIT_NONE) {
+			ctx->unit_start[blk_unit[i]+1]++;
+			unit_area[blk_unit[i]] += blk_area[i];
+		}
+	}
+	for(u=0; u <= ctx->n_cores; u++)
+		ctx->unit_start[u+1] += ctx->unit_start[u];
+	ctx->unit_blk = ivector(MAX(ctx->unit_start[ctx->n_cores+1], 1));
+	ctx->unit_share = dvector(MAX(ctx->unit_start[ctx->n_cores+1], 1));
+	next = ivector(ctx->n_cores + 1);
+	copy_ivector(next, ctx->unit_start, ctx->n_cores + 1);
+	for(i=0; i < n_blocks; i++)
+		if ((u = blk_unit[i]) != UNIT_NONE) {
+			ctx->unit_blk[next[u]] = i;
+			ctx->unit_share[next[u]] = blk_area[i] / unit_area[u];
+			next[u]++;
+		}
+
+	free_ivector(next);
+	free_ivector(blk_unit);
+	free_dvector(blk_area);
+	free_dvector(unit_area);
+}
+
+/* dissipate power 'p' in the blocks of unit u	*/
+static void set_unit_power(hotspot_ctx_t *ctx, int u, double p)
+{
+	int k;
+
+	ctx->unit_power[u] = p;
+	for (k = ctx->unit_start[u]; k < ctx->unit_start[u+1]; k++) {
+		ctx->power[ctx->unit_blk[k]] = p * ctx->unit_share[k];
+		/* for steady state temperature calculation	*/
+		ctx->overall_power[ctx->unit_blk[k]] += ctx->power[ctx->unit_blk[k]];
+	}
+}
+
+/* temperature of unit u	*/
+static double get_unit_temp(hotspot_ctx_t *ctx, int u)
+{
+	int k;
+	double t = 0;
+
+	for (k = ctx->unit_start[u]; k < ctx->unit_start[u+1]; k++)
+		t += ctx->temp[ctx->unit_blk[k]] * ctx->unit_share[k];
+	return t;
+}
+
+/* 
+ * temperatures of the cores and the L3 (if the floorplan has one)
+ * in Kelvin. output_temperature[no_cores] is the L3's
+ */
+static void get_temps(hotspot_ctx_t *ctx, double *output_temperature, int no_cores)
+{
+	int i;
+
+	for (i = 0; i < no_cores; i++)
+		output_temperature[i] = get_unit_temp(ctx, i);
+	if (ctx->unit_start[ctx->n_cores] < ctx->unit_start[ctx->n_cores+1])
+		output_temperature[no_cores] = get_unit_temp(ctx, ctx->n_cores);
+}
+
+/* does the power of any of the units differ from the pending span's?	*/
+static int power_changed(hotspot_ctx_t *ctx, double *power_array, double l3_power, int no_cores)
+{
+	int i;
+
+	for (i = 0; i < no_cores; i++)
+		if (power_array[i] != ctx->unit_power[i])
+			return TRUE;
+	return (l3_power != ctx->unit_power[ctx->n_cores]);
+}
+
+/* 
+ * calculate the current temp given the previous temp, time elapsed
+ * since then, and the average power dissipated during that interval.
+ * for the grid model, only the first call to compute_temp passes a 
+ * non-null 'temp' array. if 'temp' is  NULL, compute_temp remembers
+ * it from the last non-null call. this is used to maintain the 
+ * internal grid temperatures across multiple calls of compute_temp
+ */
+static void advance_temp(hotspot_ctx_t *ctx)
+{
+	if (!ctx->pending_steps)
+		return;
+	if (ctx->model->type == BLOCK_MODEL || ctx->pending_first)
+		compute_temp_steps(ctx->model, ctx->power, ctx->temp, 
+						   ctx->pending_step, ctx->pending_steps);
+	else
+		compute_temp_steps(ctx->model, ctx->power, NULL, 
+						   ctx->pending_step, ctx->pending_steps);
+	ctx->pending_steps = 0;
+}
 
 /* sample model initialization	*/
-void hotspot_init(char *flp_file, char *init_file, char *steady_file)
+hotspot_ctx_t *hotspot_init(char *flp_file, char *init_file, char *steady_file)
 {
+	hotspot_ctx_t *ctx;
+
 	/* input and output files	*/
 	/* flp_file		/* has the floorplan configuration	*/
 	/* init_file;		/* initial temperatures	from file	*/
 	/* steady_file;	/* steady state temperatures to file	*/
-	total_elapsed_cycles = 0;
+	ctx = (hotspot_ctx_t *) calloc(1, sizeof(hotspot_ctx_t));
+	if (!ctx)
+		fatal("memory allocation error\n");
 	/* initialize flp, get adjacency matrix */
-	flp = read_flp(flp_file, FALSE);
+	ctx->flp = read_flp(flp_file, FALSE);
 
 	/* 
 	 * configure thermal model parameters. default_thermal_config 
@@ -62,6 +253,12 @@ void hotspot_init(char *flp_file, char *init_file, char *steady_file)
 	thermal_config_t config = default_thermal_config();
 	//strcpy(config.init_file, init_file);
 	strcpy(config.steady_file, steady_file);
+	/* compute_temp is always called with the same scheduler
+	 * tick. so, use the exact exponential block solver that 
+	 * precomputes its matrices once for that step size. it takes
+	 * the place of transient_method, which has to stay rk4
+	 */
+	config.block_lti_used = TRUE;
 
 	/* default_thermal_config selects block model as the default.
 	 * in case grid model is needed, select it explicitly and
@@ -75,191 +272,256 @@ void hotspot_init(char *flp_file, char *init_file, char *steady_file)
 	/* strcpy(config->model_type, GRID_MODEL_STR); */
 
 	/* allocate and initialize the RC model	*/
-	model = alloc_RC_model(&config, flp, 0);
-	populate_R_model(model, flp);
-	populate_C_model(model, flp);
+	ctx->model = alloc_RC_model(&config, ctx->flp, 0);
+	populate_R_model(ctx->model, ctx->flp);
+	populate_C_model(ctx->model, ctx->flp);
 
 	/* allocate the temp and power arrays	*/
 	/* using hotspot_vector to internally allocate any extra nodes needed	*/
-	temp = hotspot_vector(model);
-	power = hotspot_vector(model);
-	steady_temp = hotspot_vector(model);
-	overall_power = hotspot_vector(model);
+	ctx->temp = hotspot_vector(ctx->model);
+	ctx->power = hotspot_vector(ctx->model);
+	ctx->steady_temp = hotspot_vector(ctx->model);
+	ctx->overall_power = hotspot_vector(ctx->model);
 	
 	/* set up initial instantaneous temperatures */
-	if (strcmp(model->config->init_file, NULLFILE)) {
-		if (!model->config->dtm_used)	/* initial T = steady T for no DTM	*/
-			read_temp(model, temp, model->config->init_file, FALSE);
+	if (strcmp(ctx->model->config->init_file, NULLFILE)) {
+		if (!ctx->model->config->dtm_used)	/* initial T = steady T for no DTM	*/
+			read_temp(ctx->model, ctx->temp, ctx->model->config->init_file, FALSE);
 		else	/* initial T = clipped steady T with DTM	*/
-			read_temp(model, temp, model->config->init_file, TRUE);
+			read_temp(ctx->model, ctx->temp, ctx->model->config->init_file, TRUE);
 	}
 	else	/* no input file - use init_temp as the common temperature	*/
-		set_temp(model, temp, model->config->init_temp);
+		set_temp(ctx->model, ctx->temp, ctx->model->config->init_temp);
+	ctx->initial_temp = hotspot_vector(ctx->model);
+	copy_temp(ctx->model, ctx->initial_temp, ctx->temp);
+
+	/* map the cores and the L3 to their blocks	*/
+	build_unit_table(ctx);
+	ctx->unit_power = dvector(ctx->n_cores + 1);
+
+	return ctx;
+}
+
+/* 
+ * Get the thermal context ready for another simulation run without 
+ * rebuilding it. the temperatures go back to those hotspot_init 
+ * started with (or to init_temp everywhere if it is positive). the
+ * power accumulators and the elapsed time are zeroed. the model's
+ * matrices (e.g. the block model's LU decomposition and its solver
+ * matrices for the scheduler tick) are kept
+ */
+void hotspot_reset(hotspot_ctx_t *ctx, double init_temp)
+{
+	int k;
+
+	if (init_temp > 0)
+		set_temp(ctx->model, ctx->temp, init_temp);
+	else
+		copy_temp(ctx->model, ctx->temp, ctx->initial_temp);
+
+	/* only the blocks in the unit table ever dissipate power	*/
+	for (k = 0; k < ctx->unit_start[ctx->n_cores+1]; k++)
+		ctx->power[ctx->unit_blk[k]] = ctx->overall_power[ctx->unit_blk[k]] = 0;
+	zero_dvector(ctx->unit_power, ctx->n_cores + 1);
+
+	ctx->total_elapsed_cycles = 0;
+	ctx->pending_steps = 0;
+	reset_transient_step(ctx->model);
+}
+
+/* 
+ * in the lazy mode, hotspot_main does not advance the temperatures
+ * as long as the power stays the same. the whole span is covered in
+ * one compute_temp call when the power changes or the temperatures 
+ * are read using hotspot_read_temp
+ */
+void hotspot_set_lazy(hotspot_ctx_t *ctx, int lazy)
+{
+	if (!lazy)
+		advance_temp(ctx);
+	ctx->lazy = lazy;
+}
+
+/* bring the temperatures up to date and return them	*/
+void hotspot_read_temp(hotspot_ctx_t *ctx, double *output_temperature, int no_cores)
+{
+	advance_temp(ctx);
+	get_temps(ctx, output_temperature, no_cores);
+}
+
+/* no. of doubles in a snapshot taken by hotspot_save_state	*/
+int hotspot_state_size(hotspot_ctx_t *ctx)
+{
+	/* model state, power accumulators and elapsed time	*/
+	return thermal_state_size(ctx->model) + ctx->unit_start[ctx->n_cores+1] + 1;
+}
+
+/* 
+ * snapshot the thermal state along with the power and time 
+ * accumulators into 'state' (hotspot_state_size() doubles). 
+ * hotspot_restore_state goes back to it, e.g. to simulate 
+ * alternative scheduling decisions from the same point
+ */
+void hotspot_save_state(hotspot_ctx_t *ctx, double *state)
+{
+	int k, n;
+
+	advance_temp(ctx);
+	save_thermal_state(ctx->model, ctx->temp, state);
+	n = thermal_state_size(ctx->model);
+	for (k = 0; k < ctx->unit_start[ctx->n_cores+1]; k++)
+		state[n+k] = ctx->overall_power[ctx->unit_blk[k]];
+	state[n+k] = ctx->total_elapsed_cycles;
+}
+
+void hotspot_restore_state(hotspot_ctx_t *ctx, double *state)
+{
+	int k, n;
+
+	restore_thermal_state(ctx->model, ctx->temp, state);
+	n = thermal_state_size(ctx->model);
+	for (k = 0; k < ctx->unit_start[ctx->n_cores+1]; k++)
+		ctx->overall_power[ctx->unit_blk[k]] = state[n+k];
+	ctx->total_elapsed_cycles = state[n+k];
+	ctx->pending_steps = 0;
 }
 
 /* 
  * Function invoked to calculate temperature every simulation cycle -> Function should be modified based on the 
  * thermal units used during simulation
  */
-void hotspot_main(double elapsed_time, int first_call, double *power_array, double l3_power, double *output_temperature, int no_cores)
+void hotspot_main(hotspot_ctx_t *ctx, double elapsed_time, int first_call, double *power_array, double l3_power, double *output_temperature, int no_cores)
 {
-	
-	int i, j, base, idx;
-	/* set the per cycle power values as returned by power simulator	*/
-	if (model->type == BLOCK_MODEL) {
-		power[get_blk_index(flp, "Core0")] =  (double) power_array[0];	/* set the power numbers instead of '0'	*/
-		power[get_blk_index(flp, "Core1")] =  (double) power_array[1];	
-		power[get_blk_index(flp, "Core2")] =  (double) power_array[2];	
-		power[get_blk_index(flp, "Core3")] =  (double) power_array[3];	
-		//power[get_blk_index(flp, "L3")] =  (double) l3_power;	
-		/* ... more functional units ...	*/
-	
-	/* for the grid model, set the power numbers for all power dissipating layers	*/
-	} 
-	else
-	{
-		for(i=0, base=0; i < model->grid->n_layers; i++) {
-			if(model->grid->layers[i].has_power) {
-				idx = get_blk_index(model->grid->layers[i].flp, "Icache");
-				power[base+idx] += 0;	/* set the power numbers instead of '0'	*/
-				idx = get_blk_index(model->grid->layers[i].flp, "Dcache");
-				power[base+idx] += 0;
-				idx = get_blk_index(model->grid->layers[i].flp, "Bpred");
-				power[base+idx] += 0;
-				/* ... more functional units ...	*/
-
-			}	
-			base += model->grid->layers[i].flp->n_units;	
-		}
-	}
+	int i;
 
-	/* call compute_temp at regular intervals */
-	if (model->type == BLOCK_MODEL)
-	{
-		for (i = 0; i < flp->n_units; i++) 
-		{
-			/* for steady state temperature calculation	*/
-			overall_power[i] += power[i];
-		}
-			
-	}
-	/* for the grid model, account for all the power dissipating layers	*/	
-	else
-	{
-		for(i=0, base=0; i < model->grid->n_layers; i++) 
-		{
-			if(model->grid->layers[i].has_power)
-				for(j=0; j < model->grid->layers[i].flp->n_units; j++) {
-					/* for steady state temperature calculation	*/
-					overall_power[base+j] += power[base+j];
-				}
-			base += model->grid->layers[i].flp->n_units;
-		}
-	}
+	if (no_cores > ctx->n_cores)
+		fatal("the floorplan has fewer cores than the simulator\n");
+
+	/* set the per cycle power values as returned by power simulator.
+	 * for the grid model, the blocks of all the power dissipating 
+	 * layers are in the table. the other blocks dissipate no power
+	 */
+	/* in the lazy mode, a change in power or in the tick ends the 
+	 * pending span
+	 */
+	if (ctx->lazy && ctx->pending_steps && 
+		(elapsed_time != ctx->pending_step || 
+		 power_changed(ctx, power_array, l3_power, no_cores)))
+		advance_temp(ctx);
 
+	for (i = 0; i < no_cores; i++)
+		set_unit_power(ctx, i, power_array[i]);
+	set_unit_power(ctx, ctx->n_cores, l3_power);
 
-	/* calculate the current temp given the previous temp, time
-	 * elapsed since then, and the average power dissipated during 
-	 * that interval. for the grid model, only the first call to 
-	 * compute_temp passes a non-null 'temp' array. if 'temp' is  NULL, 
-	 * compute_temp remembers it from the last non-null call. 
-	 * this is used to maintain the internal grid temperatures 
-	 * across multiple calls of compute_temp
+	/* the first call since hotspot_init counts as such even if the 
+	 * caller does not say so
 	 */
-	if (model->type == BLOCK_MODEL || first_call)
-		compute_temp(model, power, temp, elapsed_time);
-	else
-		compute_temp(model, power, NULL, elapsed_time);
-	
+	if (!ctx->pending_steps) {
+		ctx->pending_first = first_call || ctx->total_elapsed_cycles == 0;
+		ctx->pending_step = elapsed_time;
+	} else
+		ctx->pending_first = ctx->pending_first || first_call;
+	ctx->pending_steps++;
 
-	for (i = 0; i < no_cores+1; i++) 
-	{
-		/* Return the Temperature value in Kelvin to the simulator */
-		output_temperature[i] = (double)temp[i];
-	}
-	/* make sure to record the first call	*/
-	first_call = FALSE;
-
-	/* reset the power array */
-	if (model->type == BLOCK_MODEL)
-	{
-		for (i = 0; i < flp->n_units; i++)
-			power[i] = 0;
+	/* Return the Temperature values in Kelvin to the simulator	*/
+	if (!ctx->lazy) {
+		advance_temp(ctx);
+		get_temps(ctx, output_temperature, no_cores);
 	}
-	else
-	{
-		for(i=0, base=0; i < model->grid->n_layers; i++) 
-		{
-			if(model->grid->layers[i].has_power)
-				for(j=0; j < model->grid->layers[i].flp->n_units; j++)
-					power[base+j] = 0;
-			base += model->grid->layers[i].flp->n_units;
-		}
-	}	
+
 	/* Update Total Time */
-	total_elapsed_cycles++; 
+	ctx->total_elapsed_cycles++; 
 	return;
 }
 
 /* 
- * Exit Hotspot once the entire simulation is done
+ * Exit Hotspot once the entire simulation run is done. the thermal
+ * context stays for the next run (see hotspot_reset) till 
+ * hotspot_cleanup
  */
-void hotspot_exit()
+void hotspot_exit(hotspot_ctx_t *ctx)
 {
 	/* set this to be the correct time elapsed  (in cycles) */
 	int i, j, base;
 
+	/* the last temperatures of the run	*/
+	advance_temp(ctx);
+
 	/* find the average power dissipated in the elapsed time */
-	if (model->type == BLOCK_MODEL)
-		for (i = 0; i < flp->n_units; i++)
-			overall_power[i] /= total_elapsed_cycles;
+	if (ctx->model->type == BLOCK_MODEL)
+		for (i = 0; i < ctx->flp->n_units; i++)
+			ctx->overall_power[i] /= ctx->total_elapsed_cycles;
 	else		
-		for(i=0, base=0; i < model->grid->n_layers; i++) {
-			if(model->grid->layers[i].has_power)
-				for(j=0; j < model->grid->layers[i].flp->n_units; j++)
-					overall_power[base+j] /= total_elapsed_cycles;
-			base += model->grid->layers[i].flp->n_units;
+		for(i=0, base=0; i < ctx->model->grid->n_layers; i++) {
+			if(ctx->model->grid->layers[i].has_power)
+				for(j=0; j < ctx->model->grid->layers[i].flp->n_units; j++)
+					ctx->overall_power[base+j] /= ctx->total_elapsed_cycles;
+			base += ctx->model->grid->layers[i].flp->n_units;
 		}
 
 	/* get steady state temperatures */
-	steady_state_temp(model, overall_power, steady_temp);
+	steady_state_temp(ctx->model, ctx->overall_power, ctx->steady_temp);
 
 	/* dump temperatures if needed	*/
-	if (strcmp(model->config->steady_file, NULLFILE))
-		dump_temp(model, steady_temp, model->config->steady_file);
+	if (strcmp(ctx->model->config->steady_file, NULLFILE))
+		dump_temp(ctx->model, ctx->steady_temp, ctx->model->config->steady_file);
 
 	/* for the grid model, optionally dump the internal 
 	 * temperatures of the grid cells	
 	 */
-	if (model->type == GRID_MODEL &&
-		strcmp(model->config->grid_steady_file, NULLFILE))
-		dump_steady_temp_grid(model->grid, model->config->grid_steady_file);
-
-	/* cleanup */
-	delete_RC_model(model);
-	free_flp(flp, FALSE);
-	free_dvector(temp);
-	free_dvector(power);
-	free_dvector(steady_temp);
-	free_dvector(overall_power);
+	if (ctx->model->type == GRID_MODEL &&
+		strcmp(ctx->model->config->grid_steady_file, NULLFILE))
+		dump_steady_temp_grid(ctx->model->grid, ctx->model->config->grid_steady_file);
+
+}
+
+/* 
+ * Free the thermal context once no more runs are to be simulated
+ */
+void hotspot_cleanup(hotspot_ctx_t *ctx)
+{
+	if (!ctx)
+		return;
+	delete_RC_model(ctx->model);
+	free_flp(ctx->flp, FALSE);
+	free_dvector(ctx->temp);
+	free_dvector(ctx->power);
+	free_dvector(ctx->steady_temp);
+	free_dvector(ctx->overall_power);
+	free_dvector(ctx->initial_temp);
+	free_ivector(ctx->unit_start);
+	free_ivector(ctx->unit_blk);
+	free_dvector(ctx->unit_share);
+	free_dvector(ctx->unit_power);
+	free(ctx);
 }
 
 // Hotspot Initialization
-void initialize_hotspot(void)
+hotspot_ctx_t *initialize_hotspot(hotspot_ctx_t *ctx)
 {
-	char *flp_file = (char*) malloc(200*sizeof(char));
-	char *init_file = (char*) malloc(200*sizeof(char));
-	char *steady_file= (char*) malloc(200*sizeof(char));
+	char *flp_file, *init_file, *steady_file;
+
+	/* the model is built once and reused by every run	*/
+	if (ctx) {
+		hotspot_reset(ctx, 0);
+		return ctx;
+	}
+
+	flp_file = (char*) malloc(200*sizeof(char));
+	init_file = (char*) malloc(200*sizeof(char));
+	steady_file= (char*) malloc(200*sizeof(char));
 	
 	sprintf(init_file, "hotspot_input/test1.init");
 	sprintf(flp_file, "hotspot_input/test1.flp");
     sprintf(steady_file, "hotspot_input/test1.steady");
 	
-	hotspot_init(flp_file, init_file, steady_file);
+	ctx = hotspot_init(flp_file, init_file, steady_file);
 	
 	free(flp_file);
 	free(init_file);
 	free(steady_file);
+
+	return ctx;
 }
 
 
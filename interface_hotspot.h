@@ -26,18 +26,52 @@
  */
 #ifndef __SIM_INTERFACE_INFERNO_H_
 #define __SIM_INTERFACE_INFERNO_H_
-/* Initialize Hotspot 
+/* Thermal context of a simulation. Every function below works on the one
+   passed to it and nothing else. So, independent simulations (e.g. one per
+   thread) can each run with their own */
+typedef struct hotspot_ctx_t_st hotspot_ctx_t;
+
+/* Initialize Hotspot and return a new thermal context
 Params flp_file	         has the floorplan configuration	
 	   init_file		 initial temperatures	from file	
 	   steady_file  	 steady state temperatures to file	*/
-extern void hotspot_init(char *flp_file, char *init_file, char *steady_file);
+extern hotspot_ctx_t *hotspot_init(char *flp_file, char *init_file, char *steady_file);
+
+/* Invoke hotspot every scheduler simulation interval. power_array and
+ * output_temperature have an entry per core - the blocks named "Core0",
+ * "Core1", ... (or "Core0_*", ... if a core has many blocks) in the
+ * floorplan. l3_power goes to the "L3" block(s) and, if there are any,
+ * their temperature to output_temperature[no_cores]  */
+extern void hotspot_main(hotspot_ctx_t *ctx, double elapsed_time, int first_call, double *power_array, double l3_power, double *output_temperature, int no_cores);
+
+/* Lazy mode -> hotspot_main leaves output_temperature alone and advances the
+   temperatures only when the power (or elapsed_time) changes, so runs of calls
+   with the same power take one thermal step. hotspot_read_temp brings them up
+   to date and returns them like hotspot_main. With the block model's exact
+   solver (block_lti_used), a span of k ticks costs one matrix-vector step per
+   bit set in k using matrices kept for the tick. With the implicit solvers, implicit_steps covers
+   a whole span. Turning it off brings the temperatures up to date */
+extern void hotspot_set_lazy(hotspot_ctx_t *ctx, int lazy);
+extern void hotspot_read_temp(hotspot_ctx_t *ctx, double *output_temperature, int no_cores);
+
+/* Exit Hotspot once the simulation is complete -> the model is kept for the next run */
+extern void hotspot_exit(hotspot_ctx_t *ctx);
+
+/* Restart from the initial temperatures (or init_temp everywhere if it is positive) 
+   and clear the power and time accumulators without rebuilding the model */
+extern void hotspot_reset(hotspot_ctx_t *ctx, double init_temp);
 
-/* Invoke hotspot every scheduler simulation interval  */
-extern void hotspot_main(double elapsed_time, int first_call, double *power_array, double l3_power, double *output_temperature, int no_cores);
+/* Snapshot the thermal state (and the power and time accumulators) into a
+   caller-allocated array of hotspot_state_size() doubles and go back to it
+   later, e.g. to simulate alternative scheduling decisions from the same point */
+extern int hotspot_state_size(hotspot_ctx_t *ctx);
+extern void hotspot_save_state(hotspot_ctx_t *ctx, double *state);
+extern void hotspot_restore_state(hotspot_ctx_t *ctx, double *state);
 
-/* Exit Hotspot once the simulation is complete */
-extern void hotspot_exit(void);
+/* Free the context once all the runs are complete */
+extern void hotspot_cleanup(hotspot_ctx_t *ctx);
 
-/* Initialize Hotspot on each run -> takes in files */
-extern void initialize_hotspot(void);
+/* Initialize Hotspot on each run -> takes in files the first time (ctx is NULL)
+   and returns the new context, resets ctx after that */
+extern hotspot_ctx_t *initialize_hotspot(hotspot_ctx_t *ctx);
 #endif
\ No newline at end of file
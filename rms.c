@@ -43,7 +43,7 @@
 #include "trace_logging.h"			/* Data Trace Logging */
 
 // Implements RMS scheduling -> Takes in number of simulation cycles and cores as parameters
-void schedule_sim_rms(int simulation_cycles, int no_cores, char *power_trace_file, char *temperature_trace_file)
+void schedule_sim_rms(hotspot_ctx_t *thermal, int simulation_cycles, int no_cores, char *power_trace_file, char *temperature_trace_file)
 {
 	int sim_count = 0;
 	struct task_struct_sim *task;
@@ -98,7 +98,7 @@ void schedule_sim_rms(int simulation_cycles, int no_cores, char *power_trace_fil
 	}
 	
 	// Initialize Hotspot
-	initialize_hotspot();
+	initialize_hotspot(thermal);
 
 	// Simulate the scheduler
 	while(sim_count<simulation_cycles)
@@ -185,7 +185,7 @@ void schedule_sim_rms(int simulation_cycles, int no_cores, char *power_trace_fil
 			power_data[i][sim_count] = core_power[i];
 		}
 	    // Run Hotspot
-	    hotspot_main(sim_step_size, 0, core_power, total_l3_power, temperature, no_cores);
+	    hotspot_main(thermal, sim_step_size, 0, core_power, total_l3_power, temperature, no_cores);
 		sim_count++;
 	}
 	// Get the stats
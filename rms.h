@@ -27,6 +27,8 @@
 #ifndef __SIM_RMS_INFERNO_H_
 #define __SIM_RMS_INFERNO_H_
 
+#include "interface_hotspot.h"		/* Hotspot Interface */
+
 // RMS function
-void schedule_sim_rms(int simulation_cycles, int no_cores, char *power_trace_file, char *temperature_trace_file);
+void schedule_sim_rms(hotspot_ctx_t *thermal, int simulation_cycles, int no_cores, char *power_trace_file, char *temperature_trace_file);
 #endif
@@ -72,14 +72,14 @@ void close_task_files()
 }
 
 // Will run different schedulers for each taskset
-void schedule_sim(int simulation_cycles, int no_cores, char* power_output_file, char* temperature_output_file, int global_syncsleep_flag)
+void schedule_sim(hotspot_ctx_t *thermal, int simulation_cycles, int no_cores, char* power_output_file, char* temperature_output_file, int global_syncsleep_flag)
 {
 	printf("Running ES-RHS+\n");
-	schedule_sim_esrhsp(simulation_cycles, no_cores, global_syncsleep_flag, power_output_file, temperature_output_file);
+	schedule_sim_esrhsp(thermal, simulation_cycles, no_cores, global_syncsleep_flag, power_output_file, temperature_output_file);
 	printf("Running ES-RMS\n");
-	schedule_sim_esrms(simulation_cycles, no_cores, global_syncsleep_flag, power_output_file, temperature_output_file);
+	schedule_sim_esrms(thermal, simulation_cycles, no_cores, global_syncsleep_flag, power_output_file, temperature_output_file);
 	printf("Running Sysclock\n");
-	schedule_sim_sysclock(simulation_cycles, no_cores, power_output_file, temperature_output_file);
+	schedule_sim_sysclock(thermal, simulation_cycles, no_cores, power_output_file, temperature_output_file);
 }
 
 int main(int argc, char **argv)
@@ -91,6 +91,7 @@ int main(int argc, char **argv)
 	int simulation_cycles = MAX_SIMULATION_CYCLES;
 	int esrhsp_flag = 0;
 	struct task_struct_sim *task_list;
+	hotspot_ctx_t *thermal;									// Thermal model shared by all the tasksets
 	int scheduling_policy = 0;
 	double utilization_bound = 0;
 	int random_generate_on = 0;
@@ -162,6 +163,8 @@ int main(int argc, char **argv)
 	original_sleep_time = sleep_time;
 	// Initialize the McPAT LUTs -> for the MiBench Automotive Benchmark
 	initialize_mcpat("mcpat_lut/mcpat_lut_file", MCPAT_FILE_READ);
+	// Build the thermal model -> every scheduler run resets it
+	thermal = initialize_hotspot(NULL);
 	// RHS specific
 	sleeper = (struct sleeping_task*)malloc((number_cores)*sizeof(struct sleeping_task));
 
@@ -216,7 +219,7 @@ int main(int argc, char **argv)
 
 				// Run the scheduler
 				printf("Scheduler Running.....\n");
-				schedule_sim(simulation_cycles, number_cores, power_output_file, temperature_output_file, global_syncsleep_flag);
+				schedule_sim(thermal, simulation_cycles, number_cores, power_output_file, temperature_output_file, global_syncsleep_flag);
 
 				//Display output
 				printf("CPU\t\tinitialized utilization\t\tutilization\n");
@@ -245,12 +248,12 @@ int main(int argc, char **argv)
 				if(esrhsp_flag == 1)
 				{
 					printf("Running ESRHSP with syncsleep flag %d\n", global_syncsleep_flag);
-					schedule_sim_esrhsp(simulation_cycles, number_cores, global_syncsleep_flag, power_output_file, temperature_output_file);
+					schedule_sim_esrhsp(thermal, simulation_cycles, number_cores, global_syncsleep_flag, power_output_file, temperature_output_file);
 				}
 				else
 				{
 					printf("Running ESRMS with syncsleep flag %d\n", global_syncsleep_flag);
-					schedule_sim_esrms(simulation_cycles, number_cores, global_syncsleep_flag, power_output_file, temperature_output_file);
+					schedule_sim_esrms(thermal, simulation_cycles, number_cores, global_syncsleep_flag, power_output_file, temperature_output_file);
 				}
 			}
 			else if (retval == -2)
@@ -273,6 +276,8 @@ int main(int argc, char **argv)
 	}
 	// Free The McPAT LUTs
 	free_mcpat();
+	// Free the thermal model shared by all the tasksets
+	hotspot_cleanup(thermal);
 
 	free(run_queue);
 	free(task_list);
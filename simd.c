@@ -0,0 +1,420 @@
+/*
+ * vectorized versions of the vector and matrix primitives
+ * of RCutil.c for builds without a BLAS library. the x86
+ * kernels for each instruction set are compiled with the
+ * corresponding target attribute. so, no special compiler
+ * flags are needed and the choice among them is made at
+ * run time, on the first call
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "simd.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* vectors shorter than this are not worth splitting among threads	*/
+#define SIMD_PAR_SIZE	16384
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86	1
+#include <immintrin.h>
+#else
+#define SIMD_X86	0
+#endif
+
+/* portable versions - also handle the tails of the vector loops	*/
+static void axpy_c(double *dst, double *x, double a, double *y, int from, int n)
+{
+	int i;
+	for (i = from; i < n; i++)
+		dst[i] = x[i] + a * y[i];
+}
+
+static void rk4_combine_c(double *yout, double *y, double *k1, double *k2,
+						  double *k3, double *k4, double h, int from, int n)
+{
+	int i;
+	for (i = from; i < n; i++)
+		yout[i] = y[i] + h * (k1[i] + 2*k2[i] + 2*k3[i] + k4[i])/6.0;
+}
+
+static double max_abs_diff_c(double *x, double *y, int from, int n, double max)
+{
+	int i;
+	for (i = from; i < n; i++)
+		if (fabs(x[i] - y[i]) > max)
+			max = fabs(x[i] - y[i]);
+	return max;
+}
+
+static double dot_c(double *x, double *y, int from, int n, double sum)
+{
+	int i;
+	for (i = from; i < n; i++)
+		sum += x[i] * y[i];
+	return sum;
+}
+
+static void diagmatvect_c(double *vout, double *m, double *vin, int from, int n)
+{
+	int i;
+	for (i = from; i < n; i++)
+		vout[i] = m[i] * vin[i];
+}
+
+static void axpy_scalar(double *dst, double *x, double a, double *y, int n)
+{
+	axpy_c(dst, x, a, y, 0, n);
+}
+
+static void rk4_combine_scalar(double *yout, double *y, double *k1, double *k2,
+							   double *k3, double *k4, double h, int n)
+{
+	rk4_combine_c(yout, y, k1, k2, k3, k4, h, 0, n);
+}
+
+static double max_abs_diff_scalar(double *x, double *y, int n)
+{
+	return max_abs_diff_c(x, y, 0, n, 0.0);
+}
+
+static double dot_scalar(double *x, double *y, int n)
+{
+	return dot_c(x, y, 0, n, 0.0);
+}
+
+static void diagmatvect_scalar(double *vout, double *m, double *vin, int n)
+{
+	diagmatvect_c(vout, m, vin, 0, n);
+}
+
+#if SIMD_X86
+/* SSE2 - two doubles per vector. part of the x86-64 baseline	*/
+__attribute__((target("sse2")))
+static void axpy_sse2(double *dst, double *x, double a, double *y, int n)
+{
+	int i;
+	__m128d va = _mm_set1_pd(a);
+	for (i = 0; i + 2 <= n; i += 2)
+		_mm_storeu_pd(dst+i, _mm_add_pd(_mm_loadu_pd(x+i),
+					  _mm_mul_pd(va, _mm_loadu_pd(y+i))));
+	axpy_c(dst, x, a, y, i, n);
+}
+
+__attribute__((target("sse2")))
+static void rk4_combine_sse2(double *yout, double *y, double *k1, double *k2,
+							 double *k3, double *k4, double h, int n)
+{
+	int i;
+	__m128d h6 = _mm_set1_pd(h/6.0), h3 = _mm_set1_pd(h/3.0);
+	__m128d s, t;
+	for (i = 0; i + 2 <= n; i += 2) {
+		s = _mm_add_pd(_mm_loadu_pd(k1+i), _mm_loadu_pd(k4+i));
+		t = _mm_add_pd(_mm_loadu_pd(k2+i), _mm_loadu_pd(k3+i));
+		_mm_storeu_pd(yout+i, _mm_add_pd(_mm_loadu_pd(y+i),
+					  _mm_add_pd(_mm_mul_pd(h6, s), _mm_mul_pd(h3, t))));
+	}
+	rk4_combine_c(yout, y, k1, k2, k3, k4, h, i, n);
+}
+
+__attribute__((target("sse2")))
+static double max_abs_diff_sse2(double *x, double *y, int n)
+{
+	int i;
+	double r[2];
+	__m128d sign = _mm_set1_pd(-0.0), max = _mm_setzero_pd();
+	for (i = 0; i + 2 <= n; i += 2)
+		max = _mm_max_pd(max, _mm_andnot_pd(sign,
+						 _mm_sub_pd(_mm_loadu_pd(x+i), _mm_loadu_pd(y+i))));
+	_mm_storeu_pd(r, max);
+	return max_abs_diff_c(x, y, i, n, r[0] > r[1] ? r[0] : r[1]);
+}
+
+__attribute__((target("sse2")))
+static double dot_sse2(double *x, double *y, int n)
+{
+	int i;
+	double r[2];
+	__m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+	for (i = 0; i + 4 <= n; i += 4) {
+		s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(x+i), _mm_loadu_pd(y+i)));
+		s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(x+i+2), _mm_loadu_pd(y+i+2)));
+	}
+	_mm_storeu_pd(r, _mm_add_pd(s0, s1));
+	return dot_c(x, y, i, n, r[0] + r[1]);
+}
+
+__attribute__((target("sse2")))
+static void diagmatvect_sse2(double *vout, double *m, double *vin, int n)
+{
+	int i;
+	for (i = 0; i + 2 <= n; i += 2)
+		_mm_storeu_pd(vout+i, _mm_mul_pd(_mm_loadu_pd(m+i), _mm_loadu_pd(vin+i)));
+	diagmatvect_c(vout, m, vin, i, n);
+}
+
+/* AVX2 - four doubles per vector, fused multiply-adds	*/
+__attribute__((target("avx2,fma")))
+static void axpy_avx2(double *dst, double *x, double a, double *y, int n)
+{
+	int i;
+	__m256d va = _mm256_set1_pd(a);
+	for (i = 0; i + 4 <= n; i += 4)
+		_mm256_storeu_pd(dst+i, _mm256_fmadd_pd(va, _mm256_loadu_pd(y+i),
+						 _mm256_loadu_pd(x+i)));
+	axpy_c(dst, x, a, y, i, n);
+}
+
+__attribute__((target("avx2,fma")))
+static void rk4_combine_avx2(double *yout, double *y, double *k1, double *k2,
+							 double *k3, double *k4, double h, int n)
+{
+	int i;
+	__m256d h6 = _mm256_set1_pd(h/6.0), h3 = _mm256_set1_pd(h/3.0);
+	__m256d s, t;
+	for (i = 0; i + 4 <= n; i += 4) {
+		s = _mm256_add_pd(_mm256_loadu_pd(k1+i), _mm256_loadu_pd(k4+i));
+		t = _mm256_add_pd(_mm256_loadu_pd(k2+i), _mm256_loadu_pd(k3+i));
+		_mm256_storeu_pd(yout+i, _mm256_fmadd_pd(h3, t,
+						 _mm256_fmadd_pd(h6, s, _mm256_loadu_pd(y+i))));
+	}
+	rk4_combine_c(yout, y, k1, k2, k3, k4, h, i, n);
+}
+
+__attribute__((target("avx2,fma")))
+static double max_abs_diff_avx2(double *x, double *y, int n)
+{
+	int i;
+	double r[4];
+	__m256d sign = _mm256_set1_pd(-0.0), max = _mm256_setzero_pd();
+	for (i = 0; i + 4 <= n; i += 4)
+		max = _mm256_max_pd(max, _mm256_andnot_pd(sign,
+							_mm256_sub_pd(_mm256_loadu_pd(x+i), _mm256_loadu_pd(y+i))));
+	_mm256_storeu_pd(r, max);
+	r[0] = r[0] > r[1] ? r[0] : r[1];
+	r[2] = r[2] > r[3] ? r[2] : r[3];
+	return max_abs_diff_c(x, y, i, n, r[0] > r[2] ? r[0] : r[2]);
+}
+
+__attribute__((target("avx2,fma")))
+static double dot_avx2(double *x, double *y, int n)
+{
+	int i;
+	double r[4];
+	__m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+	for (i = 0; i + 8 <= n; i += 8) {
+		s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x+i), _mm256_loadu_pd(y+i), s0);
+		s1 = _mm256_fmadd_pd(_mm256_loadu_pd(x+i+4), _mm256_loadu_pd(y+i+4), s1);
+	}
+	_mm256_storeu_pd(r, _mm256_add_pd(s0, s1));
+	return dot_c(x, y, i, n, (r[0] + r[1]) + (r[2] + r[3]));
+}
+
+__attribute__((target("avx2,fma")))
+static void diagmatvect_avx2(double *vout, double *m, double *vin, int n)
+{
+	int i;
+	for (i = 0; i + 4 <= n; i += 4)
+		_mm256_storeu_pd(vout+i, _mm256_mul_pd(_mm256_loadu_pd(m+i),
+						 _mm256_loadu_pd(vin+i)));
+	diagmatvect_c(vout, m, vin, i, n);
+}
+
+/* AVX-512 - eight doubles per vector	*/
+__attribute__((target("avx512f")))
+static void axpy_avx512(double *dst, double *x, double a, double *y, int n)
+{
+	int i;
+	__m512d va = _mm512_set1_pd(a);
+	for (i = 0; i + 8 <= n; i += 8)
+		_mm512_storeu_pd(dst+i, _mm512_fmadd_pd(va, _mm512_loadu_pd(y+i),
+						 _mm512_loadu_pd(x+i)));
+	axpy_c(dst, x, a, y, i, n);
+}
+
+__attribute__((target("avx512f")))
+static void rk4_combine_avx512(double *yout, double *y, double *k1, double *k2,
+							   double *k3, double *k4, double h, int n)
+{
+	int i;
+	__m512d h6 = _mm512_set1_pd(h/6.0), h3 = _mm512_set1_pd(h/3.0);
+	__m512d s, t;
+	for (i = 0; i + 8 <= n; i += 8) {
+		s = _mm512_add_pd(_mm512_loadu_pd(k1+i), _mm512_loadu_pd(k4+i));
+		t = _mm512_add_pd(_mm512_loadu_pd(k2+i), _mm512_loadu_pd(k3+i));
+		_mm512_storeu_pd(yout+i, _mm512_fmadd_pd(h3, t,
+						 _mm512_fmadd_pd(h6, s, _mm512_loadu_pd(y+i))));
+	}
+	rk4_combine_c(yout, y, k1, k2, k3, k4, h, i, n);
+}
+
+__attribute__((target("avx512f")))
+static double max_abs_diff_avx512(double *x, double *y, int n)
+{
+	int i;
+	__m512d max = _mm512_setzero_pd();
+	for (i = 0; i + 8 <= n; i += 8)
+		max = _mm512_max_pd(max, _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(x+i),
+							_mm512_loadu_pd(y+i))));
+	return max_abs_diff_c(x, y, i, n, _mm512_reduce_max_pd(max));
+}
+
+__attribute__((target("avx512f")))
+static double dot_avx512(double *x, double *y, int n)
+{
+	int i;
+	__m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+	for (i = 0; i + 16 <= n; i += 16) {
+		s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x+i), _mm512_loadu_pd(y+i), s0);
+		s1 = _mm512_fmadd_pd(_mm512_loadu_pd(x+i+8), _mm512_loadu_pd(y+i+8), s1);
+	}
+	return dot_c(x, y, i, n, _mm512_reduce_add_pd(_mm512_add_pd(s0, s1)));
+}
+
+__attribute__((target("avx512f")))
+static void diagmatvect_avx512(double *vout, double *m, double *vin, int n)
+{
+	int i;
+	for (i = 0; i + 8 <= n; i += 8)
+		_mm512_storeu_pd(vout+i, _mm512_mul_pd(_mm512_loadu_pd(m+i),
+						 _mm512_loadu_pd(vin+i)));
+	diagmatvect_c(vout, m, vin, i, n);
+}
+#endif	/* SIMD_X86	*/
+
+/* the kernels in use - chosen by simd_init()	*/
+static struct {
+	const char *isa;
+	void (*axpy)(double *dst, double *x, double a, double *y, int n);
+	void (*rk4_combine)(double *yout, double *y, double *k1, double *k2,
+						double *k3, double *k4, double h, int n);
+	double (*max_abs_diff)(double *x, double *y, int n);
+	double (*dot)(double *x, double *y, int n);
+	void (*diagmatvect)(double *vout, double *m, double *vin, int n);
+} kernels;
+
+#define SET_KERNELS(name, suffix)	do {							\
+	kernels.axpy = axpy_##suffix;									\
+	kernels.rk4_combine = rk4_combine_##suffix;						\
+	kernels.max_abs_diff = max_abs_diff_##suffix;					\
+	kernels.dot = dot_##suffix;										\
+	kernels.diagmatvect = diagmatvect_##suffix;						\
+	SET_ISA(name);													\
+} while (0)
+
+/* 
+ * the kernels are picked on first use. independent thermal models
+ * may be simulated in different threads. so, kernels.isa is published
+ * last with release semantics. a thread that sees it set sees the
+ * rest too. threads racing in simd_init store the same values
+ */
+#ifdef __GNUC__
+#define KERNELS_READY()	__atomic_load_n(&kernels.isa, __ATOMIC_ACQUIRE)
+#define SET_ISA(name)	__atomic_store_n(&kernels.isa, (name), __ATOMIC_RELEASE)
+#else
+#define KERNELS_READY()	(kernels.isa)
+#define SET_ISA(name)	(kernels.isa = (name))
+#endif
+
+/* the slice [*from, *to) of an n element vector for the calling 
+ * thread of an OpenMP team. the slices start at multiples of 8. 
+ * so, the vector loops handle the same elements whatever the
+ * no. of threads and the results do not depend on it
+ */
+static void thread_slice(int n, int *from, int *to)
+{
+	#ifdef _OPENMP
+	int nt = omp_get_num_threads(), id = omp_get_thread_num();
+	*from = (int) (((long long) n * id / nt) & ~7LL);
+	*to = (id == nt-1) ? n : (int) (((long long) n * (id+1) / nt) & ~7LL);
+	#else
+	*from = 0;
+	*to = n;
+	#endif
+}
+
+/* pick the widest instruction set the processor supports	*/
+static void simd_init(void)
+{
+	#if SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		SET_KERNELS("avx512", avx512);
+	else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		SET_KERNELS("avx2", avx2);
+	else if (__builtin_cpu_supports("sse2"))
+		SET_KERNELS("sse2", sse2);
+	else
+	#endif
+		SET_KERNELS("scalar", scalar);
+	#if VERBOSE > 1
+	fprintf(stdout, "using %s vector kernels\n", kernels.isa);
+	#endif
+}
+
+void simd_axpy(double *dst, double *x, double a, double *y, int n)
+{
+	if (!KERNELS_READY())
+		simd_init();
+	#ifdef _OPENMP
+	#pragma omp parallel if (n >= SIMD_PAR_SIZE)
+	#endif
+	{
+		int from, to;
+		thread_slice(n, &from, &to);
+		kernels.axpy(dst+from, x+from, a, y+from, to-from);
+	}
+}
+
+void simd_rk4_combine(double *yout, double *y, double *k1, double *k2,
+					  double *k3, double *k4, double h, int n)
+{
+	if (!KERNELS_READY())
+		simd_init();
+	#ifdef _OPENMP
+	#pragma omp parallel if (n >= SIMD_PAR_SIZE)
+	#endif
+	{
+		int from, to;
+		thread_slice(n, &from, &to);
+		kernels.rk4_combine(yout+from, y+from, k1+from, k2+from, 
+							k3+from, k4+from, h, to-from);
+	}
+}
+
+double simd_max_abs_diff(double *x, double *y, int n)
+{
+	double max = 0;
+	if (!KERNELS_READY())
+		simd_init();
+	/* max is exact. so, the reduction is deterministic	*/
+	#ifdef _OPENMP
+	#pragma omp parallel if (n >= SIMD_PAR_SIZE) reduction(max:max)
+	#endif
+	{
+		int from, to;
+		thread_slice(n, &from, &to);
+		max = kernels.max_abs_diff(x+from, y+from, to-from);
+	}
+	return max;
+}
+
+void simd_matvect(double *vout, double **m, double *vin, int n)
+{
+	int i;
+	if (!KERNELS_READY())
+		simd_init();
+	for (i = 0; i < n; i++)
+		vout[i] = kernels.dot(m[i], vin, n);
+}
+
+void simd_diagmatvect(double *vout, double *m, double *vin, int n)
+{
+	if (!KERNELS_READY())
+		simd_init();
+	kernels.diagmatvect(vout, m, vin, n);
+}
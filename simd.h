@@ -0,0 +1,25 @@
+#ifndef __SIMD_H_
+#define __SIMD_H_
+
+/*
+ * built-in vectorized kernels used by RCutil.c when no BLAS
+ * library is available (MATHACCEL = simd). on x86, the widest
+ * of AVX-512, AVX2 (with FMA) or SSE2 supported by the processor
+ * is picked at run time. elsewhere, they are plain C loops.
+ * long vectors are split among the threads of an OpenMP team
+ * destination vectors may alias the source vectors
+ */
+
+/* dst = x + a * y	*/
+void simd_axpy(double *dst, double *x, double a, double *y, int n);
+/* final rk4 stage: yout = y + h * (k1/6 + k2/3 + k3/3 + k4/6)	*/
+void simd_rk4_combine(double *yout, double *y, double *k1, double *k2,
+					  double *k3, double *k4, double h, int n);
+/* max |x - y|	*/
+double simd_max_abs_diff(double *x, double *y, int n);
+/* vout = m * vin, m is an n x n matrix (vout != vin)	*/
+void simd_matvect(double *vout, double **m, double *vin, int n);
+/* vout = m * vin, m is a diagonal matrix stored as a 1-d array	*/
+void simd_diagmatvect(double *vout, double *m, double *vin, int n);
+
+#endif
@@ -215,7 +215,7 @@ void scale_frequency(double *scaling_factor, int no_cores)
 	
 }
 
-void schedule_sim_sysclock(int simulation_cycles, int no_cores, char *power_trace_file, char *temperature_trace_file)
+void schedule_sim_sysclock(hotspot_ctx_t *thermal, int simulation_cycles, int no_cores, char *power_trace_file, char *temperature_trace_file)
 {
 	int sim_count = 0;
 	struct task_struct_sim *task;
@@ -278,7 +278,7 @@ void schedule_sim_sysclock(int simulation_cycles, int no_cores, char *power_trac
 
 	}
 	// Initialize Hotspot
-	initialize_hotspot();
+	initialize_hotspot(thermal);
 
 	// Simulate the scheduler
 	while(sim_count<simulation_cycles)
@@ -360,7 +360,7 @@ void schedule_sim_sysclock(int simulation_cycles, int no_cores, char *power_trac
 		}
 		
  		// Run Hotspot
-	    hotspot_main(sim_step_size, 0, core_power, total_l3_power, temperature, no_cores);
+	    hotspot_main(thermal, sim_step_size, 0, core_power, total_l3_power, temperature, no_cores);
 	    // Store data in arrays
 		for(i=0; i<no_cores; i++)
 		{
@@ -386,7 +386,7 @@ void schedule_sim_sysclock(int simulation_cycles, int no_cores, char *power_trac
 	move_run_to_wait(&wait_q, run_queue, no_cores);
 
 	//Exit Hotspot
-	hotspot_exit();
+	hotspot_exit(thermal);
 
 	// Free all the memory allocated
 	free(core_power);
@@ -77,15 +77,21 @@ thermal_config_t default_thermal_config(void)
 	
 	config.leakage_used = 0;
 	config.leakage_mode = 0;
+	config.leakage_accel = 1;
 	
 	config.package_model_used = 0;
 	strcpy(config.package_config_file, NULLFILE);	
 	
 	/* set block model as default	*/
 	strcpy(config.model_type, BLOCK_MODEL_STR);
+	/* adaptive rk4 transient solver	*/
+	strcpy(config.transient_method, TRANSIENT_RK4_STR);
+	config.implicit_steps = 1;
 
 	/* block model specific parameters	*/
 	config.block_omit_lateral = FALSE;	/* omit lateral chip resistances?	*/
+	config.block_lti_used = FALSE;		/* exact exponential transient solver?	*/
+	config.block_modal_modes = 0;		/* reduced-order transient model?	*/
 
 	/* grid model specific parameters	*/
 	config.grid_rows = 64;				/* grid resolution - no. of rows	*/
@@ -100,6 +106,10 @@ thermal_config_t default_thermal_config(void)
 	 * grid cell as that of the entire block
 	 */
 	strcpy(config.grid_map_mode, GRID_CENTER_STR);
+	/* Gauss-Seidel steady state solver	*/
+	strcpy(config.grid_steady_solver, GRID_SOLVER_GS_STR);
+	config.grid_sor_omega = 1.8;
+	strcpy(config.grid_pcg_precond, PCG_PRECOND_MG_STR);
 
 	config.detailed_3D_used = 0;	//BU_3D: by default detailed 3D modeling is disabled.	
 	return config;
@@ -229,12 +239,21 @@ void thermal_config_add_from_strs(thermal_config_t *config, str_pair *table, int
 	if ((idx = get_str_index(table, size, "model_type")) >= 0)
 		if(sscanf(table[idx].value, "%s", config->model_type) != 1)
 			fatal("invalid format for configuration  parameter model_type\n");
+	if ((idx = get_str_index(table, size, "transient_method")) >= 0)
+		if(sscanf(table[idx].value, "%s", config->transient_method) != 1)
+			fatal("invalid format for configuration  parameter transient_method\n");
+	if ((idx = get_str_index(table, size, "implicit_steps")) >= 0)
+		if(sscanf(table[idx].value, "%d", &config->implicit_steps) != 1)
+			fatal("invalid format for configuration  parameter implicit_steps\n");
 		if ((idx = get_str_index(table, size, "leakage_used")) >= 0) 
 		if(sscanf(table[idx].value, "%d", &config->leakage_used) != 1)
 			fatal("invalid format for configuration  parameter leakage_used\n");
 	if ((idx = get_str_index(table, size, "leakage_mode")) >= 0) 
 		if(sscanf(table[idx].value, "%d", &config->leakage_mode) != 1)
 			fatal("invalid format for configuration  parameter leakage_mode\n");
+	if ((idx = get_str_index(table, size, "leakage_accel")) >= 0) 
+		if(sscanf(table[idx].value, "%d", &config->leakage_accel) != 1)
+			fatal("invalid format for configuration  parameter leakage_accel\n");
 	if ((idx = get_str_index(table, size, "package_model_used")) >= 0) 
 		if(sscanf(table[idx].value, "%d", &config->package_model_used) != 1)
 			fatal("invalid format for configuration  parameter package_model_used\n");
@@ -244,6 +263,12 @@ void thermal_config_add_from_strs(thermal_config_t *config, str_pair *table, int
 	if ((idx = get_str_index(table, size, "block_omit_lateral")) >= 0)
 		if(sscanf(table[idx].value, "%d", &config->block_omit_lateral) != 1)
 			fatal("invalid format for configuration  parameter block_omit_lateral\n");
+	if ((idx = get_str_index(table, size, "block_lti_used")) >= 0)
+		if(sscanf(table[idx].value, "%d", &config->block_lti_used) != 1)
+			fatal("invalid format for configuration  parameter block_lti_used\n");
+	if ((idx = get_str_index(table, size, "block_modal_modes")) >= 0)
+		if(sscanf(table[idx].value, "%d", &config->block_modal_modes) != 1)
+			fatal("invalid format for configuration  parameter block_modal_modes\n");
 	if ((idx = get_str_index(table, size, "grid_rows")) >= 0)
 		if(sscanf(table[idx].value, "%d", &config->grid_rows) != 1)
 			fatal("invalid format for configuration  parameter grid_rows\n");
@@ -259,6 +284,15 @@ void thermal_config_add_from_strs(thermal_config_t *config, str_pair *table, int
 	if ((idx = get_str_index(table, size, "grid_map_mode")) >= 0)
 		if(sscanf(table[idx].value, "%s", config->grid_map_mode) != 1)
 			fatal("invalid format for configuration  parameter grid_map_mode\n");
+	if ((idx = get_str_index(table, size, "grid_steady_solver")) >= 0)
+		if(sscanf(table[idx].value, "%s", config->grid_steady_solver) != 1)
+			fatal("invalid format for configuration  parameter grid_steady_solver\n");
+	if ((idx = get_str_index(table, size, "grid_sor_omega")) >= 0)
+		if(sscanf(table[idx].value, "%lf", &config->grid_sor_omega) != 1)
+			fatal("invalid format for configuration  parameter grid_sor_omega\n");
+	if ((idx = get_str_index(table, size, "grid_pcg_precond")) >= 0)
+		if(sscanf(table[idx].value, "%s", config->grid_pcg_precond) != 1)
+			fatal("invalid format for configuration  parameter grid_pcg_precond\n");
 	
 	if ((config->t_chip <= 0) || (config->s_sink <= 0) || (config->t_sink <= 0) || 
 		(config->s_spreader <= 0) || (config->t_spreader <= 0) || 
@@ -283,6 +317,20 @@ void thermal_config_add_from_strs(thermal_config_t *config, str_pair *table, int
 	if (strcasecmp(config->model_type, BLOCK_MODEL_STR) &&
 		strcasecmp(config->model_type, GRID_MODEL_STR))
 		fatal("invalid model type. use 'block' or 'grid'\n");
+	/* validates transient_method	*/
+	get_transient_method(config);
+	if (config->implicit_steps <= 0)
+		fatal("implicit_steps should be greater than zero\n");
+	/* the block model's exact and reduced-order solvers replace
+	 * the transient method. so, only one of them can be chosen
+	 */
+	if (!strcasecmp(config->model_type, BLOCK_MODEL_STR)) {
+		if (config->block_lti_used && config->block_modal_modes > 0)
+			fatal("block_lti_used and block_modal_modes cannot be used together\n");
+		if ((config->block_lti_used || config->block_modal_modes > 0) &&
+			get_transient_method(config) != TRANSIENT_RK4)
+			fatal("transient_method cannot be used with block_lti_used or block_modal_modes\n");
+	}
 	if(config->grid_rows <= 0 || config->grid_cols <= 0)
 		fatal("grid rows and columns should both be greater than zero\n");
 	if (strcasecmp(config->grid_map_mode, GRID_AVG_STR) &&
@@ -290,6 +338,12 @@ void thermal_config_add_from_strs(thermal_config_t *config, str_pair *table, int
 		strcasecmp(config->grid_map_mode, GRID_MAX_STR) &&
 		strcasecmp(config->grid_map_mode, GRID_CENTER_STR))
 		fatal("invalid mapping mode. use 'avg', 'min', 'max' or 'center'\n");
+	/* validates grid_steady_solver	*/
+	get_grid_steady_solver(config);
+	if (config->grid_sor_omega <= 0 || config->grid_sor_omega >= 2)
+		fatal("grid_sor_omega should be between 0 and 2\n");
+	/* validates grid_pcg_precond	*/
+	get_grid_pcg_precond(config);
 }
 
 /* 
@@ -298,7 +352,7 @@ void thermal_config_add_from_strs(thermal_config_t *config, str_pair *table, int
  */
 int thermal_config_to_strs(thermal_config_t *config, str_pair *table, int max_entries)
 {
-	if (max_entries < 49)
+	if (max_entries < 57)
 		fatal("not enough entries in table\n");
 
 	sprintf(table[0].name, "t_chip");
@@ -340,16 +394,24 @@ int thermal_config_to_strs(thermal_config_t *config, str_pair *table, int max_en
 	sprintf(table[36].name, "base_proc_freq");
 	sprintf(table[37].name, "dtm_used");
 	sprintf(table[38].name, "model_type");
-	sprintf(table[39].name, "leakage_used");
-	sprintf(table[40].name, "leakage_mode");
-	sprintf(table[41].name, "package_model_used");
-	sprintf(table[42].name, "package_config_file");
-	sprintf(table[43].name, "block_omit_lateral");
-	sprintf(table[44].name, "grid_rows");
-	sprintf(table[45].name, "grid_cols");
-	sprintf(table[46].name, "grid_layer_file");
-	sprintf(table[47].name, "grid_steady_file");
-	sprintf(table[48].name, "grid_map_mode");
+	sprintf(table[39].name, "transient_method");
+	sprintf(table[40].name, "implicit_steps");
+	sprintf(table[41].name, "leakage_used");
+	sprintf(table[42].name, "leakage_mode");
+	sprintf(table[43].name, "leakage_accel");
+	sprintf(table[44].name, "package_model_used");
+	sprintf(table[45].name, "package_config_file");
+	sprintf(table[46].name, "block_omit_lateral");
+	sprintf(table[47].name, "block_lti_used");
+	sprintf(table[48].name, "block_modal_modes");
+	sprintf(table[49].name, "grid_rows");
+	sprintf(table[50].name, "grid_cols");
+	sprintf(table[51].name, "grid_layer_file");
+	sprintf(table[52].name, "grid_steady_file");
+	sprintf(table[53].name, "grid_map_mode");
+	sprintf(table[54].name, "grid_steady_solver");
+	sprintf(table[55].name, "grid_sor_omega");
+	sprintf(table[56].name, "grid_pcg_precond");
 
 	sprintf(table[0].value, "%lg", config->t_chip);
 	sprintf(table[1].value, "%lg", config->k_chip);
@@ -390,18 +452,67 @@ int thermal_config_to_strs(thermal_config_t *config, str_pair *table, int max_en
 	sprintf(table[36].value, "%lg", config->base_proc_freq);
 	sprintf(table[37].value, "%d", config->dtm_used);
 	sprintf(table[38].value, "%s", config->model_type);
-	sprintf(table[39].value, "%d", config->leakage_used);
-	sprintf(table[40].value, "%d", config->leakage_mode);
-	sprintf(table[41].value, "%d", config->package_model_used);
-	sprintf(table[42].value, "%s", config->package_config_file);
-	sprintf(table[43].value, "%d", config->block_omit_lateral);
-	sprintf(table[44].value, "%d", config->grid_rows);
-	sprintf(table[45].value, "%d", config->grid_cols);
-	sprintf(table[46].value, "%s", config->grid_layer_file);
-	sprintf(table[47].value, "%s", config->grid_steady_file);
-	sprintf(table[48].value, "%s", config->grid_map_mode);
+	sprintf(table[39].value, "%s", config->transient_method);
+	sprintf(table[40].value, "%d", config->implicit_steps);
+	sprintf(table[41].value, "%d", config->leakage_used);
+	sprintf(table[42].value, "%d", config->leakage_mode);
+	sprintf(table[43].value, "%d", config->leakage_accel);
+	sprintf(table[44].value, "%d", config->package_model_used);
+	sprintf(table[45].value, "%s", config->package_config_file);
+	sprintf(table[46].value, "%d", config->block_omit_lateral);
+	sprintf(table[47].value, "%d", config->block_lti_used);
+	sprintf(table[48].value, "%d", config->block_modal_modes);
+	sprintf(table[49].value, "%d", config->grid_rows);
+	sprintf(table[50].value, "%d", config->grid_cols);
+	sprintf(table[51].value, "%s", config->grid_layer_file);
+	sprintf(table[52].value, "%s", config->grid_steady_file);
+	sprintf(table[53].value, "%s", config->grid_map_mode);
+	sprintf(table[54].value, "%s", config->grid_steady_solver);
+	sprintf(table[55].value, "%lg", config->grid_sor_omega);
+	sprintf(table[56].value, "%s", config->grid_pcg_precond);
+
+	return 57;
+}
+
+/* transient solver chosen in the configuration	*/
+int get_transient_method(thermal_config_t *config)
+{
+	if (!strcasecmp(config->transient_method, TRANSIENT_RK4_STR))
+		return TRANSIENT_RK4;
+	else if (!strcasecmp(config->transient_method, TRANSIENT_BE_STR))
+		return TRANSIENT_BE;
+	else if (!strcasecmp(config->transient_method, TRANSIENT_CN_STR))
+		return TRANSIENT_CN;
+	else if (!strcasecmp(config->transient_method, TRANSIENT_TRBDF2_STR))
+		return TRANSIENT_TRBDF2;
+	else if (!strcasecmp(config->transient_method, TRANSIENT_ADI_STR))
+		return TRANSIENT_ADI;
+	fatal("invalid transient method. use 'rk4', 'be', 'cn', 'trbdf2' or 'adi'\n");
+	return TRANSIENT_RK4;
+}
 
-	return 49;
+/* steady state grid solver chosen in the configuration	*/
+int get_grid_steady_solver(thermal_config_t *config)
+{
+	if (!strcasecmp(config->grid_steady_solver, GRID_SOLVER_GS_STR))
+		return GRID_SOLVER_GS;
+	else if (!strcasecmp(config->grid_steady_solver, GRID_SOLVER_RBSOR_STR))
+		return GRID_SOLVER_RBSOR;
+	else if (!strcasecmp(config->grid_steady_solver, GRID_SOLVER_PCG_STR))
+		return GRID_SOLVER_PCG;
+	fatal("invalid grid steady state solver. use 'gs', 'rbsor' or 'pcg'\n");
+	return GRID_SOLVER_GS;
+}
+
+/* preconditioner of the pcg grid solver chosen in the configuration	*/
+int get_grid_pcg_precond(thermal_config_t *config)
+{
+	if (!strcasecmp(config->grid_pcg_precond, PCG_PRECOND_JACOBI_STR))
+		return PCG_PRECOND_JACOBI;
+	else if (!strcasecmp(config->grid_pcg_precond, PCG_PRECOND_MG_STR))
+		return PCG_PRECOND_MG;
+	fatal("invalid pcg preconditioner. use 'jacobi' or 'mg'\n");
+	return PCG_PRECOND_MG;
 }
 
 /* package parameter routines	*/
@@ -601,107 +712,150 @@ void populate_C_model(RC_model_t *model, flp_t *flp)
 	else fatal("unknown model type\n");	
 }
 
-/* steady state temperature	*/
-void steady_state_temp(RC_model_t *model, double *power, double *temp) 
+/* steady state temperature without the temperature-leakage loop	*/
+static void steady_state_temp_once(RC_model_t *model, double *power, double *temp)
 {
-//	if (model->type == BLOCK_MODEL)
-//		steady_state_temp_block(model->block, power, temp);
-//	else if (model->type == GRID_MODEL)	
-//		steady_state_temp_grid(model->grid, power, temp);
-//	else fatal("unknown model type\n");	
+	if (model->type == BLOCK_MODEL)
+		steady_state_temp_block(model->block, power, temp);
+	else if (model->type == GRID_MODEL)	
+		steady_state_temp_grid(model->grid, power, temp);
+	else fatal("unknown model type\n");	
+}
 
+/* 
+ * steady state temperature. with the temperature-leakage loop,
+ * the block temperatures T are the fixed point of T = g(T),
+ * where g solves for the steady state with the power dissipation
+ * plus the leakage at T. the plain iteration T = g(T) converges
+ * only as fast as the loop gain (the leakage increase due to 
+ * the temperature rise it causes) decays. the accelerated one
+ * (leakage_accel) mixes the last few iterates (Anderson 
+ * acceleration) and needs much fewer steady state solves. the
+ * grid model also starts each of those from the previous
+ * solution instead of from scratch
+ */
+void steady_state_temp(RC_model_t *model, double *power, double *temp) 
+{
 	int leak_convg_true = 0;
 	int leak_iter = 0;
-	int n, base=0;
-	//int idx=0;
-	double blk_height, blk_width;
+	int n = 0, base=0;
 	int i, j, k;
 	
-	double *d_temp = NULL;
-	double *temp_old = NULL;
+	/* the blocks that leak: their indices and dimensions	*/
+	int *idx = NULL;
+	double *blk_height = NULL, *blk_width = NULL;
+	/* their temperatures - current iterate and its image under g	*/
+	double *x = NULL, *g = NULL;
 	double *power_new = NULL;
 	double d_max=0.0;
+	/* iterations after which a large rise means thermal runaway	*/
+	int runaway_iter = 0;
+	anderson_workspace_t *aa = NULL;
 	
+	/* if leakage-temperature loop is not considered	*/
+	if (!model->config->leakage_used) {
+		steady_state_temp_once(model, power, temp);
+		return;
+	}
+
 	if (model->type == BLOCK_MODEL) {
 		n = model->block->flp->n_units;
-		if (model->config->leakage_used) { // if considering leakage-temperature loop
-			d_temp = hotspot_vector(model);
-			temp_old = hotspot_vector(model);
-			power_new = hotspot_vector(model);
-			for (leak_iter=0;(!leak_convg_true)&&(leak_iter<=LEAKAGE_MAX_ITER);leak_iter++){
-				for(i=0; i < n; i++) {
-					blk_height = model->block->flp->units[i].height;
-					blk_width = model->block->flp->units[i].width;
-					power_new[i] = power[i] + calc_leakage(model->config->leakage_mode,blk_height,blk_width,temp[i]);
-					temp_old[i] = temp[i]; //copy temp before update
-				}
-				steady_state_temp_block(model->block, power_new, temp); // update temperature
-				d_max = 0.0;
-				for(i=0; i < n; i++) {
-					d_temp[i] = temp[i] - temp_old[i]; //temperature increase due to leakage
-					if (d_temp[i]>d_max) {
-						d_max = d_temp[i];
-					}
-				}
-				if (d_max < LEAK_TOL) {// check convergence
-					leak_convg_true = 1;
-				}
-				if (d_max > TEMP_HIGH && leak_iter > 1) {// check to make sure d_max is not "nan" (esp. in natural convection)
-					fatal("temperature is too high, possible thermal runaway. Double-check power inputs and package settings.\n");
-				}
-			}
-			free(d_temp);
-			free(temp_old);
-			free(power_new);
-			/* if no convergence after max number of iterations, thermal runaway */
-			if (!leak_convg_true)
-				fatal("too many iterations before temperature-leakage convergence -- possible thermal runaway\n");
-		} else // if leakage-temperature loop is not considered
-			steady_state_temp_block(model->block, power, temp);
-	}
-	else if (model->type == GRID_MODEL)	{
-		if (model->config->leakage_used) { // if considering leakage-temperature loop
-			d_temp = hotspot_vector(model);
-			temp_old = hotspot_vector(model);
-			power_new = hotspot_vector(model);
-			for (leak_iter=0;(!leak_convg_true)&&(leak_iter<=LEAKAGE_MAX_ITER);leak_iter++){
-				for(k=0, base=0; k < model->grid->n_layers; k++) {
-					if(model->grid->layers[k].has_power)
-						for(j=0; j < model->grid->layers[k].flp->n_units; j++) {
-							blk_height = model->grid->layers[k].flp->units[j].height;
-							blk_width = model->grid->layers[k].flp->units[j].width;
-							power_new[base+j] = power[base+j] + calc_leakage(model->config->leakage_mode,blk_height,blk_width,temp[base+j]);
-							temp_old[base+j] = temp[base+j]; //copy temp before update
-						}
-					base += model->grid->layers[k].flp->n_units;	
-				}
-				steady_state_temp_grid(model->grid, power_new, temp);
-				d_max = 0.0;
-				for(k=0, base=0; k < model->grid->n_layers; k++) {
-					if(model->grid->layers[k].has_power)
-						for(j=0; j < model->grid->layers[k].flp->n_units; j++) {
-							d_temp[base+j] = temp[base+j] - temp_old[base+j]; //temperature increase due to leakage
-							if (d_temp[base+j]>d_max)
-								d_max = d_temp[base+j];
-						}
-					base += model->grid->layers[k].flp->n_units;	
-				}
-				if (d_max < LEAK_TOL) {// check convergence
-					leak_convg_true = 1;
-				}
-				if (d_max > TEMP_HIGH && leak_iter > 0) {// check to make sure d_max is not "nan" (esp. in natural convection)
-					fatal("temperature is too high, possible thermal runaway. Double-check power inputs and package settings.\n");
+		runaway_iter = 1;
+		idx = ivector(n);
+		blk_height = dvector(n);
+		blk_width = dvector(n);
+		for(i=0; i < n; i++) {
+			idx[i] = i;
+			blk_height[i] = model->block->flp->units[i].height;
+			blk_width[i] = model->block->flp->units[i].width;
+		}
+	} else if (model->type == GRID_MODEL) {
+		idx = ivector(model->grid->total_n_blocks);
+		blk_height = dvector(model->grid->total_n_blocks);
+		blk_width = dvector(model->grid->total_n_blocks);
+		for(k=0, base=0; k < model->grid->n_layers; k++) {
+			if(model->grid->layers[k].has_power)
+				for(j=0; j < model->grid->layers[k].flp->n_units; j++, n++) {
+					idx[n] = base+j;
+					blk_height[n] = model->grid->layers[k].flp->units[j].height;
+					blk_width[n] = model->grid->layers[k].flp->units[j].width;
 				}
+			base += model->grid->layers[k].flp->n_units;	
+		}
+	} else fatal("unknown model type\n");	
+
+	x = dvector(n);
+	g = dvector(n);
+	power_new = hotspot_vector(model);
+	if (model->config->leakage_accel)
+		aa = alloc_anderson_workspace(n, LEAKAGE_ACCEL_DEPTH);
+
+	/* start from the temperatures passed in	*/
+	for(i=0; i < n; i++)
+		x[i] = temp[idx[i]];
+
+	for (leak_iter=0;(!leak_convg_true)&&(leak_iter<=LEAKAGE_MAX_ITER);leak_iter++){
+		for(i=0; i < n; i++)
+			power_new[idx[i]] = power[idx[i]] + calc_leakage(model->config->leakage_mode,blk_height[i],blk_width[i],x[i]);
+		/* grid model: warm start from the previous iteration	*/
+		if (model->type == GRID_MODEL && model->config->leakage_accel)
+			model->grid->steady_warm = (leak_iter > 0);
+		steady_state_temp_once(model, power_new, temp); // update temperature
+		for(i=0; i < n; i++)
+			g[i] = temp[idx[i]];
+
+		if (model->config->leakage_accel)
+			d_max = anderson_step(aa, x, g);
+		else {
+			d_max = 0.0;
+			for(i=0; i < n; i++) {
+				if (g[i] - x[i] > d_max) //temperature increase due to leakage
+					d_max = g[i] - x[i];
+				x[i] = g[i];
 			}
-			free(d_temp);
-			free(temp_old);
-			free(power_new);
-			/* if no convergence after max number of iterations, thermal runaway */
-			if (!leak_convg_true)
-				fatal("too many iterations before temperature-leakage convergence -- possible thermal runaway\n");			
-		} else // if leakage-temperature loop is not considered
-			steady_state_temp_grid(model->grid, power, temp);
+		}
+		if (d_max < LEAK_TOL) {// check convergence
+			leak_convg_true = 1;
+		}
+		if (d_max > TEMP_HIGH && leak_iter > runaway_iter) {// check to make sure d_max is not "nan" (esp. in natural convection)
+			fatal("temperature is too high, possible thermal runaway. Double-check power inputs and package settings.\n");
+		}
 	}
+#if VERBOSE > 1
+	fprintf(stdout, "no. of temperature-leakage iterations: %d\n", leak_iter);
+#endif
+	if (model->type == GRID_MODEL)
+		model->grid->steady_warm = FALSE;
+
+	free_ivector(idx);
+	free_dvector(blk_height);
+	free_dvector(blk_width);
+	free_dvector(x);
+	free_dvector(g);
+	free(power_new);
+	if (aa)
+		free_anderson_workspace(aa);
+	/* if no convergence after max number of iterations, thermal runaway */
+	if (!leak_convg_true)
+		fatal("too many iterations before temperature-leakage convergence -- possible thermal runaway\n");
+}
+
+/* 
+ * steady state temperatures for many power vectors. the block
+ * model solves them together reusing its LUP/Cholesky factors.
+ * the grid model's steady state solver has no factors to share
+ * and the leakage loop is different for every power vector. so,
+ * those are solved one at a time
+ */
+void steady_state_temp_batch(RC_model_t *model, double **power, double **temp, int n)
+{
+	int i;
+
+	if (model->type == BLOCK_MODEL && !model->config->leakage_used)
+		steady_state_temp_batch_block(model->block, power, temp, n);
+	else if (model->type == BLOCK_MODEL || model->type == GRID_MODEL)
+		for (i = 0; i < n; i++)
+			steady_state_temp(model, power[i], temp[i]);
 	else fatal("unknown model type\n");	
 }
 
@@ -715,6 +869,31 @@ void compute_temp(RC_model_t *model, double *power, double *temp, double time_el
 	else fatal("unknown model type\n");	
 }
 
+/* 
+ * compute_temp over n_steps intervals of size 'step' with the same
+ * power. the block model's exact exponential solver keeps its
+ * matrices for 'step' and covers the intervals in a few spans
+ */
+void compute_temp_steps(RC_model_t *model, double *power, double *temp, 
+						double step, int n_steps)
+{
+	if (model->type == BLOCK_MODEL)
+		compute_temp_steps_block(model->block, power, temp, step, n_steps);
+	else if (model->type == GRID_MODEL)	
+		compute_temp_grid(model->grid, power, temp, step * n_steps);
+	else fatal("unknown model type\n");	
+}
+
+/* restart the transient solver from MIN_STEP	*/
+void reset_transient_step(RC_model_t *model)
+{
+	if (model->type == BLOCK_MODEL)
+		reset_transient_step_block(model->block);
+	else if (model->type == GRID_MODEL)	
+		reset_transient_step_grid(model->grid);
+	else fatal("unknown model type\n");	
+}
+
 /* differs from 'dvector()' in that memory for internal nodes is also allocated	*/
 double *hotspot_vector(RC_model_t *model)
 {
@@ -791,6 +970,37 @@ void copy_temp(RC_model_t *model, double *dst, double *src)
 	else fatal("unknown model type\n");	
 }
 
+/* no. of doubles in a snapshot of the transient state	*/
+int thermal_state_size(RC_model_t *model)
+{
+	if (model->type == BLOCK_MODEL)
+		return thermal_state_size_block(model->block);
+	else if (model->type == GRID_MODEL)	
+		return thermal_state_size_grid(model->grid);
+	else fatal("unknown model type\n");	
+	return 0;
+}
+
+/* snapshot the transient state into 'state'	*/
+void save_thermal_state(RC_model_t *model, double *temp, double *state)
+{
+	if (model->type == BLOCK_MODEL)
+		save_thermal_state_block(model->block, temp, state);
+	else if (model->type == GRID_MODEL)	
+		save_thermal_state_grid(model->grid, temp, state);
+	else fatal("unknown model type\n");	
+}
+
+/* go back to a snapshot taken by 'save_thermal_state'	*/
+void restore_thermal_state(RC_model_t *model, double *temp, double *state)
+{
+	if (model->type == BLOCK_MODEL)
+		restore_thermal_state_block(model->block, temp, state);
+	else if (model->type == GRID_MODEL)	
+		restore_thermal_state_grid(model->grid, temp, state);
+	else fatal("unknown model type\n");	
+}
+
 /* 
  * read temperature vector alloced using 'hotspot_vector' from 'file'
  * which was dumped using 'dump_temp'. values are clipped to thermal
@@ -23,9 +23,40 @@
 #define	GRID_MAX_STR	"max"
 #define	GRID_CENTER_STR	"center"
 
+/* steady state grid solver - Gauss-Seidel, red-black SOR or 
+ * preconditioned conjugate gradient
+ */
+#define	GRID_SOLVER_GS			0
+#define	GRID_SOLVER_RBSOR		1
+#define	GRID_SOLVER_PCG			2
+#define	GRID_SOLVER_GS_STR		"gs"
+#define	GRID_SOLVER_RBSOR_STR	"rbsor"
+#define	GRID_SOLVER_PCG_STR		"pcg"
+/* preconditioner of the latter - Jacobi or multigrid V-cycle	*/
+#define	PCG_PRECOND_JACOBI		0
+#define	PCG_PRECOND_MG			1
+#define	PCG_PRECOND_JACOBI_STR	"jacobi"
+#define	PCG_PRECOND_MG_STR		"mg"
+
+/* transient solver - adaptive rk4, one of the implicit methods
+ * or alternating direction implicit (grid model only)
+ */
+#define	TRANSIENT_RK4		0
+#define	TRANSIENT_BE		1
+#define	TRANSIENT_CN		2
+#define	TRANSIENT_TRBDF2	3
+#define	TRANSIENT_ADI		4
+#define	TRANSIENT_RK4_STR		"rk4"
+#define	TRANSIENT_BE_STR		"be"
+#define	TRANSIENT_CN_STR		"cn"
+#define	TRANSIENT_TRBDF2_STR	"trbdf2"
+#define	TRANSIENT_ADI_STR		"adi"
+
 /* temperature-leakage loop constants */
 #define LEAKAGE_MAX_ITER 100 /* max thermal-leakage iteration number, if exceeded, report thermal runaway*/
 #define LEAK_TOL	0.01 /* thermal-leakage temperature convergence criterion */
+#define LEAKAGE_ACCEL_DEPTH	5 /* no. of previous iterates mixed by the accelerated thermal-leakage loop */
+#define ANDERSON_REG	1e-10 /* relative regularization of anderson_step's least squares problem */
 
 /* number of extra nodes due to the model:
  * 4 spreader nodes, 4 heat sink nodes under
@@ -122,6 +153,7 @@
 #define MA_AMD		2 
 #define MA_APPLE	3 
 #define MA_SUN		4 
+#define MA_SIMD		5	/* built-in vector kernels - no BLAS/LAPACK	*/
 
 #if (MATHACCEL == MA_INTEL)
 	#include <mkl_cblas.h>
@@ -133,6 +165,8 @@
 	#include <vecLib/clapack.h>
 #elif (MATHACCEL == MA_SUN)
 	#include <sunperf.h>
+#elif (MATHACCEL == MA_SIMD)
+	#include "simd.h"
 #endif
 
 /* thermal model configuration	*/
@@ -191,10 +225,16 @@ typedef struct thermal_config_t_st
 	int dtm_used;			/* flag to guide the scaling of init Ts	*/
 	/* model type - block or grid */
 	char model_type[STR_SIZE];
+	/* transient solver - rk4, be, cn or trbdf2	*/
+	char transient_method[STR_SIZE];
+	/* no. of equal steps of an implicit solver per call	*/
+	int implicit_steps;
 	
 	/* temperature-leakage loop */
 	int leakage_used;
 	int leakage_mode;
+	/* accelerate the loop's fixed point iteration?	*/
+	int leakage_accel;
 	
 	/* package model */
 	int package_model_used; /* flag to indicate whether package model is used */
@@ -202,6 +242,10 @@ typedef struct thermal_config_t_st
 
 	/* parameters specific to block model	*/
 	int block_omit_lateral;	/* omit lateral resistance?	*/
+	/* exact exponential (discrete LTI) transient solver instead of rk4?	*/
+	int block_lti_used;
+	/* no. of dominant thermal modes of the reduced-order transient model (0 = full model)	*/
+	int block_modal_modes;
 
 	/* parameters specific to grid model	*/
 	int grid_rows;			/* grid resolution - no. of rows	*/
@@ -212,6 +256,12 @@ typedef struct thermal_config_t_st
 	char grid_steady_file[STR_SIZE];
 	/* mapping mode between grid and block models	*/
 	char grid_map_mode[STR_SIZE];
+	/* steady state solver - gs, rbsor or pcg	*/
+	char grid_steady_solver[STR_SIZE];
+	/* over-relaxation factor of rbsor	*/
+	double grid_sor_omega;
+	/* preconditioner of pcg - jacobi or mg	*/
+	char grid_pcg_precond[STR_SIZE];
 	
 	int detailed_3D_used; //BU_3D: Added parameter to check for heterogenous R-C model 
 }thermal_config_t;
@@ -228,6 +278,12 @@ void thermal_config_add_from_strs(thermal_config_t *config, str_pair *table, int
  * of parameters converted
  */
 int thermal_config_to_strs(thermal_config_t *config, str_pair *table, int max_entries);
+/* transient solver (TRANSIENT_*) chosen in 'config'	*/
+int get_transient_method(thermal_config_t *config);
+/* steady state grid solver (GRID_SOLVER_*) chosen in 'config'	*/
+int get_grid_steady_solver(thermal_config_t *config);
+/* preconditioner of the pcg grid solver (PCG_PRECOND_*) chosen in 'config'	*/
+int get_grid_pcg_precond(thermal_config_t *config);
 
 /* package parameters	*/
 typedef struct package_RC_t_st
@@ -334,8 +390,26 @@ void populate_package_C(package_RC_t *p, thermal_config_t *config, double width,
 /* debug print	*/
 void debug_print_package_RC(package_RC_t *p);
 
+/* scratch space of the transient solver, preallocated by the thermal models	*/
+typedef struct rk4_workspace_t_st
+{
+	/* max. no. of equations	*/
+	int n;
+	/* slopes and trial points of rk4_core	*/
+	double *k1, *k2, *k3, *k4, *t;
+	/* step doubling results of rk4	*/
+	double *t1, *t2, *ytemp;
+	/* free for use by the slope functions	*/
+	double *scratch;
+}rk4_workspace_t;
+
 /* slope function pointer - used as a call back by the transient solver	*/
-typedef void (*slope_fn_ptr)(void *model, void *y, void *p, void *dy);
+typedef void (*slope_fn_ptr)(void *model, void *y, void *p, void *dy, rk4_workspace_t *ws);
+/* 
+ * backward Euler solve - used as a call back by the implicit 
+ * transient solvers. solves (A/h + B) y1 = A/h y0 + p
+ */
+typedef void (*implicit_fn_ptr)(void *model, double *y0, void *p, double *y1, double h);
 
 /* hotspot thermal model - can be a block or grid model	*/
 struct block_model_t_st;
@@ -363,7 +437,26 @@ void populate_C_model(RC_model_t *model, flp_t *flp);
 
 /* hotspot main interfaces - temperature.c	*/
 void steady_state_temp(RC_model_t *model, double *power, double *temp);
+/* 
+ * steady state temperatures temp[i] for 'n' power vectors power[i]
+ * of the same floorplan. each of them should be alloced using 
+ * hotspot_vector
+ */
+void steady_state_temp_batch(RC_model_t *model, double **power, double **temp, int n);
 void compute_temp(RC_model_t *model, double *power, double *temp, double time_elapsed);
+/* 
+ * the above over n_steps intervals of size 'step' with the same 
+ * power. the block model's exact exponential solver does it in a
+ * few matrix-vector products without recomputing its matrices
+ */
+void compute_temp_steps(RC_model_t *model, double *power, double *temp, 
+						double step, int n_steps);
+/* 
+ * compute_temp resumes with the step size the transient solver 
+ * settled on in its previous call. restart it from MIN_STEP instead
+ * (e.g. after a discontinuous change in power)
+ */
+void reset_transient_step(RC_model_t *model);
 /* differs from 'dvector()' in that memory for internal nodes is also allocated	*/
 double *hotspot_vector(RC_model_t *model);
 /* copy 'src' to 'dst' except for a window of 'size'
@@ -378,6 +471,17 @@ void set_temp (RC_model_t *model, double *temp, double val);
 void dump_temp (RC_model_t *model, double *temp, char *file);
 void copy_temp (RC_model_t *model, double *dst, double *src);
 void read_temp (RC_model_t *model, double *temp, char *file, int clip);
+/* 
+ * snapshot of the transient state (temperatures of all the nodes 
+ * including the grid cells and the package, and the step size of
+ * the transient solver) in a caller-allocated array of 
+ * thermal_state_size() doubles. 'temp' is the vector passed to
+ * compute_temp. restoring it lets compute_temp resume from the
+ * snapshot, e.g. to try out alternatives from the same point
+ */
+int thermal_state_size(RC_model_t *model);
+void save_thermal_state(RC_model_t *model, double *temp, double *state);
+void restore_thermal_state(RC_model_t *model, double *temp, double *state);
 void dump_power(RC_model_t *model, double *power, char *file);
 void read_power (RC_model_t *model, double *power, char *file);
 double find_max_temp(RC_model_t *model, double *temp);
@@ -396,9 +500,42 @@ double getcap(double sp_heat, double thickness, double area);
 
 /* LU forward and backward substitution	*/
 void lusolve(double **a, int n, int *p, double *b, double *x, int spd);
+/* same as above for 'nrhs' right hand sides - one per row of b and x	*/
+void lusolve_batch(double **a, int n, int *p, double **b, double **x, int nrhs, int spd);
+
+/* Cholesky decomposition and solve - used by the above when spd is set	*/
+void choldcmp(double **a, int n);
+void cholsolve(double **a, int n, double *b, double *x);
 
 /* 4th order Runge Kutta solver with adaptive step sizing */
-double rk4(void *model, double *y, void *p, int n, double *h, double *yout, slope_fn_ptr f);
+double rk4(void *model, double *y, void *p, int n, double *h, double *yout, slope_fn_ptr f,
+		   rk4_workspace_t *ws);
+rk4_workspace_t *alloc_rk4_workspace(int n);
+void free_rk4_workspace(rk4_workspace_t *ws);
+/* one step of an implicit (BE/CN/TR-BDF2) solver	*/
+void implicit_step(void *model, double *y, void *p, int n, double h, int method,
+				   implicit_fn_ptr f, rk4_workspace_t *ws);
+
+/* history of the Anderson accelerated fixed point iteration	*/
+typedef struct anderson_workspace_t_st
+{
+	int n;				/* no. of unknowns	*/
+	int m;				/* max. no. of previous iterates used	*/
+	int k;				/* no. of iterates so far	*/
+	/* m x n. differences of successive residuals 
+	 * (f = g(x) - x) and g(x)'s. circular
+	 */
+	double **df, **dg;
+	double *f, *f_old, *g_old;
+	/* least squares problem	*/
+	double **ftf;
+	int *p;
+	double *ftr, *gamma;
+}anderson_workspace_t;
+anderson_workspace_t *alloc_anderson_workspace(int n, int m);
+void free_anderson_workspace(anderson_workspace_t *ws);
+/* replaces x by the next iterate given g = g(x). returns max|g - x|	*/
+double anderson_step(anderson_workspace_t *ws, double *x, double *g);
 
 /* matrix and vector routines	*/
 void matmult(double **c, double **a, double **b, int n);
@@ -413,9 +550,55 @@ void diagmatvectmult(double *vout, double *m, double *vin, int n);
  * and positive definite 
  */
 void matinv(double **inv, double **m, int n, int spd);
+/* e = exp(scale * m), e, m are n by n matrices	*/
+void matexp(double **e, double **m, double scale, int n);
+/* eigenvalues (ascending) and eigenvectors of a symmetric matrix	*/
+void symeig(double **a, int n, double *w, double **v);
 
 /* dst = src1 + scale * src2	*/
 void scaleadd_dvector (double *dst, double *src1, double *src2, int n, double scale);
+/* returns x . y	*/
+double dot_dvector (double *x, double *y, int n);
+
+/* sparse matrix in compressed sparse row (CSR) format. square
+ * except for the block-grid maps of the grid model
+ */
+typedef struct sparse_matrix_t_st
+{
+	int n;			/* no. of rows (and columns)	*/
+	int nnz;		/* no. of non-zeros	*/
+	int max_nnz;	/* space allocated for the non-zeros	*/
+	/* non-zeros of row i are at indices row_ptr[i] to row_ptr[i+1]-1	*/
+	int *row_ptr;
+	int *col_idx;	/* column of each non-zero	*/
+	double *val;	/* value of each non-zero	*/
+}sparse_matrix_t;
+
+/* sparse matrix routines. 'n' is the max. no. of rows	*/
+sparse_matrix_t *alloc_sparse_matrix(int n);
+void free_sparse_matrix(sparse_matrix_t *m);
+/* make room for 'nnz' non-zeros	*/
+void reserve_sparse_matrix(sparse_matrix_t *m, int nnz);
+/* s = m, where m is an n x n dense matrix	*/
+void dense_to_sparse(sparse_matrix_t *s, double **m, int n);
+/* m = s, where m is an n x n dense matrix	*/
+void sparse_to_dense(double **m, sparse_matrix_t *s);
+/* same as diagmatmult but 'b' and 'c' are sparse	*/
+void sparse_diagmatmult(sparse_matrix_t *c, double *a, sparse_matrix_t *b);
+/* same as matvectmult but 'm' is sparse	*/
+void sparse_matvectmult(double *vout, sparse_matrix_t *m, double *vin);
+/* no. of scratch vectors of sparse_pcg	*/
+#define SPARSE_PCG_N_VECTORS	5
+/* incomplete Cholesky factor of a symmetric positive definite 'm'	*/
+void sparse_ichol(sparse_matrix_t *l, sparse_matrix_t *m);
+/* preconditioned conjugate gradient solve of m * x = b for a 
+ * symmetric positive definite 'm' with the incomplete Cholesky 
+ * factor 'l' (or the diagonal if NULL) of 'm'. returns the no. 
+ * of iterations
+ */
+int sparse_pcg(sparse_matrix_t *m, sparse_matrix_t *l, double *b, double *x, 
+			   double **work, double tol, int max_iter);
+void dump_sparse_matrix(sparse_matrix_t *m);
 
 /* temperature-aware leakage calculation */
 double calc_leakage(int mode, double h, double w, double temp);
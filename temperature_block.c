@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #ifdef _MSC_VER
 #define strcasecmp    _stricmp
 #define strncasecmp   _strnicmp
@@ -21,6 +22,7 @@ block_model_t *alloc_block_model(thermal_config_t *config, flp_t *placeholder)
 	/* shortcuts	*/
 	int n = placeholder->n_units;
 	int m = NL*n+EXTRA;
+	int i;
 
 	block_model_t *model = (block_model_t *) calloc (1, sizeof(block_model_t));
 	if (!model)
@@ -43,14 +45,50 @@ block_model_t *alloc_block_model(thermal_config_t *config, flp_t *placeholder)
 	/* vertical conductances to ambient	*/
 	model->g_amb = dvector(n+EXTRA);
 	model->t_vector = dvector(m);/* scratch pad	*/
-	model->p = ivector(m);		/* permutation vector for b's LUP decomposition	*/
 
 	model->a = dvector(m);		/* vertical Cs - diagonal matrix stored as a 1-d vector	*/
 	model->inva = dvector(m);	/* inverse of the above 	*/
-	/* B, C and LU are (NL*n+EXTRA)x(NL*n+EXTRA) matrices	*/
-	model->b = dmatrix(m, m);
-	model->c = dmatrix(m, m);
-	model->lu = dmatrix(m, m);
+	/* B and C are (NL*n+EXTRA)x(NL*n+EXTRA) sparse matrices	*/
+	model->b_csr = alloc_sparse_matrix(m);
+	model->b_ic = alloc_sparse_matrix(m);
+	model->c_csr = alloc_sparse_matrix(m);
+	for (i = 0; i < SPARSE_PCG_N_VECTORS; i++)
+		model->pcg_vectors[i] = dvector(m);
+
+	/* exact exponential transient solver's matrices	*/
+	if (model->config.block_lti_used) {
+		model->lti_phi = dmatrix(m, m);
+		model->lti_gamma = dmatrix(m, m);
+		model->lti_vector = dvector(m);
+		model->lti_gp = dvector(m);
+		model->lti_p = dvector(m);
+	}
+
+	/* reduced-order modal model's matrices	*/
+	if (model->config.block_modal_modes > 0) {
+		model->modal_k = MIN(model->config.block_modal_modes, m);
+		model->modal_lambda = dvector(model->modal_k);
+		model->modal_proj = dmatrix(model->modal_k, m);
+		model->modal_out = dmatrix(m, model->modal_k);
+		model->modal_static = dmatrix(m, n);
+		model->modal_base = dvector(m);
+		model->modal_bound = dvector(m+1);
+		model->modal_decay = dvector(model->modal_k);
+		model->modal_gain = dvector(model->modal_k);
+		model->modal_z = dvector(model->modal_k);
+	}
+
+	/* implicit transient solvers' (A/h + B)	*/
+	model->transient_method = get_transient_method(&model->config);
+	if (model->transient_method == TRANSIENT_ADI)
+		fatal("the adi transient solver is only available in the grid model\n");
+	if (model->transient_method != TRANSIENT_RK4) {
+		model->impl_csr = alloc_sparse_matrix(m);
+		model->impl_ic = alloc_sparse_matrix(m);
+	}
+
+	model->rk4_h = MIN_STEP;
+	model->rk4_ws = alloc_rk4_workspace(m);
 
 	model->flp = placeholder;
 	return model;
@@ -64,15 +102,14 @@ block_model_t *alloc_block_model(thermal_config_t *config, flp_t *placeholder)
 void populate_R_model_block(block_model_t *model, flp_t *flp)
 {
 	/*	shortcuts	*/
-	double **b = model->b;
+	sparse_matrix_t *b = model->b_csr;
 	double *gx = model->gx, *gy = model->gy;
 	double *gx_int = model->gx_int, *gy_int = model->gy_int;
 	double *gx_sp = model->gx_sp, *gy_sp = model->gy_sp;
 	double *gx_hs = model->gx_hs, *gy_hs = model->gy_hs;
 	double *g_amb = model->g_amb;
-	double **len = model->len, **g = model->g, **lu = model->lu;
+	double **len = model->len, **g = model->g;
 	int **border = model->border;
-	int *p = model->p;
 	double t_chip = model->config.t_chip;
 	double r_convec = model->config.r_convec;
 	double s_sink = model->config.s_sink;
@@ -85,7 +122,7 @@ void populate_R_model_block(block_model_t *model, flp_t *flp)
 	double k_spreader = model->config.k_spreader;
 	double k_interface = model->config.k_interface;
 	
-	int i, j, n = flp->n_units;
+	int i, j, k, d, nnz, n = flp->n_units;
 	double gn_sp=0, gs_sp=0, ge_sp=0, gw_sp=0;
 	double gn_hs=0, gs_hs=0, ge_hs=0, gw_hs=0;
 	double r_amb;
@@ -247,34 +284,49 @@ void populate_R_model_block(block_model_t *model, flp_t *flp)
 	g_amb[n+SINK_N] = g_amb[n+SINK_S] = g_amb[n+SINK_E] =
 					  g_amb[n+SINK_W] = 1.0 / (model->pack.r_hs_per+model->pack.r_amb_per);
 
-	/* calculate matrix B such that BT = POWER in steady state */
-	/* non-diagonal elements	*/
-	for (i = 0; i < NL*n+EXTRA; i++)
-		for (j = 0; j < i; j++)
-			if ((g[i][j] == 0.0) || (g[j][i] == 0.0))
-				b[i][j] = b[j][i] = 0.0;
-			else
+	/* 
+	 * calculate matrix B such that BT = POWER in steady state. 
+	 * each node is connected only to its neighbours. so, B is 
+	 * sparse and is assembled in CSR form one row at a time
+	 */
+	for (i = 0, nnz = 0; i < NL*n+EXTRA; i++)
+		for (j = 0; j < NL*n+EXTRA; j++)
+			if (i == j || (g[i][j] != 0.0 && g[j][i] != 0.0))
+				nnz++;
+	reserve_sparse_matrix(b, nnz);
+	for (i = 0, k = 0; i < NL*n+EXTRA; i++) {
+		b->row_ptr[i] = k;
+		/* the diagonal element's place	*/
+		d = -1;
+		for (j = 0; j < NL*n+EXTRA; j++) {
+			if (i == j) {
+				d = k;
+				b->col_idx[k++] = j;
+			} else if ((g[i][j] != 0.0) && (g[j][i] != 0.0)) {
+				b->col_idx[k] = j;
 				/* here is why the 2.0 factor comes when calculating g[][]	*/
-				b[i][j] = b[j][i] = -1.0/((1.0/g[i][j])+(1.0/g[j][i]));
-	/* diagonal elements	*/			
-	for (i = 0; i < NL*n+EXTRA; i++) {
+				b->val[k++] = -1.0/((1.0/g[i][j])+(1.0/g[j][i]));
+			}
+		}
+		/* diagonal element	*/
 		/* functional blocks in the heat sink layer	*/
 		if (i >= HSINK*n && i < NL*n) 
-			b[i][i] = g_amb[i%n];
+			b->val[d] = g_amb[i%n];
 		/* heat sink peripheral nodes	*/
 		else if (i >= NL*n+SINK_C_W)
-			b[i][i] = g_amb[n+i-NL*n];
+			b->val[d] = g_amb[n+i-NL*n];
 		/* all other nodes that are not connected to the ambient	*/	
 		else
-			b[i][i] = 0.0;
+			b->val[d] = 0.0;
 		/* sum up the conductances	*/	
-		for(j=0; j < NL*n+EXTRA; j++)
-			if (i != j)
-				b[i][i] -= b[i][j];
+		for (j = b->row_ptr[i]; j < k; j++)
+			if (j != d)
+				b->val[d] -= b->val[j];
 	}
+	b->row_ptr[NL*n+EXTRA] = k;
+	b->n = NL*n+EXTRA;
+	b->nnz = nnz;
 
-	/* compute the LUP decomposition of B and store it too	*/
-	copy_dmatrix(lu, b, NL*n+EXTRA, NL*n+EXTRA);
 	/* 
 	 * B is a symmetric positive definite matrix. It is
 	 * symmetric because if a node A is connected to B, 
@@ -285,13 +337,23 @@ void populate_R_model_block(block_model_t *model, flp_t *flp)
 	 * at UCLA: http://www.ee.ucla.edu/~vandenbe/103/chol.pdf
 	 * x^T*B*x = voltage^T * (B*x) = voltage^T * current
 	 * = total power dissipated in the resistors > 0 
-	 * for x != 0. 
+	 * for x != 0. so, the steady state solver can use the
+	 * conjugate gradient method on it. it is also diagonally
+	 * dominant. so, its incomplete Cholesky factor exists
 	 */
-	lupdcmp(lu, NL*n+EXTRA, p, 1);
+	sparse_ichol(model->b_ic, b);
 
 	/* done	*/
 	model->flp = flp;
 	model->r_ready = TRUE;
+	/* phi and gamma depend on b	*/
+	model->lti_h = 0;
+	/* so does (A/h + B)	*/
+	model->impl_h = 0;
+	/* so do the modes	*/
+	model->modal_h = 0;
+	/* so does the stable step size	*/
+	model->rk4_h = MIN_STEP;
 }
 
 /* creates 2 matrices: invA, C: dT + A^-1*BT = A^-1*Power, 
@@ -303,8 +365,7 @@ void populate_R_model_block(block_model_t *model, flp_t *flp)
 void populate_C_model_block(block_model_t *model, flp_t *flp)
 {
 	/*	shortcuts	*/
-	double *inva = model->inva, **c = model->c;
-	double **b = model->b;
+	double *inva = model->inva;
 	double *a = model->a;
 	double t_chip = model->config.t_chip;
 	double c_convec = model->config.c_convec;
@@ -372,10 +433,18 @@ void populate_C_model_block(block_model_t *model, flp_t *flp)
 		inva[i] = 1.0/a[i];
 
 	/* we are always going to use the eqn dT + A^-1 * B T = A^-1 * POWER. so, store  C = A^-1 * B	*/
-	diagmatmult(c, inva, b, NL*n+EXTRA);
+	sparse_diagmatmult(model->c_csr, inva, model->b_csr);
 
 	/*	done	*/
 	model->c_ready = TRUE;
+	/* phi and gamma depend on c	*/
+	model->lti_h = 0;
+	/* so does (A/h + B)	*/
+	model->impl_h = 0;
+	/* so do the modes	*/
+	model->modal_h = 0;
+	/* so does the stable step size	*/
+	model->rk4_h = MIN_STEP;
 }
 
 /* setting package nodes' power numbers	*/
@@ -390,10 +459,11 @@ void set_internal_power_block(block_model_t *model, double *power)
 
 /* power and temp should both be alloced using hotspot_vector. 
  * 'b' is the 'thermal conductance' matrix. i.e, b * temp = power
- *  => temp = invb * power. instead of computing invb, we have
- * stored the LUP decomposition of B in 'lu' and 'p'. Using
- * forward and backward substitution, we can then solve the 
- * equation b * temp = power.
+ *  => temp = invb * power. b is sparse and symmetric positive 
+ * definite (see populate_R_model_block). so, instead of computing 
+ * invb, the equation b * temp = power is solved by the conjugate
+ * gradient method preconditioned with the incomplete Cholesky 
+ * factor of b, starting from the ambient temperature
  */
 void steady_state_temp_block(block_model_t *model, double *power, double *temp) 
 {
@@ -403,42 +473,363 @@ void steady_state_temp_block(block_model_t *model, double *power, double *temp)
 	/* set power numbers for the virtual nodes */
 	set_internal_power_block(model, power);
 
-	/* 
-	 * find temperatures (spd flag is set to 1 by the same argument
-	 * as mentioned in the populate_R_model_block function)
-	 */
-	lusolve(model->lu, model->n_nodes, model->p, power, temp, 1);
+	/* find temperatures	*/
+	set_temp_block(model, temp, model->config.ambient);
+	if (sparse_pcg(model->b_csr, model->b_ic, power, temp, model->pcg_vectors, 
+				   PCG_BLOCK_TOL, PCG_BLOCK_MAX_ITER) >= PCG_BLOCK_MAX_ITER)
+		warning("pcg steady state solver did not converge\n");
+}
+
+/* steady state temperatures temp[i] for 'n' power vectors power[i]	*/
+void steady_state_temp_batch_block(block_model_t *model, double **power, double **temp, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		steady_state_temp_block(model, power[i], temp[i]);
 }
 
 /* compute the slope vector dy for the transient equation 
- * dy + cy = p. useful in the transient solver
+ * dy + cy = p. useful in the transient solver. 'ws' is
+ * the transient solver's workspace
  */
-void slope_fn_block(block_model_t *model, double *y, double *p, double *dy)
+void slope_fn_block(block_model_t *model, double *y, double *p, double *dy, 
+					rk4_workspace_t *ws)
 {
 	/* shortcuts	*/
 	int n = model->n_nodes;
-	double **c = model->c;
-
-	/* for our equation, dy = p - cy */
-	#if (MATHACCEL == MA_INTEL || MATHACCEL == MA_APPLE)
-	/* dy = p	*/
-	cblas_dcopy(n, p, 1, dy, 1);
-	/* dy = dy - c*y = p - c*y */
-	cblas_dgemv(CblasRowMajor, CblasNoTrans, n, n, -1, c[0],
-				n, y, 1, 1, dy, 1);
-	#elif (MATHACCEL == MA_AMD || MATHACCEL == MA_SUN)
-	/* dy = p	*/
-	dcopy(n, p, 1, dy, 1);
-	/* dy = dy - c*y = p - c*y */
-	dgemv('T', n, n, -1, c[0], n, y, 1, 1, dy, 1);
-	#else
 	int i;
-	double *t = dvector(n);
-	matvectmult(t, c, y, n);
+
+	/* 
+	 * for our equation, dy = p - cy. c has only a handful of 
+	 * non-zeros per row. so, a sparse product is much cheaper 
+	 * than dense BLAS here irrespective of the math acceleration
+	 */
+	sparse_matvectmult(dy, model->c_csr, y);
 	for (i = 0; i < n; i++)
-		dy[i] = p[i]-t[i];
-	free_dvector(t);
-	#endif
+		dy[i] = p[i] - dy[i];
+}
+
+/* 
+ * dense LUP decomposition of B for the solvers that need all of 
+ * inv_B. spd flag set by the argument in populate_R_model_block
+ */
+static void lupdcmp_block(block_model_t *model, double **lu, int *p)
+{
+	sparse_to_dense(lu, model->b_csr);
+	lupdcmp(lu, model->n_nodes, p, 1);
+}
+
+/* free the 2^j step spans of the LTI solver	*/
+static void free_lti_pow_block(block_model_t *model)
+{
+	int j;
+
+	for (j = 1; j < model->lti_n_pow; j++) {
+		free_dmatrix(model->lti_phi_pow[j]);
+		free_dmatrix(model->lti_gamma_pow[j]);
+	}
+	model->lti_n_pow = 0;
+}
+
+/* 
+ * compute the matrices of the discrete LTI solver for step size h.
+ * the solution of dT + CT = inv_A * POWER over an interval h with 
+ * constant POWER is T(t+h) = phi * T(t) + gamma * POWER, where 
+ * phi = exp(-C*h) and gamma = C^-1 * (I - phi) * inv_A. since 
+ * C = inv_A * B, C^-1 = inv_B * A. so, each column of gamma is 
+ * found by solving B x = A * (I - phi) * inv_A[j] using the LUP
+ * decomposition of B
+ */
+void populate_lti_model_block(block_model_t *model, double h)
+{
+	/* shortcuts	*/
+	int n = model->n_nodes;
+	double **phi = model->lti_phi, **gamma = model->lti_gamma;
+	double *a = model->a, *inva = model->inva;
+	double *x = model->t_vector, *rhs = model->lti_vector;
+	double **lu = dmatrix(n, n);
+	int *p = ivector(n);
+	int i, j;
+
+	/* phi = exp(-c*h). gamma is free till the end. use it for a dense c	*/
+	sparse_to_dense(gamma, model->c_csr);
+	matexp(phi, gamma, -h, n);
+
+	lupdcmp_block(model, lu, p);
+	for (j = 0; j < n; j++) {
+		/* rhs = A * (I - phi)[j] * inva[j]	*/
+		for (i = 0; i < n; i++)
+			rhs[i] = a[i] * ((i == j) - phi[i][j]) * inva[j];
+		lusolve(lu, n, p, rhs, x, 1);
+		for (i = 0; i < n; i++)
+			gamma[i][j] = x[i];
+	}
+	free_dmatrix(lu);
+	free_ivector(p);
+
+	model->lti_h = h;
+	/* the other spans and gamma * POWER are stale now	*/
+	free_lti_pow_block(model);
+	model->lti_phi_pow[0] = phi;
+	model->lti_gamma_pow[0] = gamma;
+	model->lti_n_pow = 1;
+	model->lti_gp_valid = FALSE;
+}
+
+/* the span of 2^j steps from that of 2^(j-1) steps	*/
+static void populate_lti_pow_block(block_model_t *model, int j)
+{
+	int i, n = model->n_nodes;
+	double **phi = model->lti_phi_pow[j-1], **gamma = model->lti_gamma_pow[j-1];
+
+	model->lti_phi_pow[j] = dmatrix(n, n);
+	model->lti_gamma_pow[j] = dmatrix(n, n);
+	/* phi_j = phi_{j-1}^2, gamma_j = phi_{j-1} * gamma_{j-1} + gamma_{j-1}	*/
+	matmult(model->lti_phi_pow[j], phi, phi, n);
+	matmult(model->lti_gamma_pow[j], phi, gamma, n);
+	for (i = 0; i < n; i++)
+		scaleadd_dvector(model->lti_gamma_pow[j][i], model->lti_gamma_pow[j][i], 
+						 gamma[i], n, 1.0);
+	model->lti_n_pow = j + 1;
+}
+
+/* temp = phi_j * temp + gamma_j * power	*/
+static void lti_span_block(block_model_t *model, double *power, double *temp, int j)
+{
+	int n = model->n_nodes;
+
+	/* each level is built from the one below	*/
+	while (model->lti_n_pow <= j)
+		populate_lti_pow_block(model, model->lti_n_pow);
+	matvectmult(model->t_vector, model->lti_gamma_pow[j], power, n);
+	matvectmult(model->lti_vector, model->lti_phi_pow[j], temp, n);
+	scaleadd_dvector(temp, model->lti_vector, model->t_vector, n, 1.0);
+}
+
+/* 
+ * discrete LTI counterpart of the rk4 loop in compute_temp_block. 
+ * exact for a constant POWER during the interval. phi and gamma
+ * are recomputed only when the step size h changes. n_steps steps
+ * of size h are covered in spans of 2^j steps - i.e., in as many 
+ * spans as there are bits set in n_steps
+ */
+void compute_temp_lti_block(block_model_t *model, double *power, double *temp, 
+							double h, int n_steps)
+{
+	int n = model->n_nodes;
+	int j, k;
+
+	if (model->lti_h != h)
+		populate_lti_model_block(model, h);
+
+	if (n_steps > 1) {
+		for (j = 0, k = n_steps; k; j++, k >>= 1) {
+			/* spans of more than 2^(LTI_MAX_POW-1) steps are repeated	*/
+			if (j == LTI_MAX_POW - 1) {
+				for (; k; k--)
+					lti_span_block(model, power, temp, j);
+				break;
+			}
+			if (k & 1)
+				lti_span_block(model, power, temp, j);
+		}
+		return;
+	}
+
+	/* gamma * power is reused while the power does not change	*/
+	if (!model->lti_gp_valid || memcmp(model->lti_p, power, n * sizeof(double))) {
+		matvectmult(model->lti_gp, model->lti_gamma, power, n);
+		copy_dvector(model->lti_p, power, n);
+		model->lti_gp_valid = TRUE;
+	}
+
+	/* temp = phi * temp + gamma * power	*/
+	matvectmult(model->lti_vector, model->lti_phi, temp, n);
+	scaleadd_dvector(temp, model->lti_vector, model->lti_gp, n, 1.0);
+}
+
+/* 
+ * compute the matrices of the reduced-order modal model for step
+ * size h. with y = sqrt(A) * (T - base), where base is the steady
+ * state temperature with no power dissipation, A dT + B T = POWER
+ * becomes dy + S y = inv_sqrt_A * POWER. S = inv_sqrt_A * B *
+ * inv_sqrt_A is symmetric. so, its eigen decomposition gives 
+ * real decay rates (eigenvalues) and orthonormal mode shapes 
+ * (eigenvectors). only k modes are integrated. the dropped ones
+ * are replaced by their steady state response - the difference 
+ * between the full steady state (inv_B) and that of the k modes.
+ * so, the reduced model's steady state is still exact. 
+ * 
+ * with POWER held constant over each step of size h, a dropped 
+ * mode i with decay d_i = exp(-lambda_i*h) lags its steady state
+ * by d_i times the lag at the previous step. at the sampling 
+ * instants, its error transfer function from silicon power to
+ * silicon temperature is then at most |w_i|^2 / lambda_i * 
+ * 2 * d_i / (1 + d_i) (H-infinity norm, K/W) where w_i is the 
+ * silicon part of inv_sqrt_A * v_i. the modes kept are the ones
+ * with the largest such contribution and the error bound is 
+ * the sum of the contributions of the dropped ones. so, fast
+ * modes (lambda_i * h >> 1) are dropped at no cost while the 
+ * slow package modes are kept only if they are visible from 
+ * the silicon
+ */
+void populate_modal_model_block(block_model_t *model, double h)
+{
+	/* shortcuts	*/
+	int m = model->n_nodes, n = model->n_units, k = model->modal_k;
+	double *a = model->a, *x = model->t_vector;
+	double **s, **v, *w, *sqrta, *rhs, *contrib;
+	double sum, d;
+	int i, j, r, *order, *p;
+
+	if (!model->r_ready || !model->c_ready)
+		fatal("block model not ready\n");
+
+	s = dmatrix(m, m);
+	v = dmatrix(m, m);
+	w = dvector(m);
+	sqrta = dvector(m);
+	rhs = dvector(m);
+	contrib = dvector(m);
+	order = ivector(m);
+	p = ivector(m);
+
+	/* s = inv_sqrt_A * B * inv_sqrt_A	*/
+	for (i = 0; i < m; i++)
+		sqrta[i] = sqrt(a[i]);
+	sparse_to_dense(s, model->b_csr);
+	for (i = 0; i < m; i++)
+		for (j = 0; j < m; j++)
+			s[i][j] = s[i][j] / (sqrta[i] * sqrta[j]);
+	symeig(s, m, w, v);
+
+	/* contribution of each mode to the error bound	*/
+	for (i = 0; i < m; i++) {
+		for (r = 0, sum = 0; r < n; r++)
+			sum += (v[r][i] / sqrta[r]) * (v[r][i] / sqrta[r]);
+		d = exp(-w[i] * h);
+		contrib[i] = sum / w[i] * 2.0 * d / (1.0 + d);
+		order[i] = i;
+	}
+	/* sort the modes in descending order of contribution	*/
+	for (i = 0; i < m-1; i++)
+		for (j = i+1; j < m; j++)
+			if (contrib[order[j]] > contrib[order[i]]) {
+				r = order[i];
+				order[i] = order[j];
+				order[j] = r;
+			}
+
+	/* error bound for each k - suffix sums over the dropped modes	*/
+	model->modal_bound[m] = 0;
+	for (i = m-1; i >= 0; i--)
+		model->modal_bound[i] = model->modal_bound[i+1] + contrib[order[i]];
+
+	/* the k dominant modes and their exact discretization	*/
+	for (i = 0; i < k; i++) {
+		j = order[i];
+		model->modal_lambda[i] = w[j];
+		model->modal_decay[i] = exp(-w[j] * h);
+		model->modal_gain[i] = (1.0 - model->modal_decay[i]) / w[j];
+		for (r = 0; r < m; r++) {
+			model->modal_proj[i][r] = v[r][j] * sqrta[r];
+			model->modal_out[r][i] = v[r][j] / sqrta[r];
+		}
+	}
+
+	/* 
+	 * static correction: column j is inv_B[j] minus the steady
+	 * state of the k modes for a unit power in block j. s is
+	 * free now. use it for the decomposition of B
+	 */
+	lupdcmp_block(model, s, p);
+	for (j = 0; j < n; j++) {
+		zero_dvector(rhs, m);
+		rhs[j] = 1.0;
+		lusolve(s, m, p, rhs, x, 1);
+		for (r = 0; r < m; r++) {
+			for (i = 0, sum = 0; i < k; i++)
+				sum += model->modal_out[r][i] * model->modal_out[j][i] / model->modal_lambda[i];
+			model->modal_static[r][j] = x[r] - sum;
+		}
+	}
+
+	/* base = inv_B * (power of the package nodes alone)	*/
+	zero_dvector(rhs, n);
+	set_internal_power_block(model, rhs);
+	lusolve(s, m, p, rhs, model->modal_base, 1);
+
+	free_dmatrix(s);
+	free_dmatrix(v);
+	free_dvector(w);
+	free_dvector(sqrta);
+	free_dvector(rhs);
+	free_dvector(contrib);
+	free_ivector(order);
+	free_ivector(p);
+
+	model->modal_h = h;
+}
+
+/* 
+ * reduced-order counterpart of compute_temp_block. the modes are
+ * projected out of 'temp', advanced exactly over the interval 
+ * (for a constant POWER) and the full temperature vector is 
+ * then reconstructed from them. the projection is exact for 
+ * a 'temp' reconstructed earlier. so, the k modes are all the
+ * state carried from one call to the next. the matrices are 
+ * recomputed only when the step size changes
+ */
+void compute_temp_modal_block(block_model_t *model, double *power, double *temp, double time_elapsed)
+{
+	/* shortcuts	*/
+	int m = model->n_nodes, n = model->n_units, k = model->modal_k;
+	double **proj = model->modal_proj, **out = model->modal_out;
+	double **stat = model->modal_static, *base = model->modal_base;
+	double *z = model->modal_z;
+	double sum, u;
+	int i, r;
+
+	if (model->modal_h != time_elapsed)
+		populate_modal_model_block(model, time_elapsed);
+
+	/* z(t+h) = exp(-lambda*h) * z(t) + (1 - exp(-lambda*h)) / lambda * u	*/
+	for (i = 0; i < k; i++) {
+		/* project	*/
+		for (r = 0, sum = 0; r < m; r++)
+			sum += proj[i][r] * (temp[r] - base[r]);
+		/* modal power - only the silicon nodes dissipate	*/
+		for (r = 0, u = 0; r < n; r++)
+			u += out[r][i] * power[r];
+		z[i] = model->modal_decay[i] * sum + model->modal_gain[i] * u;
+	}
+
+	/* reconstruct	*/
+	for (r = 0; r < m; r++) {
+		sum = base[r];
+		for (i = 0; i < k; i++)
+			sum += out[r][i] * z[i];
+		for (i = 0; i < n; i++)
+			sum += stat[r][i] * power[i];
+		temp[r] = sum;
+	}
+}
+
+/* 
+ * upper bound on the gain (K/W) from silicon power to the error
+ * in the silicon temperatures of the reduced model with k modes
+ * at step size h
+ */
+double modal_error_bound_block(block_model_t *model, int k, double h)
+{
+	if (!model->modal_k)
+		fatal("reduced-order model not enabled\n");
+	if (k < 0 || k > model->n_nodes)
+		fatal("invalid no. of modes\n");
+	if (model->modal_h != h)
+		populate_modal_model_block(model, h);
+	return model->modal_bound[k];
 }
 
 /* compute_temp: solve for temperature from the equation dT + CT = inv_A * Power 
@@ -448,7 +839,20 @@ void slope_fn_block(block_model_t *model, double *y, double *p, double *dy)
  */
 void compute_temp_block(block_model_t *model, double *power, double *temp, double time_elapsed)
 {
-	double t, h, new_h;
+	compute_temp_steps_block(model, power, temp, time_elapsed, 1);
+}
+
+/* 
+ * the above over n_steps intervals of size 'step' with the same 
+ * power. the exact exponential solver keeps its matrices for 'step'
+ * instead of recomputing them for the whole interval
+ */
+void compute_temp_steps_block(block_model_t *model, double *power, double *temp, 
+							  double step, int n_steps)
+{
+	double t, h, req_h, new_h;
+	double time_elapsed = step * n_steps;
+	int k;
 
 	#if VERBOSE > 1
 	unsigned int i = 0;
@@ -462,19 +866,55 @@ void compute_temp_block(block_model_t *model, double *power, double *temp, doubl
 	/* set power numbers for the virtual nodes */
 	set_internal_power_block(model, power);
 
+	/* reduced-order modal model	*/
+	if (model->modal_k) {
+		compute_temp_modal_block(model, power, temp, time_elapsed);
+		return;
+	}
+
+	/* fixed step exact exponential solver	*/
+	if (model->config.block_lti_used) {
+		compute_temp_lti_block(model, power, temp, step, n_steps);
+		return;
+	}
+
+	/* 
+	 * implicit solvers are unconditionally stable. so, they 
+	 * cover the whole interval in a few equal steps. the 
+	 * decomposition of (A/h + B) is reused across them
+	 */
+	if (model->transient_method != TRANSIENT_RK4) {
+		for (k = 0; k < model->config.implicit_steps; k++)
+			implicit_step(model, temp, power, model->n_nodes, 
+						  time_elapsed / model->config.implicit_steps, 
+						  model->transient_method, 
+						  (implicit_fn_ptr) implicit_solve_block, model->rk4_ws);
+		return;
+	}
+
 	/* use the scratch pad vector to find (inv_A)*POWER */
 	diagmatvectmult(model->t_vector, model->inva, power, model->n_nodes);
 
 	/* Obtain temp at time (t+time_elapsed). 
 	 * Instead of getting the temperature at t+time_elapsed directly, we do it 
 	 * in multiple steps with the correct step size at each time 
-	 * provided by rk4
+	 * provided by rk4. the first step is the one rk4 suggested at
+	 * the end of the previous call instead of MIN_STEP. if it is
+	 * too large, rk4 shrinks it anyway
 	 */
-	for (t = 0, new_h = MIN_STEP; t < time_elapsed && new_h >= MIN_STEP*DELTA; t+=h) {
-		h = new_h;
+	for (t = 0, new_h = MIN(model->rk4_h, time_elapsed); 
+		 t < time_elapsed && new_h >= MIN_STEP*DELTA; t+=h) {
+		h = req_h = new_h;
 		new_h = rk4(model, temp, model->t_vector, model->n_nodes, &h, 
 		/* the slope function callback is typecast accordingly */
-					temp, (slope_fn_ptr) slope_fn_block);
+					temp, (slope_fn_ptr) slope_fn_block, model->rk4_ws);
+		/* remember the step size rk4 suggests for the next call. 
+		 * if this step was clipped to the end of the interval and 
+		 * taken as such, the suggestion only reflects the clipped 
+		 * step. so, the carried one stays then
+		 */
+		if (req_h >= model->rk4_h || h < req_h)
+			model->rk4_h = new_h;
 		new_h = MIN(new_h, time_elapsed-t-h);
 		#if VERBOSE > 1
 		i++;
@@ -485,6 +925,49 @@ void compute_temp_block(block_model_t *model, double *power, double *temp, doubl
 	#endif
 }
 
+/* restart rk4 from MIN_STEP - e.g. after a discontinuous change in power	*/
+void reset_transient_step_block(block_model_t *model)
+{
+	model->rk4_h = MIN_STEP;
+}
+
+/* 
+ * backward Euler solve used by the implicit transient solvers: 
+ * (A/h + B) y1 = A/h y0 + power. A/h + B is sparse and symmetric 
+ * positive definite like B. so, it is solved by the conjugate 
+ * gradient method starting from y0. it and its incomplete 
+ * Cholesky factor are rebuilt only when the step size changes
+ */
+void implicit_solve_block(block_model_t *model, double *y0, double *power, double *y1, double h)
+{
+	/* shortcuts	*/
+	int n = model->n_nodes;
+	double *rhs = model->t_vector;
+	sparse_matrix_t *b = model->b_csr, *impl = model->impl_csr;
+	int i, k;
+
+	if (model->impl_h != h) {
+		reserve_sparse_matrix(impl, b->nnz);
+		copy_ivector(impl->row_ptr, b->row_ptr, n+1);
+		copy_ivector(impl->col_idx, b->col_idx, b->nnz);
+		for (i = 0; i < n; i++)
+			for (k = b->row_ptr[i]; k < b->row_ptr[i+1]; k++)
+				impl->val[k] = b->val[k] + (b->col_idx[k] == i ? model->a[i] / h : 0.0);
+		impl->n = n;
+		impl->nnz = b->nnz;
+		sparse_ichol(model->impl_ic, impl);
+		model->impl_h = h;
+	}
+
+	for (i = 0; i < n; i++)
+		rhs[i] = model->a[i] / h * y0[i] + power[i];
+	if (y1 != y0)
+		copy_dvector(y1, y0, n);
+	if (sparse_pcg(impl, model->impl_ic, rhs, y1, model->pcg_vectors, 
+				   PCG_BLOCK_TOL, PCG_BLOCK_MAX_ITER) >= PCG_BLOCK_MAX_ITER)
+		warning("pcg implicit transient solver did not converge\n");
+}
+
 /* differs from 'dvector()' in that memory for internal nodes is also allocated	*/
 double *hotspot_vector_block(block_model_t *model)
 {
@@ -516,9 +999,21 @@ void resize_thermal_model_block(block_model_t *model, int n_units)
 	/* resize the 2-d matrices whose no. of columns changes	*/
 	resize_dmatrix(model->len, model->n_units, model->n_units);
 	resize_dmatrix(model->g, model->n_nodes, model->n_nodes);
-	resize_dmatrix(model->b, model->n_nodes, model->n_nodes);
-	resize_dmatrix(model->c, model->n_nodes, model->n_nodes);
-	resize_dmatrix(model->lu, model->n_nodes, model->n_nodes);
+	if (model->config.block_lti_used) {
+		resize_dmatrix(model->lti_phi, model->n_nodes, model->n_nodes);
+		resize_dmatrix(model->lti_gamma, model->n_nodes, model->n_nodes);
+		model->lti_h = 0;
+	}
+	if (model->transient_method != TRANSIENT_RK4)
+		model->impl_h = 0;
+	if (model->modal_k) {
+		model->modal_k = MIN(model->config.block_modal_modes, model->n_nodes);
+		resize_dmatrix(model->modal_proj, model->modal_k, model->n_nodes);
+		resize_dmatrix(model->modal_out, model->n_nodes, model->modal_k);
+		resize_dmatrix(model->modal_static, model->n_nodes, model->n_units);
+		model->modal_h = 0;
+	}
+	model->rk4_h = MIN_STEP;
 }
 
 /* sets the temperature of a vector 'temp' allocated using 'hotspot_vector'	*/
@@ -579,6 +1074,32 @@ void copy_temp_block(block_model_t *model, double *dst, double *src)
 	copy_dvector(dst, src, NL*model->flp->n_units+EXTRA);
 }
 
+/* 
+ * no. of doubles in a snapshot of the transient state: the node 
+ * temperatures and the step size of rk4. the decompositions and
+ * matrices of the other solvers depend only on the step size
+ */
+int thermal_state_size_block(block_model_t *model)
+{
+	return NL*model->flp->n_units+EXTRA + 1;
+}
+
+void save_thermal_state_block(block_model_t *model, double *temp, double *state)
+{
+	int n = NL*model->flp->n_units+EXTRA;
+
+	copy_dvector(state, temp, n);
+	state[n] = model->rk4_h;
+}
+
+void restore_thermal_state_block(block_model_t *model, double *temp, double *state)
+{
+	int n = NL*model->flp->n_units+EXTRA;
+
+	copy_dvector(temp, state, n);
+	model->rk4_h = state[n];
+}
+
 /* 
  * read temperature vector alloced using 'hotspot_vector' from 'file'
  * which was dumped using 'dump_temp'. values are clipped to thermal
@@ -593,7 +1114,7 @@ void read_temp_block(block_model_t *model, double *temp, char *file, int clip)
 
 	int i, n, idx;
 	double max=0, val;
-	char *ptr, str1[LINE_SIZE], str2[LINE_SIZE];
+	char *ptr, *save, str1[LINE_SIZE], str2[LINE_SIZE];
 	char name[STR_SIZE], format[STR_SIZE];
 	FILE *fp;
 
@@ -634,7 +1155,7 @@ void read_temp_block(block_model_t *model, double *temp, char *file, int clip)
 			strcpy(str2, str1);
 
 			/* ignore comments and empty lines	*/
-			ptr = strtok(str1, " \r\t\n");
+			ptr = strtok_r(str1, " \r\t\n", &save);
 			if (!ptr || ptr[0] == '#') {
 				i--;
 				continue;
@@ -661,7 +1182,7 @@ void read_temp_block(block_model_t *model, double *temp, char *file, int clip)
 			fatal("not enough lines in temperature file\n");
 		strcpy(str2, str1);
 		/* ignore comments and empty lines	*/
-		ptr = strtok(str1, " \r\t\n");
+		ptr = strtok_r(str1, " \r\t\n", &save);
 		if (!ptr || ptr[0] == '#') {
 			i--;
 			continue;
@@ -728,7 +1249,7 @@ void read_power_block (block_model_t *model, double *power, char *file)
 	flp_t *flp = model->flp;
 	int idx;
 	double val;
-	char *ptr, str1[LINE_SIZE], str2[LINE_SIZE], name[STR_SIZE];
+	char *ptr, *save, str1[LINE_SIZE], str2[LINE_SIZE], name[STR_SIZE];
 	FILE *fp;
 
 	if (!strcasecmp(file, "stdin"))
@@ -747,7 +1268,7 @@ void read_power_block (block_model_t *model, double *power, char *file)
 		strcpy(str2, str1);
 
 		/* ignore comments and empty lines	*/
-		ptr = strtok(str1, " \r\t\n");
+		ptr = strtok_r(str1, " \r\t\n", &save);
 		if (!ptr || ptr[0] == '#')
 			continue;
 
@@ -832,10 +1353,15 @@ double calc_sink_temp_block(block_model_t *model, double *temp, thermal_config_t
 
 void delete_block_model(block_model_t *model)
 {
+	int i;
+
 	free_dvector(model->a);
 	free_dvector(model->inva);
-	free_dmatrix(model->b);
-	free_dmatrix(model->c);
+	free_sparse_matrix(model->b_csr);
+	free_sparse_matrix(model->b_ic);
+	free_sparse_matrix(model->c_csr);
+	for (i = 0; i < SPARSE_PCG_N_VECTORS; i++)
+		free_dvector(model->pcg_vectors[i]);
 
 	free_dvector(model->gx);
 	free_dvector(model->gy);
@@ -847,13 +1373,38 @@ void delete_block_model(block_model_t *model)
 	free_dvector(model->gy_hs);
 	free_dvector(model->g_amb);
 	free_dvector(model->t_vector);
-	free_ivector(model->p);
 
 	free_dmatrix(model->len);
 	free_dmatrix(model->g);
-	free_dmatrix(model->lu);
 
 	free_imatrix(model->border);
+	free_rk4_workspace(model->rk4_ws);
+
+	if (model->config.block_lti_used) {
+		free_dmatrix(model->lti_phi);
+		free_dmatrix(model->lti_gamma);
+		free_dvector(model->lti_vector);
+		free_dvector(model->lti_gp);
+		free_dvector(model->lti_p);
+		free_lti_pow_block(model);
+	}
+
+	if (model->transient_method != TRANSIENT_RK4) {
+		free_sparse_matrix(model->impl_csr);
+		free_sparse_matrix(model->impl_ic);
+	}
+
+	if (model->modal_k) {
+		free_dvector(model->modal_lambda);
+		free_dmatrix(model->modal_proj);
+		free_dmatrix(model->modal_out);
+		free_dmatrix(model->modal_static);
+		free_dvector(model->modal_base);
+		free_dvector(model->modal_bound);
+		free_dvector(model->modal_decay);
+		free_dvector(model->modal_gain);
+		free_dvector(model->modal_z);
+	}
 
 	free(model);
 }
@@ -870,13 +1421,13 @@ void debug_print_block(block_model_t *model)
 	debug_print_package_RC(&model->pack);
 
 	fprintf(stdout, "printing matrix b:\n");
-	dump_dmatrix(model->b, model->n_nodes, model->n_nodes);
+	dump_sparse_matrix(model->b_csr);
 	fprintf(stdout, "printing vector a:\n");
 	dump_dvector(model->a, model->n_nodes);
 	fprintf(stdout, "printing vector inva:\n");
 	dump_dvector(model->inva, model->n_nodes);
 	fprintf(stdout, "printing matrix c:\n");
-	dump_dmatrix(model->c, model->n_nodes, model->n_nodes);
+	dump_sparse_matrix(model->c_csr);
 	fprintf(stdout, "printing vector g_amb:\n");
 	dump_dvector(model->g_amb, model->n_units+EXTRA);
 }
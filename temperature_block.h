@@ -14,6 +14,16 @@
 /* heat sink */
 #define HSINK 3
 
+/* max. no. of levels of the LTI solver's table of 2^j step spans	*/
+#define LTI_MAX_POW	24
+
+/* max. no. of iterations of the conjugate gradient solves of B 
+ * and (A/h + B). they stop when no temperature would change by
+ * more than PCG_BLOCK_TOL in a Jacobi update
+ */
+#define PCG_BLOCK_MAX_ITER	10000
+#define PCG_BLOCK_TOL		1.0e-9
+
 /* block thermal model	*/
 typedef struct block_model_t_st
 {
@@ -24,17 +34,20 @@ typedef struct block_model_t_st
 	thermal_config_t config;
 
 	/* main matrices	*/
-	/* conductance matrix */
-	double **b;
-	/* LUP decomposition of b	*/
-	double **lu; 
-	int *p;
+	/* conductance matrix. each node is connected only to its 
+	 * neighbours. so, it is stored in CSR form
+	 */
+	sparse_matrix_t *b_csr;
+	/* its incomplete Cholesky factor - the steady state solver's
+	 * preconditioner
+	 */
+	sparse_matrix_t *b_ic;
 	/* diagonal capacitance matrix stored as a 1-d vector	*/
 	double *a; 
 	/* inverse of the above	*/
 	double *inva;
-	/* c = inva * b	*/
-	double **c;
+	/* c = inva * b. only as sparse as b. so, stored in CSR form	*/
+	sparse_matrix_t *c_csr;
 
 	/* package parameters	*/
 	package_RC_t pack;
@@ -49,6 +62,76 @@ typedef struct block_model_t_st
 	double **len, **g;
 	int **border;
 
+	/* discrete LTI solver: for a fixed step size h, 
+	 * T(t+h) = phi * T(t) + gamma * POWER exactly
+	 */
+	/* step size phi and gamma are valid for (0 if stale)	*/
+	double lti_h;
+	/* phi = exp(-c*h)	*/
+	double **lti_phi;
+	/* gamma = c^-1 * (I - phi) * inva	*/
+	double **lti_gamma;
+	double *lti_vector;	/* scratch pad	*/
+	/* 
+	 * gamma * POWER and the POWER it was computed for. while the 
+	 * power stays the same from one call to the next, only the
+	 * phi * T product is needed
+	 */
+	double *lti_gp, *lti_p;
+	int lti_gp_valid;
+	/* 
+	 * a multiple of h is covered in spans of 2^j steps of size h.
+	 * level j is phi_j = phi^(2^j) and gamma_j = (phi_{j-1} + I) *
+	 * gamma_{j-1}. level 0 is phi and gamma. the first lti_n_pow
+	 * levels are valid. the others are computed when needed
+	 */
+	double **lti_phi_pow[LTI_MAX_POW], **lti_gamma_pow[LTI_MAX_POW];
+	int lti_n_pow;
+
+	/* reduced-order modal model: with y = sqrt(A) * (T - base),
+	 * the transient equation becomes dy + Sy = inv_sqrt_A * POWER
+	 * with a symmetric S = V * LAMBDA * V^T. only k dominant
+	 * modes z = V_k^T * y are integrated. the others are taken
+	 * to be in their steady state (static correction)
+	 */
+	int modal_k;			/* no. of modes kept	*/
+	/* step size the matrices below are valid for (0 if stale)	*/
+	double modal_h;
+	double *modal_lambda;	/* eigenvalues of S of the k modes	*/
+	/* k x n_nodes. z = proj * (T - base). proj = V_k^T * sqrt(A)	*/
+	double **modal_proj;
+	/* n_nodes x k. T = base + out * z + ... out = inv_sqrt_A * V_k.
+	 * its first n_units rows also map the power into the modes
+	 */
+	double **modal_out;
+	/* n_nodes x n_units. steady state response of the dropped modes	*/
+	double **modal_static;
+	/* steady state temperature with no power dissipation	*/
+	double *modal_base;
+	/* error bound for every choice of k (n_nodes+1 entries)	*/
+	double *modal_bound;
+	/* per mode decay and gain over a step	*/
+	double *modal_decay, *modal_gain;
+	double *modal_z;		/* scratch pad	*/
+
+	/* transient solver (TRANSIENT_*)	*/
+	int transient_method;
+	/* implicit solvers: (A/h + B) in CSR form and its incomplete
+	 * Cholesky factor for the step size impl_h (0 if stale)
+	 */
+	double impl_h;
+	sparse_matrix_t *impl_csr, *impl_ic;
+
+	/* scratch space of the conjugate gradient solves	*/
+	double *pcg_vectors[SPARSE_PCG_N_VECTORS];
+
+	/* last step size suggested by rk4. the next call
+	 * to compute_temp_block resumes from it
+	 */
+	double rk4_h;
+	/* scratch space of rk4	*/
+	rk4_workspace_t *rk4_ws;
+
 	/* total no. of nodes	*/
 	int n_nodes;
 	/* total no. of blocks	*/
@@ -72,7 +155,25 @@ void populate_C_model_block(block_model_t *model, flp_t *flp);
 
 /* hotspot main interfaces - temperature.c	*/
 void steady_state_temp_block(block_model_t *model, double *power, double *temp);
+/* the above for 'n' power vectors at once	*/
+void steady_state_temp_batch_block(block_model_t *model, double **power, double **temp, int n);
 void compute_temp_block(block_model_t *model, double *power, double *temp, double time_elapsed);
+/* the above over n_steps intervals of size 'step' with the same power	*/
+void compute_temp_steps_block(block_model_t *model, double *power, double *temp, 
+							  double step, int n_steps);
+/* restart rk4 from MIN_STEP - e.g. after a discontinuous change in power	*/
+void reset_transient_step_block(block_model_t *model);
+/* backward Euler solve of the implicit transient solvers	*/
+void implicit_solve_block(block_model_t *model, double *y0, double *power, double *y1, double h);
+/* exact exponential (discrete LTI) solver for a fixed step size	*/
+void populate_lti_model_block(block_model_t *model, double h);
+void compute_temp_lti_block(block_model_t *model, double *power, double *temp, 
+							double h, int n_steps);
+/* reduced-order modal model	*/
+void populate_modal_model_block(block_model_t *model, double h);
+void compute_temp_modal_block(block_model_t *model, double *power, double *temp, double time_elapsed);
+/* bound on the error in the silicon temperatures (K/W) when k modes are kept	*/
+double modal_error_bound_block(block_model_t *model, int k, double h);
 /* differs from 'dvector()' in that memory for internal nodes is also allocated	*/
 double *hotspot_vector_block(block_model_t *model);
 /* copy 'src' to 'dst' except for a window of 'size'
@@ -86,6 +187,10 @@ void resize_thermal_model_block(block_model_t *model, int n_units);
 void set_temp_block (block_model_t *model, double *temp, double val);
 void dump_temp_block (block_model_t *model, double *temp, char *file);
 void copy_temp_block (block_model_t *model, double *dst, double *src);
+/* snapshot and restore of the transient state	*/
+int thermal_state_size_block(block_model_t *model);
+void save_thermal_state_block(block_model_t *model, double *temp, double *state);
+void restore_thermal_state_block(block_model_t *model, double *temp, double *state);
 void read_temp_block (block_model_t *model, double *temp, char *file, int clip);
 void dump_power_block(block_model_t *model, double *power, char *file);
 void read_power_block (block_model_t *model, double *power, char *file);
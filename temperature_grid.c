@@ -334,6 +334,112 @@ void set_bgmap(grid_model_t *model, layer_t *layer)
   }
 }
 
+/* flatten the block-grid maps of all the layers into the sparse
+ * matrices b2g_power, b2g_temp and g2b (see grid_model_t). it is
+ * called after set_bgmap has been run for the layers. each entry 
+ * of the b2g maps is a block's occupancy of the cell (scaled by 
+ * the ratio of the cell's area to the block's for power). each
+ * entry of g2b is a cell's weight in the block's temperature
+ */
+static void set_bgmap_csr(grid_model_t *model)
+{
+  int n, i, j, u, k, base, nnz, count;
+  int i1, j1, i2, j2, ci1, cj1, ci2, cj2;
+  blist_t *ptr;
+  flp_t *flp;
+  double area = (model->width * model->height) / (model->cols * model->rows);
+  int nl = model->n_layers;
+  int nr = model->rows;
+  int nc = model->cols;
+  sparse_matrix_t *bp, *bt, *gb = NULL;
+
+  if (model->b2g_power) {
+      free_sparse_matrix(model->b2g_power);
+      free_sparse_matrix(model->b2g_temp);
+  }
+  if (model->g2b)
+    free_sparse_matrix(model->g2b);
+
+  /* block to grid - a non-zero per blist entry	*/
+  for(n=0, nnz=0; n < nl; n++)
+    for(i=0; i < nr; i++)
+      for(j=0; j < nc; j++)
+        for(ptr=model->layers[n].b2gmap[i][j]; ptr; ptr=ptr->next)
+          nnz++;
+  bp = alloc_sparse_matrix(nl*nr*nc);
+  bt = alloc_sparse_matrix(nl*nr*nc);
+  reserve_sparse_matrix(bp, nnz);
+  reserve_sparse_matrix(bt, nnz);
+  for(n=0, k=0, base=0; n < nl; n++) {
+      flp = model->layers[n].flp;
+      for(i=0; i < nr; i++)
+        for(j=0; j < nc; j++) {
+            bp->row_ptr[(n*nr+i)*nc+j] = bt->row_ptr[(n*nr+i)*nc+j] = k;
+            for(ptr=model->layers[n].b2gmap[i][j]; ptr; ptr=ptr->next, k++) {
+                bp->col_idx[k] = bt->col_idx[k] = base + ptr->idx;
+                /* convert power density to power	*/ 
+                bp->val[k] = ptr->occupancy * area / (flp->units[ptr->idx].width * 
+                                                      flp->units[ptr->idx].height);
+                bt->val[k] = ptr->occupancy;
+            }
+        }
+      base += flp->n_units;
+  }
+  bp->row_ptr[nl*nr*nc] = bt->row_ptr[nl*nr*nc] = k;
+  bp->n = bt->n = nl*nr*nc;
+  bp->nnz = bt->nnz = nnz;
+  model->b2g_power = bp;
+  model->b2g_temp = bt;
+
+  /* grid to block. only for the linear mapping modes	*/
+  if (model->map_mode == GRID_AVG || model->map_mode == GRID_CENTER) {
+      for(n=0, nnz=0; n < nl; n++)
+        for(u=0; u < model->layers[n].flp->n_units; u++) {
+            if (model->map_mode == GRID_CENTER)
+              nnz += 4;
+            else
+              nnz += (model->layers[n].g2bmap[u].i2 - model->layers[n].g2bmap[u].i1) * 
+                     (model->layers[n].g2bmap[u].j2 - model->layers[n].g2bmap[u].j1);
+        }
+      gb = alloc_sparse_matrix(model->total_n_blocks);
+      reserve_sparse_matrix(gb, nnz);
+      for(n=0, k=0, base=0; n < nl; n++) {
+          for(u=0; u < model->layers[n].flp->n_units; u++) {
+              i1 = model->layers[n].g2bmap[u].i1;
+              j1 = model->layers[n].g2bmap[u].j1;
+              i2 = model->layers[n].g2bmap[u].i2;
+              j2 = model->layers[n].g2bmap[u].j2;
+              gb->row_ptr[base+u] = k;
+              /* average of the (up to four) center grid cells	*/
+              if (model->map_mode == GRID_CENTER) {
+                  ci1 = (i1 + i2) / 2;
+                  cj1 = (j1 + j2) / 2;
+                  ci2 = ci1 - !((i2-i1) % 2);
+                  cj2 = cj1 - !((j2-j1) % 2);
+                  gb->col_idx[k++] = (n*nr+ci1)*nc+cj1;
+                  gb->col_idx[k++] = (n*nr+ci2)*nc+cj1;
+                  gb->col_idx[k++] = (n*nr+ci1)*nc+cj2;
+                  gb->col_idx[k++] = (n*nr+ci2)*nc+cj2;
+                  gb->val[k-4] = gb->val[k-3] = gb->val[k-2] = gb->val[k-1] = 0.25;
+              /* average of all the grid cells in the block	*/
+              } else {
+                  count = (i2 - i1) * (j2 - j1);
+                  for(i=i1; i < i2; i++)
+                    for(j=j1; j < j2; j++, k++) {
+                        gb->col_idx[k] = (n*nr+i)*nc+j;
+                        gb->val[k] = 1.0 / count;
+                    }
+              }
+          }
+          base += model->layers[n].flp->n_units;
+      }
+      gb->row_ptr[base] = k;
+      gb->n = base;
+      gb->nnz = nnz;
+  }
+  model->g2b = gb;
+}
+
 /* populate default set of layers	*/ 
 void populate_default_layers(grid_model_t *model, flp_t *flp_default)
 {
@@ -490,7 +596,7 @@ void append_package_layers(grid_model_t *model)
 /* parse the layer file open for reading	*/
 void parse_layer_file(grid_model_t *model, FILE *fp)
 {
-  char line[LINE_SIZE], *ptr, cval;
+  char line[LINE_SIZE], *ptr, *save, cval;
   int count, i = 0, field = LCF_SNO, ival;
   double dval;
   int base, inner_layers;
@@ -512,7 +618,7 @@ void parse_layer_file(grid_model_t *model, FILE *fp)
         break;
 
       /* ignore comments and empty lines	*/
-      ptr = strtok(line, " \r\t\n");
+      ptr = strtok_r(line, " \r\t\n", &save);
       if (!ptr || ptr[0] == '#')
         continue;
 
@@ -664,7 +770,7 @@ void populate_layers_grid(grid_model_t *model, flp_t *flp_default)
 /* constructor */
 grid_model_t *alloc_grid_model(thermal_config_t *config, flp_t *flp_default, int do_detailed_3D)
 {
-  int i;
+  int i, j, k, n_cells;
   grid_model_t *model;
 
 #if SUPERLU < 1
@@ -692,6 +798,9 @@ grid_model_t *alloc_grid_model(thermal_config_t *config, flp_t *flp_default, int
   else
     fatal("unknown mapping mode\n");
 
+  model->steady_solver = get_grid_steady_solver(&model->config);
+  model->pcg_precond = get_grid_pcg_precond(&model->config);
+
   /* layer configuration file specified?	*/
   if(strcmp(model->config.grid_layer_file, NULLFILE))
     model->has_lcf = TRUE;
@@ -710,16 +819,174 @@ grid_model_t *alloc_grid_model(thermal_config_t *config, flp_t *flp_default, int
 
   /* allocate internal state	*/
   model->last_steady = new_grid_model_vector(model);
+  model->steady_power = new_grid_model_vector(model);
   model->last_trans = new_grid_model_vector(model);
+  model->rk4_h = MIN_STEP;
+  /* rk4 works on the entire grid and the package nodes	*/
+  model->rk4_ws = alloc_rk4_workspace(model->rows * model->cols * model->n_layers + 
+                                      (model->config.model_secondary ? 
+                                       EXTRA + EXTRA_SEC : EXTRA));
+  /* implicit transient solvers	*/
+  model->transient_method = get_transient_method(&model->config);
+  if (model->transient_method == TRANSIENT_ADI) {
+      for(k=0; k < 3; k++) {
+          model->adi_am[k] = dvector(model->n_layers * model->rows * model->cols);
+          model->adi_m[k] = dvector(model->n_layers * model->rows * model->cols);
+          model->adi_cp[k] = dvector(model->n_layers * model->rows * model->cols);
+      }
+      model->adi_gd = dvector(model->n_layers * model->rows * model->cols);
+  } else if (model->transient_method != TRANSIENT_RK4) {
+      model->impl_power = new_grid_model_vector(model);
+      model->impl_temp = new_grid_model_vector(model);
+  }
+  /* work vectors of the solvers at every multigrid level	*/
+  model->n_work = 1;
+  for(i=model->rows, j=model->cols; i > 1 && j > 1; i/=2, j/=2)
+    model->n_work++;
+  model->work = (grid_work_t *) calloc(model->n_work, sizeof(grid_work_t));
+  if (!model->work)
+    fatal("memory allocation error\n");
+  for(k=0; k < model->n_work; k++) {
+      model->work[k].power = new_grid_model_vector(model);
+      model->work[k].temp = new_grid_model_vector(model);
+      model->work[k].r = new_grid_model_vector(model);
+      model->work[k].e = new_grid_model_vector(model);
+      model->work[k].res = new_grid_model_vector(model);
+      /* the next level is half as fine	*/
+      model->rows /= 2;
+      model->cols /= 2;
+  }
+  model->rows = config->grid_rows;
+  model->cols = config->grid_cols;
+  /* the implicit transient solvers use pcg too	*/
+  if (model->steady_solver == GRID_SOLVER_PCG || model->impl_power) {
+      for(k=0; k < PCG_N_VECTORS; k++)
+        model->pcg_vectors[k] = new_grid_model_vector(model);
+      model->pcg_diag = dvector(model->rows * model->cols * model->n_layers + 
+                                (model->config.model_secondary ? 
+                                 EXTRA + EXTRA_SEC : EXTRA));
+  }
+  /* per cell conductances and capacitances	*/
+  n_cells = model->n_layers * model->rows * model->cols;
+  model->g_n = dvector(n_cells);
+  model->g_s = dvector(n_cells);
+  model->g_e = dvector(n_cells);
+  model->g_w = dvector(n_cells);
+  model->g_a = dvector(n_cells);
+  model->g_b = dvector(n_cells);
+  model->inv_c = dvector(n_cells);
+
+  /* and those of the coarser multigrid levels	*/
+  model->n_levels = 1;
+  if (model->config.detailed_3D_used)
+    for(i=model->rows, j=model->cols; i > 1 && j > 1 && !(i % 2) && !(j % 2); 
+        i /= 2, j /= 2)
+      model->n_levels++;
+  model->levels = (grid_cells_t *) calloc(model->n_levels, sizeof(grid_cells_t));
+  if (!model->levels)
+    fatal("memory allocation error\n");
+  model->levels[0].g_n = model->g_n;
+  model->levels[0].g_s = model->g_s;
+  model->levels[0].g_e = model->g_e;
+  model->levels[0].g_w = model->g_w;
+  model->levels[0].g_a = model->g_a;
+  model->levels[0].g_b = model->g_b;
+  model->levels[0].inv_c = model->inv_c;
+  for(k=1; k < model->n_levels; k++) {
+      n_cells /= 4;
+      model->levels[k].g_n = dvector(n_cells);
+      model->levels[k].g_s = dvector(n_cells);
+      model->levels[k].g_e = dvector(n_cells);
+      model->levels[k].g_w = dvector(n_cells);
+      model->levels[k].g_a = dvector(n_cells);
+      model->levels[k].g_b = dvector(n_cells);
+      model->levels[k].inv_c = dvector(n_cells);
+  }
 
   return model;
 }
+
+/* make the per cell conductances of multigrid level 'lvl' current	*/
+static void use_level_grid(grid_model_t *model, int lvl)
+{
+  model->level = lvl;
+  if (lvl >= model->n_levels)
+    return;
+  model->g_n = model->levels[lvl].g_n;
+  model->g_s = model->levels[lvl].g_s;
+  model->g_e = model->levels[lvl].g_e;
+  model->g_w = model->levels[lvl].g_w;
+  model->g_a = model->levels[lvl].g_a;
+  model->g_b = model->levels[lvl].g_b;
+  model->inv_c = model->levels[lvl].inv_c;
+}
+
+/* conductance of a path through three links in series - half
+ * of g[k], all of g[k+step] and half of g[k+2*step] (from the
+ * centre of a coarse cell to that of its neighbour)
+ */
+static double series_g(double *g, int k, int step)
+{
+  if (g[k] == 0 || g[k+step] == 0 || g[k+2*step] == 0)
+    return 0.0;
+  return 1.0 / (0.5/g[k] + 1.0/g[k+step] + 0.5/g[k+2*step]);
+}
+
+/* aggregate the per cell conductances (do_r) and/or capacitances 
+ * (do_c) of every multigrid level from those of the next finer 
+ * one. each coarse cell is made of 2 x 2 fine cells. laterally, 
+ * it conducts through two rows (columns) of fine cells in 
+ * parallel, each a series path across the fine cell links. 
+ * i.e., the conductances are averaged harmonically along the 
+ * direction of the flow and added across it. vertically, the 
+ * conductances of the four fine cells add up and so do their 
+ * capacitances. for uniform layers, this gives the same values 
+ * as coarsen_grid does
+ */
+static void coarsen_cells_grid(grid_model_t *model, int do_r, int do_c)
+{
+  int lvl, n, i, j, k, kc, a, b;
+  int nl = model->n_layers;
+  int nr = model->rows;
+  int nc = model->cols;
+  grid_cells_t *f, *c;
+
+  for(lvl=1; lvl < model->n_levels; lvl++, nr /= 2, nc /= 2) {
+      f = &model->levels[lvl-1];
+      c = &model->levels[lvl];
+      for(n=0, kc=0; n < nl; n++)
+        for(i=0; i < nr/2; i++)
+          for(j=0; j < nc/2; j++, kc++) {
+              /* top left fine cell	*/
+              k = (n * nr + 2*i) * nc + 2*j;
+              if (do_r) {
+                  c->g_a[kc] = c->g_b[kc] = 0.0;
+                  for(a=0; a < 2; a++)
+                    for(b=0; b < 2; b++) {
+                        c->g_a[kc] += f->g_a[k + a*nc + b];
+                        c->g_b[kc] += f->g_b[k + a*nc + b];
+                    }
+                  c->g_n[kc] = (i > 0) ? series_g(f->g_n, k+nc, -nc) + 
+                                         series_g(f->g_n, k+nc+1, -nc) : 0.0;
+                  c->g_s[kc] = (i < nr/2-1) ? series_g(f->g_s, k, nc) + 
+                                              series_g(f->g_s, k+1, nc) : 0.0;
+                  c->g_e[kc] = (j < nc/2-1) ? series_g(f->g_e, k, 1) + 
+                                              series_g(f->g_e, k+nc, 1) : 0.0;
+                  c->g_w[kc] = (j > 0) ? series_g(f->g_w, k+1, -1) + 
+                                         series_g(f->g_w, k+nc+1, -1) : 0.0;
+              }
+              if (do_c)
+                c->inv_c[kc] = 1.0 / (1.0/f->inv_c[k] + 1.0/f->inv_c[k+1] + 
+                                      1.0/f->inv_c[k+nc] + 1.0/f->inv_c[k+nc+1]);
+          }
+  }
+}
 #if DEBUG3D > 0
 void debug_print_layer_det3D(grid_model_t *model, layer_t *layer);
 #endif 
 void populate_R_model_grid(grid_model_t *model, flp_t *flp)
 {
-  int i, base;
+  int i, j, n, k, base;
   double cw, ch;
 
   int inner_layers;
@@ -798,6 +1065,9 @@ void populate_R_model_grid(grid_model_t *model, flp_t *flp)
       }
   } //end->BU_3D
 
+  /* the same maps as sparse matrices	*/
+  set_bgmap_csr(model);
+
   /* sanity check on floorplan sizes	*/
   if (model->width > model->config.s_sink || 
       model->height > model->config.s_sink || 
@@ -840,14 +1110,61 @@ void populate_R_model_grid(grid_model_t *model, flp_t *flp)
       //}
   }
 
+  /* per cell conductances. in the detailed 3D mode, each cell 
+   * uses the resistance of its neighbour on that side (as in
+   * build_steady_grid_matrix)
+   */
+  for(n=0, k=0; n < nl; n++)
+    for(i=0; i < model->rows; i++)
+      for(j=0; j < model->cols; j++, k++) {
+          if(model->config.detailed_3D_used == 1) {
+              model->g_n[k] = (i > 0) ? 1.0/find_res_3D(n, i-1, j, model, 2) : 0.0;
+              model->g_s[k] = (i < model->rows-1) ? 1.0/find_res_3D(n, i+1, j, model, 2) : 0.0;
+              model->g_e[k] = (j < model->cols-1) ? 1.0/find_res_3D(n, i, j+1, model, 1) : 0.0;
+              model->g_w[k] = (j > 0) ? 1.0/find_res_3D(n, i, j-1, model, 1) : 0.0;
+              model->g_a[k] = (n > 0) ? 1.0/find_res_3D(n-1, i, j, model, 3) : 0.0;
+              model->g_b[k] = (n < nl-1) ? 1.0/find_res_3D(n, i, j, model, 3) : 0.0;
+          } else {
+              model->g_n[k] = (i > 0) ? 1.0/model->layers[n].ry : 0.0;
+              model->g_s[k] = (i < model->rows-1) ? 1.0/model->layers[n].ry : 0.0;
+              model->g_e[k] = (j < model->cols-1) ? 1.0/model->layers[n].rx : 0.0;
+              model->g_w[k] = (j > 0) ? 1.0/model->layers[n].rx : 0.0;
+              model->g_a[k] = (n > 0) ? 1.0/model->layers[n-1].rz : 0.0;
+              model->g_b[k] = (n < nl-1) ? 1.0/model->layers[n].rz : 0.0;
+          }
+      }
+  /* the vertical conductances are the same both ways	*/
+  model->g_symmetric = TRUE;
+  for(n=0, k=0; n < nl; n++)
+    for(i=0; i < model->rows; i++)
+      for(j=0; j < model->cols; j++, k++) {
+          if ((i < model->rows-1 && model->g_s[k] != model->g_n[k+model->cols]) ||
+              (j < model->cols-1 && model->g_e[k] != model->g_w[k+1]))
+            model->g_symmetric = FALSE;
+      }
+  /* coarser multigrid levels	*/
+  coarsen_cells_grid(model, TRUE, FALSE);
+
+#if SUPERLU > 0
+  /* the cached factors are stale now	*/
+  free_SLU_factors(model);
+#endif
+  model->adi_h = 0;
+  model->adi_tau = 0;
+  model->impl_tau = 0;
+
   /* done	*/
   model->r_ready = TRUE;
+  /* the stable step size depends on the R's	*/
+  model->rk4_h = MIN_STEP;
 }
 
 void populate_C_model_grid(grid_model_t *model, flp_t *flp)
 {
-  int i;
+  int i, j, n, k;
   int silidx, hsidx, pcbidx;
+  package_RC_t *pk;
+  double *cap;
 
   /* shortcuts */
   double cw = model->width / model->cols;
@@ -876,6 +1193,24 @@ void populate_C_model_grid(grid_model_t *model, flp_t *flp)
   /* package C's	*/
   populate_package_C(&model->pack, &model->config, model->width, model->height);
 
+  /* the same per package node (as in slope_fn_pack)	*/
+  pk = &model->pack;
+  cap = model->pack_cap;
+  cap[SP_W] = cap[SP_E] = pk->c_sp_per_x;
+  cap[SP_N] = cap[SP_S] = pk->c_sp_per_y;
+  cap[SINK_C_W] = cap[SINK_C_E] = pk->c_hs_c_per_x + pk->c_amb_c_per_x;
+  cap[SINK_C_N] = cap[SINK_C_S] = pk->c_hs_c_per_y + pk->c_amb_c_per_y;
+  cap[SINK_W] = cap[SINK_E] = cap[SINK_N] = cap[SINK_S] = pk->c_hs_per + pk->c_amb_per;
+  if (model_secondary) {
+      cap[SUB_W] = cap[SUB_E] = pk->c_sub_per_x;
+      cap[SUB_N] = cap[SUB_S] = pk->c_sub_per_y;
+      cap[SOLDER_W] = cap[SOLDER_E] = pk->c_solder_per_x;
+      cap[SOLDER_N] = cap[SOLDER_S] = pk->c_solder_per_y;
+      cap[PCB_C_W] = cap[PCB_C_E] = pk->c_pcb_c_per_x + pk->c_amb_sec_c_per_x;
+      cap[PCB_C_N] = cap[PCB_C_S] = pk->c_pcb_c_per_y + pk->c_amb_sec_c_per_y;
+      cap[PCB_W] = cap[PCB_E] = cap[PCB_N] = cap[PCB_S] = pk->c_pcb_per + pk->c_amb_sec_per;
+  }
+
   /* layer specific capacitances	*/
   for(i=0; i < nl; i++){
       model->layers[i].c =  getcap(model->layers[i].sp, model->layers[i].thickness, cw * ch);
@@ -891,8 +1226,30 @@ void populate_C_model_grid(grid_model_t *model, flp_t *flp)
                                  (model->config.s_pcb * model->config.s_pcb);
   }
 
+  /* per cell inverse capacitances	*/
+  for(n=0, k=0; n < nl; n++)
+    for(i=0; i < model->rows; i++)
+      for(j=0; j < model->cols; j++, k++) {
+          if(model->config.detailed_3D_used == 1)
+            model->inv_c[k] = 1.0 / find_cap_3D(n, i, j, model);
+          else
+            model->inv_c[k] = 1.0 / model->layers[n].c;
+      }
+  /* coarser multigrid levels	*/
+  coarsen_cells_grid(model, FALSE, TRUE);
+
+#if SUPERLU > 0
+  /* the cached factors of (C/h + G) are stale now	*/
+  model->slu_impl_h = 0;
+#endif
+
   /* done	*/	
   model->c_ready = TRUE;
+  /* the stable step size depends on the C's	*/
+  model->rk4_h = MIN_STEP;
+  model->adi_h = 0;
+  model->adi_tau = 0;
+  model->impl_tau = 0;
 }
 
 /* destructor	*/
@@ -949,7 +1306,60 @@ void delete_grid_model(grid_model_t *model)
   }//end->BU_3D
 
   free_grid_model_vector(model->last_steady);
+  free_grid_model_vector(model->steady_power);
   free_grid_model_vector(model->last_trans);
+  free_rk4_workspace(model->rk4_ws);
+  if (model->transient_method == TRANSIENT_ADI) {
+      for(i=0; i < 3; i++) {
+          free_dvector(model->adi_am[i]);
+          free_dvector(model->adi_m[i]);
+          free_dvector(model->adi_cp[i]);
+      }
+      free_dvector(model->adi_gd);
+  }
+  for(i=0; i < model->n_work; i++) {
+      free_grid_model_vector(model->work[i].power);
+      free_grid_model_vector(model->work[i].temp);
+      free_grid_model_vector(model->work[i].r);
+      free_grid_model_vector(model->work[i].e);
+      free_grid_model_vector(model->work[i].res);
+  }
+  free(model->work);
+  if (model->steady_solver == GRID_SOLVER_PCG || model->impl_power) {
+      for(i=0; i < PCG_N_VECTORS; i++)
+        free_grid_model_vector(model->pcg_vectors[i]);
+      free_dvector(model->pcg_diag);
+  }
+  if (model->impl_power) {
+      free_grid_model_vector(model->impl_power);
+      free_grid_model_vector(model->impl_temp);
+  }
+  free_dvector(model->g_n);
+  free_dvector(model->g_s);
+  free_dvector(model->g_e);
+  free_dvector(model->g_w);
+  free_dvector(model->g_a);
+  free_dvector(model->g_b);
+  free_dvector(model->inv_c);
+  for(i=1; i < model->n_levels; i++) {
+      free_dvector(model->levels[i].g_n);
+      free_dvector(model->levels[i].g_s);
+      free_dvector(model->levels[i].g_e);
+      free_dvector(model->levels[i].g_w);
+      free_dvector(model->levels[i].g_a);
+      free_dvector(model->levels[i].g_b);
+      free_dvector(model->levels[i].inv_c);
+  }
+  free(model->levels);
+  if (model->b2g_power) {
+      free_sparse_matrix(model->b2g_power);
+      free_sparse_matrix(model->b2g_temp);
+  }
+  if (model->g2b)
+    free_sparse_matrix(model->g2b);
+#if SUPERLU > 0
+  free_SLU_factors(model);
+#endif
   free(model->layers);
   free(model);
 }
@@ -1247,6 +1657,58 @@ void copy_temp_grid(grid_model_t *model, double *dst, double *src)
     copy_dvector(dst, src, model->total_n_blocks + EXTRA + EXTRA_SEC);
 }
 
+/* no. of doubles in a snapshot of the transient state: the block
+ * temperatures, the grid cell and package temperatures and the 
+ * step size of rk4
+ */
+int thermal_state_size_grid(grid_model_t *model)
+{
+  int extra_nodes = model->config.model_secondary ? EXTRA + EXTRA_SEC : EXTRA;
+
+  return model->total_n_blocks + extra_nodes + 
+         model->n_layers * model->rows * model->cols + extra_nodes + 1;
+}
+
+/* snapshot the transient state into 'state'. 'temp' is the block 
+ * temperature vector passed to compute_temp_grid (NULL for the
+ * one it remembers from its last call)
+ */
+void save_thermal_state_grid(grid_model_t *model, double *temp, double *state)
+{
+  int extra_nodes = model->config.model_secondary ? EXTRA + EXTRA_SEC : EXTRA;
+  int n_blocks = model->total_n_blocks + extra_nodes;
+  int n_cells = model->n_layers * model->rows * model->cols + extra_nodes;
+
+  if (!temp)
+    temp = model->last_temp;
+  if (!temp)
+    fatal("no transient state to save\n");
+
+  copy_dvector(state, temp, n_blocks);
+  copy_dvector(state + n_blocks, model->last_trans->cuboid[0][0], n_cells);
+  state[n_blocks + n_cells] = model->rk4_h;
+}
+
+/* go back to a snapshot taken by save_thermal_state_grid. the next 
+ * call to compute_temp_grid with a NULL 'temp' resumes from it
+ */
+void restore_thermal_state_grid(grid_model_t *model, double *temp, double *state)
+{
+  int extra_nodes = model->config.model_secondary ? EXTRA + EXTRA_SEC : EXTRA;
+  int n_blocks = model->total_n_blocks + extra_nodes;
+  int n_cells = model->n_layers * model->rows * model->cols + extra_nodes;
+
+  if (!temp)
+    temp = model->last_temp;
+  if (!temp)
+    fatal("no temperature vector to restore into\n");
+
+  copy_dvector(temp, state, n_blocks);
+  copy_dvector(model->last_trans->cuboid[0][0], state + n_blocks, n_cells);
+  model->rk4_h = state[n_blocks + n_cells];
+  model->last_temp = temp;
+}
+
 /* 
  * read temperature vector alloced using 'hotspot_vector' from 'file'
  * which was dumped using 'dump_temp'. values are clipped to thermal
@@ -1256,7 +1718,7 @@ void read_temp_grid(grid_model_t *model, double *temp, char *file, int clip)
 {
   int i, n, idx, base = 0;
   double max=0, val;
-  char *ptr, str1[LINE_SIZE], str2[LINE_SIZE];
+  char *ptr, *save, str1[LINE_SIZE], str2[LINE_SIZE];
   char name[STR_SIZE], format[STR_SIZE];
   FILE *fp;
 
@@ -1368,7 +1830,7 @@ void read_temp_grid(grid_model_t *model, double *temp, char *file, int clip)
             fatal("not enough lines in temperature file\n");
           strcpy(str2, str1);
           /* ignore comments and empty lines	*/
-          ptr = strtok(str1, " \r\t\n");
+          ptr = strtok_r(str1, " \r\t\n", &save);
           if (!ptr || ptr[0] == '#') {
               i--;
               continue;
@@ -1400,7 +1862,7 @@ void read_temp_grid(grid_model_t *model, double *temp, char *file, int clip)
         fatal("not enough lines in temperature file\n");
       strcpy(str2, str1);
       /* ignore comments and empty lines	*/
-      ptr = strtok(str1, " \r\t\n");
+      ptr = strtok_r(str1, " \r\t\n", &save);
       if (!ptr || ptr[0] == '#') {
           i--;
           continue;
@@ -1478,7 +1940,7 @@ void read_power_grid(grid_model_t *model, double *power, char *file)
 {
   int i, idx, n, base = 0;
   double val;
-  char *ptr, str1[LINE_SIZE], str2[LINE_SIZE]; 
+  char *ptr, *save, str1[LINE_SIZE], str2[LINE_SIZE]; 
   char name[STR_SIZE], format[STR_SIZE];
   FILE *fp;
 
@@ -1505,7 +1967,7 @@ void read_power_grid(grid_model_t *model, double *power, char *file)
                 strcpy(str2, str1);
 
                 /* ignore comments and empty lines	*/
-                ptr = strtok(str1, " \r\t\n");
+                ptr = strtok_r(str1, " \r\t\n", &save);
                 if (!ptr || ptr[0] == '#') {
                     i--;
                     continue;
@@ -1538,7 +2000,7 @@ void read_power_grid(grid_model_t *model, double *power, char *file)
           strcpy(str2, str1);
 
           /* ignore comments and empty lines	*/
-          ptr = strtok(str1, " \r\t\n");
+          ptr = strtok_r(str1, " \r\t\n", &save);
           if (!ptr || ptr[0] == '#')
             continue;
 
@@ -1680,8 +2142,7 @@ void free_grid_model_vector(grid_model_vector_t *v)
 /* translate power/temperature between block and grid vectors	*/
 void xlate_vector_b2g(grid_model_t *model, double *b, grid_model_vector_t *g, int type)
 {
-  int i, j, n, base = 0;
-  double area;
+  int i;
 
   int extra_nodes;
   if (model->config.model_secondary)
@@ -1689,36 +2150,21 @@ void xlate_vector_b2g(grid_model_t *model, double *b, grid_model_vector_t *g, in
   else
     extra_nodes = EXTRA;
 
-  /* area of a single grid cell	*/
-  area = (model->width * model->height) / (model->cols * model->rows);
-
-  for(n=0; n < model->n_layers; n++) {
-      for(i=0; i < model->rows; i++)
-        for(j=0; j < model->cols; j++) {
-            /* for each grid cell, the power density / temperature are 
-             * the average of the power densities / temperatures of the 
-             * blocks in it weighted by their occupancies
-             */
-            /* convert power density to power	*/ 
-            if (type == V_POWER)
-              g->cuboid[n][i][j] = blist_avg(model->layers[n].b2gmap[i][j], 
-                                             model->layers[n].flp, &b[base], type) * area;
-            /* no conversion necessary for temperature	*/ 
-            else if (type == V_TEMP)
-              g->cuboid[n][i][j] = blist_avg(model->layers[n].b2gmap[i][j], 
-                                             model->layers[n].flp, &b[base], type);
-            else
-              fatal("unknown vector type\n");
-        }
-      /* keep track of the beginning address of this layer in the 
-       * block power vector
-       */
-      base += model->layers[n].flp->n_units;							 
-  }
+  /* for each grid cell, the power density / temperature are 
+   * the average of the power densities / temperatures of the 
+   * blocks in it weighted by their occupancies. the weights
+   * of b2g_power also convert power density to power
+   */
+  if (type == V_POWER)
+    sparse_matvectmult(g->cuboid[0][0], model->b2g_power, b);
+  else if (type == V_TEMP)
+    sparse_matvectmult(g->cuboid[0][0], model->b2g_temp, b);
+  else
+    fatal("unknown vector type\n");
 
   /* extra spreader and sink nodes	*/
   for(i=0; i < extra_nodes; i++)
-    g->extra[i] = b[base+i];
+    g->extra[i] = b[model->total_n_blocks+i];
 }
 
 /* translate temperature between grid and block vectors	*/
@@ -1734,72 +2180,78 @@ void xlate_temp_g2b(grid_model_t *model, double *b, grid_model_vector_t *g)
   else
     extra_nodes = EXTRA;
 
-  for(n=0; n < model->n_layers; n++) {
-      for(u=0; u < model->layers[n].flp->n_units; u++) {
-          /* extent of this unit in grid cell units	*/
-          i1 = model->layers[n].g2bmap[u].i1;
-          j1 = model->layers[n].g2bmap[u].j1;
-          i2 = model->layers[n].g2bmap[u].i2;
-          j2 = model->layers[n].g2bmap[u].j2;
-
-          /* map the center grid cell's temperature to the block	*/
-          if (model->map_mode == GRID_CENTER) {
-              /* center co-ordinates	*/	
-              ci1 = (i1 + i2) / 2;
-              cj1 = (j1 + j2) / 2;
-              /* in case of even no. of cells, center 
-               * is the average of two central cells
+  /* linear mapping modes - a weighted sum of the grid cells	*/
+  if (model->g2b) {
+      sparse_matvectmult(b, model->g2b, g->cuboid[0][0]);
+      base = model->total_n_blocks;
+  } else {
+      for(n=0; n < model->n_layers; n++) {
+          for(u=0; u < model->layers[n].flp->n_units; u++) {
+              /* extent of this unit in grid cell units	*/
+              i1 = model->layers[n].g2bmap[u].i1;
+              j1 = model->layers[n].g2bmap[u].j1;
+              i2 = model->layers[n].g2bmap[u].i2;
+              j2 = model->layers[n].g2bmap[u].j2;
+
+              /* map the center grid cell's temperature to the block	*/
+              if (model->map_mode == GRID_CENTER) {
+                  /* center co-ordinates	*/	
+                  ci1 = (i1 + i2) / 2;
+                  cj1 = (j1 + j2) / 2;
+                  /* in case of even no. of cells, center 
+                   * is the average of two central cells
+                   */
+                  /* ci2 = ci1-1 when even, ci1 otherwise	*/  
+                  ci2 = ci1 - !((i2-i1) % 2);
+                  /* cj2 = cj1-1 when even, cj1 otherwise	*/  
+                  cj2 = cj1 - !((j2-j1) % 2);
+
+                  b[base+u] = (g->cuboid[n][ci1][cj1] + g->cuboid[n][ci2][cj1] + 
+                               g->cuboid[n][ci1][cj2] + g->cuboid[n][ci2][cj2]) / 4;
+                  continue;
+              }
+
+              /* find the min/max/avg temperatures of the 
+               * grid cells in this block
                */
-              /* ci2 = ci1-1 when even, ci1 otherwise	*/  
-              ci2 = ci1 - !((i2-i1) % 2);
-              /* cj2 = cj1-1 when even, cj1 otherwise	*/  
-              cj2 = cj1 - !((j2-j1) % 2);
+              avg = 0.0;
+              count = 0;
+              min = max = g->cuboid[n][i1][j1];
+              for(i=i1; i < i2; i++)
+                for(j=j1; j < j2; j++) {
+                    avg += g->cuboid[n][i][j];
+                    if (g->cuboid[n][i][j] < min)
+                      min = g->cuboid[n][i][j];
+                    if (g->cuboid[n][i][j] > max)
+                      max = g->cuboid[n][i][j];
+                    count++;
+                }
 
-              b[base+u] = (g->cuboid[n][ci1][cj1] + g->cuboid[n][ci2][cj1] + 
-                           g->cuboid[n][ci1][cj2] + g->cuboid[n][ci2][cj2]) / 4;
-              continue;
+              /* map to output accordingly	*/
+              switch (model->map_mode)
+                {
+                case GRID_AVG:
+                  b[base+u] = avg / count;
+                  break;
+                case GRID_MIN:
+                  b[base+u] = min;
+                  break;
+                case GRID_MAX:
+                  b[base+u] = max;
+                  break;
+                  /* taken care of already	*/	
+                case GRID_CENTER:
+                  break;
+                default:
+                  fatal("unknown mapping mode\n");
+                  break;
+                }
           }
-
-          /* find the min/max/avg temperatures of the 
-           * grid cells in this block
+          /* keep track of the beginning address of this layer in the 
+           * block power vector
            */
-          avg = 0.0;
-          count = 0;
-          min = max = g->cuboid[n][i1][j1];
-          for(i=i1; i < i2; i++)
-            for(j=j1; j < j2; j++) {
-                avg += g->cuboid[n][i][j];
-                if (g->cuboid[n][i][j] < min)
-                  min = g->cuboid[n][i][j];
-                if (g->cuboid[n][i][j] > max)
-                  max = g->cuboid[n][i][j];
-                count++;
-            }
-
-          /* map to output accordingly	*/
-          switch (model->map_mode)
-            {
-            case GRID_AVG:
-              b[base+u] = avg / count;
-              break;
-            case GRID_MIN:
-              b[base+u] = min;
-              break;
-            case GRID_MAX:
-              b[base+u] = max;
-              break;
-              /* taken care of already	*/	
-            case GRID_CENTER:
-              break;
-            default:
-              fatal("unknown mapping mode\n");
-              break;
-            }
+          base += model->layers[n].flp->n_units;							 
       }
-      /* keep track of the beginning address of this layer in the 
-       * block power vector
-       */
-      base += model->layers[n].flp->n_units;							 
   }
 
   /* extra spreader and sink nodes	*/
@@ -1820,7 +2272,7 @@ void set_internal_power_grid(grid_model_t *model, double *power)
  * heuristically (ignoring the lateral resistances)
  */
 void set_heuristic_temp(grid_model_t *model, grid_model_vector_t *power, 
-                        grid_model_vector_t *temp)
+                        grid_model_vector_t *temp, double ambient)
 {
   int n, i, j, nl, nr, nc;
   double **sum;
@@ -1839,8 +2291,7 @@ void set_heuristic_temp(grid_model_t *model, grid_model_vector_t *power,
     temp->extra[SINK_C_N] = temp->extra[SINK_C_S] = 
     temp->extra[SINK_C_E] = temp->extra[SINK_C_W] = 
     temp->extra[SP_N] = temp->extra[SP_S] = 
-    temp->extra[SP_E] = temp->extra[SP_W] =
-    model->config.ambient;
+    temp->extra[SP_E] = temp->extra[SP_W] = ambient;
 
   if (model->config.model_secondary) {
       temp->extra[PCB_N] = temp->extra[PCB_S] = 
@@ -1850,20 +2301,22 @@ void set_heuristic_temp(grid_model_t *model, grid_model_vector_t *power,
         temp->extra[SOLDER_N] = temp->extra[SOLDER_S] =
         temp->extra[SOLDER_E] = temp->extra[SOLDER_W] = 
         temp->extra[SUB_N] = temp->extra[SUB_S] = 
-        temp->extra[SUB_E] = temp->extra[SUB_W] =
-        model->config.ambient;
+        temp->extra[SUB_E] = temp->extra[SUB_W] = ambient;
   }
 
   /* layer temperatures	*/
-  /* add up power for each grid cell across all layers */
-  sum = dmatrix(nr, nc);
+  /* add up power for each grid cell across all layers. the
+   * residual work vector of this level is free to hold it
+   */
+  sum = model->work[model->level].res->cuboid[0];
+  zero_dvector(sum[0], nr*nc);
   for(n=0; n < nl; n++)
     scaleadd_dvector(sum[0], sum[0], power->cuboid[n][0], nr*nc, 1.0);
 
   /* last layer	*/
   for(i=0; i < nr; i++)
     for(j=0; j < nc; j++)
-      temp->cuboid[nl-1][i][j] = model->config.ambient + sum[i][j] * 
+      temp->cuboid[nl-1][i][j] = ambient + sum[i][j] * 
         model->layers[nl-1].rz;
   /* subtract away the layer's power	*/			
   scaleadd_dvector(sum[0], sum[0], power->cuboid[nl-1][0], nr*nc, -1.0);
@@ -1876,12 +2329,34 @@ void set_heuristic_temp(grid_model_t *model, grid_model_vector_t *power,
       /* subtract away the layer's power	*/			
       scaleadd_dvector(sum[0], sum[0], power->cuboid[n][0], nr*nc, -1.0);
   } 
-  free_dmatrix(sum); 
 }
 
-/* single steady state iteration of grid solver - package part */
-double single_iteration_steady_pack(grid_model_t *model, grid_model_vector_t *power,
-                                    grid_model_vector_t *temp)
+/* update a package node's temperature in a steady state iteration
+ * or, if 'res' is not NULL, compute its residual (and its diagonal
+ * in 'diag') instead. when solving for an implicit transient step, 
+ * the node's capacitance adds to the conductances and power->extra 
+ * holds the matching C/h * T term. otherwise, power->extra is zero
+ * except in the residual equations of the multigrid preconditioner
+ */
+#define UPDATE_PACK_NODE(x)	do {										\
+  double cs = csum;														\
+  if (model->implicit_h > 0)											\
+    cs += model->pack_cap[x] / model->implicit_h;						\
+  wsum += power->extra[x];												\
+  if (res) {															\
+      res[x] = wsum - cs * v[x];										\
+      if (diag)															\
+        diag[x] = cs;													\
+  } else {																\
+      delta[x] = fabs(v[x] - wsum / cs);								\
+      v[x] = wsum / cs;													\
+  }																		\
+} while (0)
+
+/* package part of the steady state iterations (see UPDATE_PACK_NODE)	*/
+static double steady_pack_grid(grid_model_t *model, grid_model_vector_t *power,
+                               grid_model_vector_t *temp, double ambient,
+                               double *res, double *diag)
 {
   int i, j;
 
@@ -1894,7 +2369,6 @@ double single_iteration_steady_pack(grid_model_t *model, grid_model_vector_t *po
   /* shortcuts	*/
   double *v = temp->extra;
   package_RC_t *pk = &model->pack;
-  thermal_config_t *c = &model->config;
   layer_t *l = model->layers;
   int nl = model->n_layers;
   int nr = model->rows;
@@ -1912,21 +2386,17 @@ double single_iteration_steady_pack(grid_model_t *model, grid_model_vector_t *po
 
   /* sink outer north/south	*/
   csum = 1.0/(pk->r_hs_per + pk->r_amb_per) + 1.0/(pk->r_hs2_y + pk->r_hs);
-  wsum = c->ambient/(pk->r_hs_per + pk->r_amb_per) + v[SINK_C_N]/(pk->r_hs2_y + pk->r_hs);
-  delta[SINK_N] = fabs(v[SINK_N] - wsum / csum);
-  v[SINK_N] = wsum / csum;
-  wsum = c->ambient/(pk->r_hs_per + pk->r_amb_per) + v[SINK_C_S]/(pk->r_hs2_y + pk->r_hs);
-  delta[SINK_S] = fabs(v[SINK_S] - wsum / csum);
-  v[SINK_S] = wsum / csum;
+  wsum = ambient/(pk->r_hs_per + pk->r_amb_per) + v[SINK_C_N]/(pk->r_hs2_y + pk->r_hs);
+  UPDATE_PACK_NODE(SINK_N);
+  wsum = ambient/(pk->r_hs_per + pk->r_amb_per) + v[SINK_C_S]/(pk->r_hs2_y + pk->r_hs);
+  UPDATE_PACK_NODE(SINK_S);
 
   /* sink outer west/east	*/
   csum = 1.0/(pk->r_hs_per + pk->r_amb_per) + 1.0/(pk->r_hs2_x + pk->r_hs);
-  wsum = c->ambient/(pk->r_hs_per + pk->r_amb_per) + v[SINK_C_W]/(pk->r_hs2_x + pk->r_hs);
-  delta[SINK_W] = fabs(v[SINK_W] - wsum / csum);
-  v[SINK_W] = wsum / csum;
-  wsum = c->ambient/(pk->r_hs_per + pk->r_amb_per) + v[SINK_C_E]/(pk->r_hs2_x + pk->r_hs);
-  delta[SINK_E] = fabs(v[SINK_E] - wsum / csum);
-  v[SINK_E] = wsum / csum;
+  wsum = ambient/(pk->r_hs_per + pk->r_amb_per) + v[SINK_C_W]/(pk->r_hs2_x + pk->r_hs);
+  UPDATE_PACK_NODE(SINK_W);
+  wsum = ambient/(pk->r_hs_per + pk->r_amb_per) + v[SINK_C_E]/(pk->r_hs2_x + pk->r_hs);
+  UPDATE_PACK_NODE(SINK_E);
 
   /* sink inner north/south	*/
   /* partition r_hs1_y among all the nc grid cells. edge cell has half the ry */
@@ -1938,19 +2408,17 @@ double single_iteration_steady_pack(grid_model_t *model, grid_model_vector_t *po
   for(j=0; j < nc; j++)
     wsum += temp->cuboid[hsidx][0][j];
   wsum /= (l[hsidx].ry / 2.0 + nc * pk->r_hs1_y);
-  wsum += c->ambient/(pk->r_hs_c_per_y + pk->r_amb_c_per_y) + 
+  wsum += ambient/(pk->r_hs_c_per_y + pk->r_amb_c_per_y) + 
     v[SP_N]/pk->r_sp_per_y + v[SINK_N]/(pk->r_hs2_y + pk->r_hs);
-  delta[SINK_C_N] = fabs(v[SINK_C_N] - wsum / csum);
-  v[SINK_C_N] = wsum / csum;
+  UPDATE_PACK_NODE(SINK_C_N);
 
   wsum = 0.0;
   for(j=0; j < nc; j++)
     wsum += temp->cuboid[hsidx][nr-1][j];
   wsum /= (l[hsidx].ry / 2.0 + nc * pk->r_hs1_y);
-  wsum += c->ambient/(pk->r_hs_c_per_y + pk->r_amb_c_per_y) + 
+  wsum += ambient/(pk->r_hs_c_per_y + pk->r_amb_c_per_y) + 
     v[SP_S]/pk->r_sp_per_y + v[SINK_S]/(pk->r_hs2_y + pk->r_hs);
-  delta[SINK_C_S] = fabs(v[SINK_C_S] - wsum / csum);
-  v[SINK_C_S] = wsum / csum;
+  UPDATE_PACK_NODE(SINK_C_S);
 
   /* sink inner west/east	*/
   /* partition r_hs1_x among all the nr grid cells. edge cell has half the rx */
@@ -1962,19 +2430,17 @@ double single_iteration_steady_pack(grid_model_t *model, grid_model_vector_t *po
   for(i=0; i < nr; i++)
     wsum += temp->cuboid[hsidx][i][0];
   wsum /= (l[hsidx].rx / 2.0 + nr * pk->r_hs1_x);
-  wsum += c->ambient/(pk->r_hs_c_per_x + pk->r_amb_c_per_x) + 
+  wsum += ambient/(pk->r_hs_c_per_x + pk->r_amb_c_per_x) + 
     v[SP_W]/pk->r_sp_per_x + v[SINK_W]/(pk->r_hs2_x + pk->r_hs);
-  delta[SINK_C_W] = fabs(v[SINK_C_W] - wsum / csum);
-  v[SINK_C_W] = wsum / csum;
+  UPDATE_PACK_NODE(SINK_C_W);
 
   wsum = 0.0;
   for(i=0; i < nr; i++)
     wsum += temp->cuboid[hsidx][i][nc-1];
   wsum /= (l[hsidx].rx / 2.0 + nr * pk->r_hs1_x);
-  wsum += c->ambient/(pk->r_hs_c_per_x + pk->r_amb_c_per_x) + 
+  wsum += ambient/(pk->r_hs_c_per_x + pk->r_amb_c_per_x) + 
     v[SP_E]/pk->r_sp_per_x + v[SINK_E]/(pk->r_hs2_x + pk->r_hs);
-  delta[SINK_C_E] = fabs(v[SINK_C_E] - wsum / csum);
-  v[SINK_C_E] = wsum / csum;
+  UPDATE_PACK_NODE(SINK_C_E);
 
   /* spreader north/south	*/
   /* partition r_sp1_y among all the nc grid cells. edge cell has half the ry */
@@ -1986,16 +2452,14 @@ double single_iteration_steady_pack(grid_model_t *model, grid_model_vector_t *po
     wsum += temp->cuboid[spidx][0][j];
   wsum /= (l[spidx].ry / 2.0 + nc * pk->r_sp1_y);
   wsum += v[SINK_C_N]/pk->r_sp_per_y;
-  delta[SP_N] = fabs(v[SP_N] - wsum / csum);
-  v[SP_N] = wsum / csum;
+  UPDATE_PACK_NODE(SP_N);
 
   wsum = 0.0;
   for(j=0; j < nc; j++)
     wsum += temp->cuboid[spidx][nr-1][j];
   wsum /= (l[spidx].ry / 2.0 + nc * pk->r_sp1_y);
   wsum += v[SINK_C_S]/pk->r_sp_per_y;
-  delta[SP_S] = fabs(v[SP_S] - wsum / csum);
-  v[SP_S] = wsum / csum;
+  UPDATE_PACK_NODE(SP_S);
 
   /* spreader west/east	*/
   /* partition r_sp1_x among all the nr grid cells. edge cell has half the rx */
@@ -2007,36 +2471,30 @@ double single_iteration_steady_pack(grid_model_t *model, grid_model_vector_t *po
     wsum += temp->cuboid[spidx][i][0];
   wsum /= (l[spidx].rx / 2.0 + nr * pk->r_sp1_x);
   wsum += v[SINK_C_W]/pk->r_sp_per_x;
-  delta[SP_W] = fabs(v[SP_W] - wsum / csum);
-  v[SP_W] = wsum / csum;
+  UPDATE_PACK_NODE(SP_W);
 
   wsum = 0.0;
   for(i=0; i < nr; i++)
     wsum += temp->cuboid[spidx][i][nc-1];
   wsum /= (l[spidx].rx / 2.0 + nr * pk->r_sp1_x);
   wsum += v[SINK_C_E]/pk->r_sp_per_x;
-  delta[SP_E] = fabs(v[SP_E] - wsum / csum);
-  v[SP_E] = wsum / csum;
+  UPDATE_PACK_NODE(SP_E);
 
   if (model->config.model_secondary) {
       /* secondary path package nodes */
       /* PCB outer north/south	*/
       csum = 1.0/(pk->r_amb_sec_per) + 1.0/(pk->r_pcb2_y + pk->r_pcb);
-      wsum = c->ambient/(pk->r_amb_sec_per) + v[PCB_C_N]/(pk->r_pcb2_y + pk->r_pcb);
-      delta[PCB_N] = fabs(v[PCB_N] - wsum / csum);
-      v[PCB_N] = wsum / csum;
-      wsum = c->ambient/(pk->r_amb_sec_per) + v[PCB_C_S]/(pk->r_pcb2_y + pk->r_pcb);
-      delta[PCB_S] = fabs(v[PCB_S] - wsum / csum);
-      v[PCB_S] = wsum / csum;
+      wsum = ambient/(pk->r_amb_sec_per) + v[PCB_C_N]/(pk->r_pcb2_y + pk->r_pcb);
+      UPDATE_PACK_NODE(PCB_N);
+      wsum = ambient/(pk->r_amb_sec_per) + v[PCB_C_S]/(pk->r_pcb2_y + pk->r_pcb);
+      UPDATE_PACK_NODE(PCB_S);
 
       /* PCB outer west/east	*/
       csum = 1.0/(pk->r_amb_sec_per) + 1.0/(pk->r_pcb2_x + pk->r_pcb);
-      wsum = c->ambient/(pk->r_amb_sec_per) + v[PCB_C_W]/(pk->r_pcb2_x + pk->r_pcb);
-      delta[PCB_W] = fabs(v[PCB_W] - wsum / csum);
-      v[PCB_W] = wsum / csum;
-      wsum = c->ambient/(pk->r_amb_sec_per) + v[PCB_C_E]/(pk->r_pcb2_x + pk->r_pcb);
-      delta[PCB_E] = fabs(v[PCB_E] - wsum / csum);
-      v[PCB_E] = wsum / csum;
+      wsum = ambient/(pk->r_amb_sec_per) + v[PCB_C_W]/(pk->r_pcb2_x + pk->r_pcb);
+      UPDATE_PACK_NODE(PCB_W);
+      wsum = ambient/(pk->r_amb_sec_per) + v[PCB_C_E]/(pk->r_pcb2_x + pk->r_pcb);
+      UPDATE_PACK_NODE(PCB_E);
 
       /* PCB inner north/south	*/
       /* partition r_pcb1_y among all the nc grid cells. edge cell has half the ry */
@@ -2048,19 +2506,17 @@ double single_iteration_steady_pack(grid_model_t *model, grid_model_vector_t *po
       for(j=0; j < nc; j++)
         wsum += temp->cuboid[pcbidx][0][j];
       wsum /= (l[pcbidx].ry / 2.0 + nc * pk->r_pcb1_y);
-      wsum += c->ambient/(pk->r_amb_sec_c_per_y) + 
+      wsum += ambient/(pk->r_amb_sec_c_per_y) + 
         v[SOLDER_N]/pk->r_pcb_c_per_y + v[PCB_N]/(pk->r_pcb2_y + pk->r_pcb);
-      delta[PCB_C_N] = fabs(v[PCB_C_N] - wsum / csum);
-      v[PCB_C_N] = wsum / csum;
+      UPDATE_PACK_NODE(PCB_C_N);
 
       wsum = 0.0;
       for(j=0; j < nc; j++)
         wsum += temp->cuboid[pcbidx][nr-1][j];
       wsum /= (l[pcbidx].ry / 2.0 + nc * pk->r_pcb1_y);
-      wsum += c->ambient/(pk->r_amb_sec_c_per_y) + 
+      wsum += ambient/(pk->r_amb_sec_c_per_y) + 
         v[SOLDER_S]/pk->r_pcb_c_per_y + v[PCB_S]/(pk->r_pcb2_y + pk->r_pcb);
-      delta[PCB_C_S] = fabs(v[PCB_C_S] - wsum / csum);
-      v[PCB_C_S] = wsum / csum;
+      UPDATE_PACK_NODE(PCB_C_S);
 
       /* PCB inner west/east	*/
       /* partition r_pcb1_x among all the nr grid cells. edge cell has half the rx */
@@ -2072,19 +2528,17 @@ double single_iteration_steady_pack(grid_model_t *model, grid_model_vector_t *po
       for(i=0; i < nr; i++)
         wsum += temp->cuboid[pcbidx][i][0];
       wsum /= (l[pcbidx].rx / 2.0 + nr * pk->r_pcb1_x);
-      wsum += c->ambient/(pk->r_amb_sec_c_per_x) + 
+      wsum += ambient/(pk->r_amb_sec_c_per_x) + 
         v[SOLDER_W]/pk->r_pcb_c_per_x + v[PCB_W]/(pk->r_pcb2_x + pk->r_pcb);
-      delta[PCB_C_W] = fabs(v[PCB_C_W] - wsum / csum);
-      v[PCB_C_W] = wsum / csum;
+      UPDATE_PACK_NODE(PCB_C_W);
 
       wsum = 0.0;
       for(i=0; i < nr; i++)
         wsum += temp->cuboid[pcbidx][i][nc-1];
       wsum /= (l[pcbidx].rx / 2.0 + nr * pk->r_pcb1_x);
-      wsum += c->ambient/(pk->r_amb_sec_c_per_x) + 
+      wsum += ambient/(pk->r_amb_sec_c_per_x) + 
         v[SOLDER_E]/pk->r_pcb_c_per_x + v[PCB_E]/(pk->r_pcb2_x + pk->r_pcb);
-      delta[PCB_C_E] = fabs(v[PCB_C_E] - wsum / csum);
-      v[PCB_C_E] = wsum / csum;
+      UPDATE_PACK_NODE(PCB_C_E);
 
       /* solder north/south	*/
       /* partition r_solder1_y among all the nc grid cells. edge cell has half the ry */
@@ -2096,16 +2550,14 @@ double single_iteration_steady_pack(grid_model_t *model, grid_model_vector_t *po
         wsum += temp->cuboid[solderidx][0][j];
       wsum /= (l[solderidx].ry / 2.0 + nc * pk->r_solder1_y);
       wsum += v[PCB_C_N]/pk->r_pcb_c_per_y + v[SUB_N]/pk->r_solder_per_y;
-      delta[SOLDER_N] = fabs(v[SOLDER_N] - wsum / csum);
-      v[SOLDER_N] = wsum / csum;
+      UPDATE_PACK_NODE(SOLDER_N);
 
       wsum = 0.0;
       for(j=0; j < nc; j++)
         wsum += temp->cuboid[solderidx][nr-1][j];
       wsum /= (l[solderidx].ry / 2.0 + nc * pk->r_solder1_y);
       wsum += v[PCB_C_S]/pk->r_pcb_c_per_y + v[SUB_S]/pk->r_solder_per_y;
-      delta[SOLDER_S] = fabs(v[SOLDER_S] - wsum / csum);
-      v[SOLDER_S] = wsum / csum;
+      UPDATE_PACK_NODE(SOLDER_S);
 
       /* solder west/east	*/
       /* partition r_solder1_x among all the nr grid cells. edge cell has half the rx */
@@ -2117,16 +2569,14 @@ double single_iteration_steady_pack(grid_model_t *model, grid_model_vector_t *po
         wsum += temp->cuboid[solderidx][i][0];
       wsum /= (l[solderidx].rx / 2.0 + nr * pk->r_solder1_x);
       wsum += v[PCB_C_W]/pk->r_pcb_c_per_x + v[SUB_W]/pk->r_solder_per_x;
-      delta[SOLDER_W] = fabs(v[SOLDER_W] - wsum / csum);
-      v[SOLDER_W] = wsum / csum;
+      UPDATE_PACK_NODE(SOLDER_W);
 
       wsum = 0.0;
       for(i=0; i < nr; i++)
         wsum += temp->cuboid[solderidx][i][nc-1];
       wsum /= (l[solderidx].rx / 2.0 + nr * pk->r_solder1_x);
       wsum += v[PCB_C_E]/pk->r_pcb_c_per_x + v[SUB_E]/pk->r_solder_per_x;
-      delta[SOLDER_E] = fabs(v[SOLDER_E] - wsum / csum);
-      v[SOLDER_E] = wsum / csum; 
+      UPDATE_PACK_NODE(SOLDER_E);
 
       /* substrate north/south	*/
       /* partition r_sub1_y among all the nc grid cells. edge cell has half the ry */
@@ -2138,16 +2588,14 @@ double single_iteration_steady_pack(grid_model_t *model, grid_model_vector_t *po
         wsum += temp->cuboid[subidx][0][j];
       wsum /= (l[subidx].ry / 2.0 + nc * pk->r_sub1_y);
       wsum += v[SOLDER_N]/pk->r_solder_per_y;
-      delta[SUB_N] = fabs(v[SUB_N] - wsum / csum);
-      v[SUB_N] = wsum / csum;
+      UPDATE_PACK_NODE(SUB_N);
 
       wsum = 0.0;
       for(j=0; j < nc; j++)
         wsum += temp->cuboid[subidx][nr-1][j];
       wsum /= (l[subidx].ry / 2.0 + nc * pk->r_sub1_y);
       wsum += v[SOLDER_S]/pk->r_solder_per_y;
-      delta[SUB_S] = fabs(v[SUB_S] - wsum / csum);
-      v[SUB_S] = wsum / csum;
+      UPDATE_PACK_NODE(SUB_S);
 
       /* substrate west/east	*/
       /* partition r_sub1_x among all the nr grid cells. edge cell has half the rx */
@@ -2159,18 +2607,18 @@ double single_iteration_steady_pack(grid_model_t *model, grid_model_vector_t *po
         wsum += temp->cuboid[subidx][i][0];
       wsum /= (l[subidx].rx / 2.0 + nr * pk->r_sub1_x);
       wsum += v[SOLDER_W]/pk->r_solder_per_x;
-      delta[SUB_W] = fabs(v[SUB_W] - wsum / csum);
-      v[SUB_W] = wsum / csum;
+      UPDATE_PACK_NODE(SUB_W);
 
       wsum = 0.0;
       for(i=0; i < nr; i++)
         wsum += temp->cuboid[subidx][i][nc-1];
       wsum /= (l[subidx].rx / 2.0 + nr * pk->r_sub1_x);
       wsum += v[SOLDER_E]/pk->r_solder_per_x;
-      delta[SUB_E] = fabs(v[SUB_E] - wsum / csum);
-      v[SUB_E] = wsum / csum;
+      UPDATE_PACK_NODE(SUB_E);
   } 
 
+  if (res)
+    return 0;
   if (!model->config.model_secondary) {
       for(i=0; i < EXTRA; i++) {
           if (delta[i] > max)
@@ -2185,6 +2633,13 @@ double single_iteration_steady_pack(grid_model_t *model, grid_model_vector_t *po
   return max;
 }
 
+/* single steady state iteration of grid solver - package part */
+double single_iteration_steady_pack(grid_model_t *model, grid_model_vector_t *power,
+                                    grid_model_vector_t *temp, double ambient)
+{
+  return steady_pack_grid(model, power, temp, ambient, NULL, NULL);
+}
+
 /* macros for calculating conductances	*/
 /* conductance to the next cell north. zero if on northern boundary	*/
 # define NC(l,n,i,j,nl,nr,nc)		((i > 0) ? (1.0/l[n].ry) : 0.0)
@@ -2213,61 +2668,33 @@ double single_iteration_steady_pack(grid_model_t *model, grid_model_vector_t *po
 /* weighted T of the next cell above. zero if on top face			*/
 # define AT(l,v,n,i,j,nl,nr,nc)		((n > 0) ? (v[n-1][i][j]/l[n-1].rz) : 0.0)
 
-//BU_3D: These are the same macros as above except that they have to check
-//for a resistivity value first since the detailed 3D  model is not uniform across the layer
-/* macros for calculating conductances	*/
-/* conductance to the next cell north. zero if on northern boundary	*/
-# define NC_det3D(l,n,i,j,nl,nr,nc)		((i > 0) ? (1.0/find_res_3D(n, i-1, j, model,2)) : 0.0)
-/* conductance to the next cell south. zero if on southern boundary	*/
-# define SC_det3D(l,n,i,j,nl,nr,nc)		((i < nr-1) ? (1.0/find_res_3D(n, i+1, j, model,2)) : 0.0)
-/* conductance to the next cell east. zero if on eastern boundary	*/
-# define EC_det3D(l,n,i,j,nl,nr,nc)		((j < nc-1) ? (1.0/find_res_3D(n, i, j+1, model,1)) : 0.0)
-/* conductance to the next cell west. zero if on western boundary	*/
-# define WC_det3D(l,n,i,j,nl,nr,nc)		((j > 0) ? (1.0/find_res_3D(n, i, j-1, model,1)) : 0.0)
-/* conductance to the next cell below. zero if on bottom face		*/
-# define BC_det3D(l,n,i,j,nl,nr,nc)		((n < nl-1) ? (1.0/find_res_3D(n, i, j, model,3)) : 0.0)
-/* conductance to the next cell above. zero if on top face			*/
-# define AC_det3D(l,n,i,j,nl,nr,nc)		((n > 0) ? (1.0/find_res_3D(n-1, i, j, model,3)) : 0.0)
-
-/* macros for calculating weighted temperatures	*/
-/* weighted T of the next cell north. zero if on northern boundary	*/
-# define NT_det3D(l,v,n,i,j,nl,nr,nc)		((i > 0) ? (v[n][i-1][j]/find_res_3D(n, i-1, j, model,2)) : 0.0)
-/* weighted T of the next cell south. zero if on southern boundary	*/
-# define ST_det3D(l,v,n,i,j,nl,nr,nc)		((i < nr-1) ? (v[n][i+1][j]/find_res_3D(n, i+1, j, model,2)) : 0.0)
-/* weighted T of the next cell east. zero if on eastern boundary	*/
-# define ET_det3D(l,v,n,i,j,nl,nr,nc)		((j < nc-1) ? (v[n][i][j+1]/find_res_3D(n, i, j+1, model,1)) : 0.0)
-/* weighted T of the next cell west. zero if on western boundary	*/
-# define WT_det3D(l,v,n,i,j,nl,nr,nc)		((j > 0) ? (v[n][i][j-1]/find_res_3D(n, i, j-1, model,1)) : 0.0)
-/* weighted T of the next cell below. zero if on bottom face		*/
-# define BT_det3D(l,v,n,i,j,nl,nr,nc)		((n < nl-1) ? (v[n+1][i][j]/find_res_3D(n, i, j, model,3)) : 0.0)
-/* weighted T of the next cell above. zero if on top face			*/
-# define AT_det3D(l,v,n,i,j,nl,nr,nc)		((n > 0) ? (v[n-1][i][j]/find_res_3D(n-1, i, j, model,3)) : 0.0)
-//end->BU_3D
 
-/* single steady state iteration of grid solver - silicon part */
-double single_iteration_steady_grid(grid_model_t *model, grid_model_vector_t *power,
-                                    grid_model_vector_t *temp)
+/* sum of the conductances of grid cell (n, i, j) to its neighbours
+ * (csum) and the weighted sum of their temperatures (wsum, including 
+ * the ambient). 'baked' tells if the per cell conductances are valid
+ * for the current grid level. otherwise, the per layer values are used
+ */
+static inline void sum_cell_steady_grid(grid_model_t *model, grid_model_vector_t *temp, 
+                                        int n, int i, int j, int baked, double ambient,
+                                        double *csum_out, double *wsum_out)
 {
-  int n, i, j;
-  double prev, delta, max = 0;
+  int k = (n * model->rows + i) * model->cols + j;
   /* sum of the conductances	*/
   double csum;
   /* weighted sum of temperatures	*/
   double wsum;
 
-  /* shortcuts for cell width(cw) and cell height(ch)	*/
-  double cw = model->width / model->cols;
-  double ch = model->height / model->rows;
-
   /* shortcuts	*/
   double ***v = temp->cuboid;
-  thermal_config_t *c = &model->config;
+  double *t = temp->cuboid[0][0];
   layer_t *l = model->layers;
   int nl = model->n_layers;
   int nr = model->rows;
   int nc = model->cols;
   int spidx, hsidx, subidx, solderidx, pcbidx;
   int model_secondary = model->config.model_secondary;
+  double *gn = model->g_n, *gs = model->g_s, *ge = model->g_e;
+  double *gw = model->g_w, *ga = model->g_a, *gb = model->g_b;
 
   spidx = nl - DEFAULT_PACK_LAYERS + LAYER_SP;
   hsidx = nl - DEFAULT_PACK_LAYERS + LAYER_SINK;
@@ -2277,166 +2704,235 @@ double single_iteration_steady_grid(grid_model_t *model, grid_model_vector_t *po
       pcbidx = LAYER_PCB;	
   }
 
-  /* for each grid cell	*/
-  for(n=0; n < nl; n++) {
-      for(i=0; i < nr; i++) {
-          for(j=0; j < nc; j++) {
-              /* sum the conductances to cells north, south, 
-               * east, west, above and below
-               */
-              // BU_3D: call new macros if detailed_3D model is used 
-              // the spreader/heat sink layers will use uniform R
-              if(model->config.detailed_3D_used == 1){
-                  csum = NC_det3D(l,n,i,j,nl,nr,nc) + SC_det3D(l,n,i,j,nl,nr,nc) + 
-                    EC_det3D(l,n,i,j,nl,nr,nc) + WC_det3D(l,n,i,j,nl,nr,nc) + 
-                    AC_det3D(l,n,i,j,nl,nr,nc) + BC_det3D(l,n,i,j,nl,nr,nc);
-
-                  /* sum of the weighted temperatures of all the neighbours*/	
-                  wsum = NT_det3D(l,v,n,i,j,nl,nr,nc) + ST_det3D(l,v,n,i,j,nl,nr,nc) + 
-                    ET_det3D(l,v,n,i,j,nl,nr,nc) + WT_det3D(l,v,n,i,j,nl,nr,nc) + 
-                    AT_det3D(l,v,n,i,j,nl,nr,nc) + BT_det3D(l,v,n,i,j,nl,nr,nc);
-              } //end->BU_3D
-              else {	
-                  csum = NC(l,n,i,j,nl,nr,nc) + SC(l,n,i,j,nl,nr,nc) + 
-                    EC(l,n,i,j,nl,nr,nc) + WC(l,n,i,j,nl,nr,nc) + 
-                    AC(l,n,i,j,nl,nr,nc) + BC(l,n,i,j,nl,nr,nc);
-
-                  /* sum of the weighted temperatures of all the neighbours	*/
-                  wsum = NT(l,v,n,i,j,nl,nr,nc) + ST(l,v,n,i,j,nl,nr,nc) + 
-                    ET(l,v,n,i,j,nl,nr,nc) + WT(l,v,n,i,j,nl,nr,nc) + 
-                    AT(l,v,n,i,j,nl,nr,nc) + BT(l,v,n,i,j,nl,nr,nc);
-              } 
-
-              /* spreader core is connected to its periphery	*/
-              if (n == spidx) {
-                  /* northern boundary - edge cell has half the ry	*/
-                  if (i == 0) {
-                      csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_sp1_y); 
-                      wsum += temp->extra[SP_N]/(l[n].ry/2.0 + nc*model->pack.r_sp1_y); 
-                  }
-                  /* southern boundary - edge cell has half the ry	*/
-                  if (i == nr-1) {
-                      csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_sp1_y); 
-                      wsum += temp->extra[SP_S]/(l[n].ry/2.0 + nc*model->pack.r_sp1_y); 
-                  }
-                  /* eastern boundary	 - edge cell has half the rx	*/
-                  if (j == nc-1) {
-                      csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_sp1_x); 
-                      wsum += temp->extra[SP_E]/(l[n].rx/2.0 + nr*model->pack.r_sp1_x); 
-                  }
-                  /* western boundary	- edge cell has half the rx		*/
-                  if (j == 0) {
-                      csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_sp1_x); 
-                      wsum += temp->extra[SP_W]/(l[n].rx/2.0 + nr*model->pack.r_sp1_x); 
-                  }
-                  /* heatsink core is connected to its inner periphery and ambient	*/
-              } else if (n == hsidx) {
-                  /* all nodes are connected to the ambient	*/
-                  csum += 1.0/l[n].rz;
-                  wsum += c->ambient/l[n].rz;
-                  /* northern boundary - edge cell has half the ry	*/
-                  if (i == 0) {
-                      csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_hs1_y); 
-                      wsum += temp->extra[SINK_C_N]/(l[n].ry/2.0 + nc*model->pack.r_hs1_y); 
-                  }
-                  /* southern boundary - edge cell has half the ry	*/
-                  if (i == nr-1) {
-                      csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_hs1_y); 
-                      wsum += temp->extra[SINK_C_S]/(l[n].ry/2.0 + nc*model->pack.r_hs1_y); 
-                  }
-                  /* eastern boundary	 - edge cell has half the rx	*/
-                  if (j == nc-1) {
-                      csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_hs1_x); 
-                      wsum += temp->extra[SINK_C_E]/(l[n].rx/2.0 + nr*model->pack.r_hs1_x); 
-                  }
-                  /* western boundary	- edge cell has half the rx		*/
-                  if (j == 0) {
-                      csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_hs1_x); 
-                      wsum += temp->extra[SINK_C_W]/(l[n].rx/2.0 + nr*model->pack.r_hs1_x); 
-                  }
-              } else if ((n==subidx) && model->config.model_secondary) {
-                  /* northern boundary - edge cell has half the ry	*/
-                  if (i == 0) {
-                      csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_sub1_y); 
-                      wsum += temp->extra[SUB_N]/(l[n].ry/2.0 + nc*model->pack.r_sub1_y); 
-                  }
-                  /* southern boundary - edge cell has half the ry	*/
-                  if (i == nr-1) {
-                      csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_sub1_y); 
-                      wsum += temp->extra[SUB_S]/(l[n].ry/2.0 + nc*model->pack.r_sub1_y); 
-                  }
-                  /* eastern boundary	 - edge cell has half the rx	*/
-                  if (j == nc-1) {
-                      csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_sub1_x); 
-                      wsum += temp->extra[SUB_E]/(l[n].rx/2.0 + nr*model->pack.r_sub1_x); 
-                  }
-                  /* western boundary	- edge cell has half the rx		*/
-                  if (j == 0) {
-                      csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_sub1_x); 
-                      wsum += temp->extra[SUB_W]/(l[n].rx/2.0 + nr*model->pack.r_sub1_x); 
-                  } 
-              } else if ((n==solderidx) && model->config.model_secondary) {
-                  /* northern boundary - edge cell has half the ry	*/
-                  if (i == 0) {
-                      csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_solder1_y); 
-                      wsum += temp->extra[SOLDER_N]/(l[n].ry/2.0 + nc*model->pack.r_solder1_y); 
-                  }
-                  /* southern boundary - edge cell has half the ry	*/
-                  if (i == nr-1) {
-                      csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_solder1_y); 
-                      wsum += temp->extra[SOLDER_S]/(l[n].ry/2.0 + nc*model->pack.r_solder1_y); 
-                  }
-                  /* eastern boundary	 - edge cell has half the rx	*/
-                  if (j == nc-1) {
-                      csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_solder1_x); 
-                      wsum += temp->extra[SOLDER_E]/(l[n].rx/2.0 + nr*model->pack.r_solder1_x); 
-                  }
-                  /* western boundary	- edge cell has half the rx		*/
-                  if (j == 0) {
-                      csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_solder1_x); 
-                      wsum += temp->extra[SOLDER_W]/(l[n].rx/2.0 + nr*model->pack.r_solder1_x); 
-                  } 
-              } else if ((n==pcbidx) && model->config.model_secondary) {
-                  /* all nodes are connected to the ambient	*/
-                  csum += 1.0/(model->config.r_convec_sec * 
-                               (model->config.s_pcb * model->config.s_pcb) / (cw * ch));
-                  wsum += c->ambient/(model->config.r_convec_sec * 
-                                      (model->config.s_pcb * model->config.s_pcb) / (cw * ch));
-                  /* northern boundary - edge cell has half the ry	*/
-                  if (i == 0) {
-                      csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_pcb1_y); 
-                      wsum += temp->extra[PCB_C_N]/(l[n].ry/2.0 + nc*model->pack.r_pcb1_y); 
-                  }
-                  /* southern boundary - edge cell has half the ry	*/
-                  if (i == nr-1) {
-                      csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_pcb1_y); 
-                      wsum += temp->extra[PCB_C_S]/(l[n].ry/2.0 + nc*model->pack.r_pcb1_y); 
-                  }
-                  /* eastern boundary	 - edge cell has half the rx	*/
-                  if (j == nc-1) {
-                      csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_pcb1_x); 
-                      wsum += temp->extra[PCB_C_E]/(l[n].rx/2.0 + nr*model->pack.r_pcb1_x); 
-                  }
-                  /* western boundary	- edge cell has half the rx		*/
-                  if (j == 0) {
-                      csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_pcb1_x); 
-                      wsum += temp->extra[PCB_C_W]/(l[n].rx/2.0 + nr*model->pack.r_pcb1_x); 
-                  }
-              }
+  /* sum the conductances to cells north, south, 
+   * east, west, above and below
+   */
+  if (baked) {
+      csum = gn[k] + gs[k] + ge[k] + gw[k] + ga[k] + gb[k];
+
+      /* sum of the weighted temperatures of all the neighbours	*/
+      wsum = ((i > 0) ? gn[k] * t[k-nc] : 0.0) + 
+        ((i < nr-1) ? gs[k] * t[k+nc] : 0.0) + 
+        ((j < nc-1) ? ge[k] * t[k+1] : 0.0) + 
+        ((j > 0) ? gw[k] * t[k-1] : 0.0) + 
+        ((n > 0) ? ga[k] * t[k-nr*nc] : 0.0) + 
+        ((n < nl-1) ? gb[k] * t[k+nr*nc] : 0.0);
+  } else {	
+      csum = NC(l,n,i,j,nl,nr,nc) + SC(l,n,i,j,nl,nr,nc) + 
+        EC(l,n,i,j,nl,nr,nc) + WC(l,n,i,j,nl,nr,nc) + 
+        AC(l,n,i,j,nl,nr,nc) + BC(l,n,i,j,nl,nr,nc);
+
+      /* sum of the weighted temperatures of all the neighbours	*/
+      wsum = NT(l,v,n,i,j,nl,nr,nc) + ST(l,v,n,i,j,nl,nr,nc) + 
+        ET(l,v,n,i,j,nl,nr,nc) + WT(l,v,n,i,j,nl,nr,nc) + 
+        AT(l,v,n,i,j,nl,nr,nc) + BT(l,v,n,i,j,nl,nr,nc);
+  } 
+
+  /* spreader core is connected to its periphery	*/
+  if (n == spidx) {
+      /* northern boundary - edge cell has half the ry	*/
+      if (i == 0) {
+          csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_sp1_y); 
+          wsum += temp->extra[SP_N]/(l[n].ry/2.0 + nc*model->pack.r_sp1_y); 
+      }
+      /* southern boundary - edge cell has half the ry	*/
+      if (i == nr-1) {
+          csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_sp1_y); 
+          wsum += temp->extra[SP_S]/(l[n].ry/2.0 + nc*model->pack.r_sp1_y); 
+      }
+      /* eastern boundary	 - edge cell has half the rx	*/
+      if (j == nc-1) {
+          csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_sp1_x); 
+          wsum += temp->extra[SP_E]/(l[n].rx/2.0 + nr*model->pack.r_sp1_x); 
+      }
+      /* western boundary	- edge cell has half the rx		*/
+      if (j == 0) {
+          csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_sp1_x); 
+          wsum += temp->extra[SP_W]/(l[n].rx/2.0 + nr*model->pack.r_sp1_x); 
+      }
+      /* heatsink core is connected to its inner periphery and ambient	*/
+  } else if (n == hsidx) {
+      /* all nodes are connected to the ambient	*/
+      csum += 1.0/l[n].rz;
+      wsum += ambient/l[n].rz;
+      /* northern boundary - edge cell has half the ry	*/
+      if (i == 0) {
+          csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_hs1_y); 
+          wsum += temp->extra[SINK_C_N]/(l[n].ry/2.0 + nc*model->pack.r_hs1_y); 
+      }
+      /* southern boundary - edge cell has half the ry	*/
+      if (i == nr-1) {
+          csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_hs1_y); 
+          wsum += temp->extra[SINK_C_S]/(l[n].ry/2.0 + nc*model->pack.r_hs1_y); 
+      }
+      /* eastern boundary	 - edge cell has half the rx	*/
+      if (j == nc-1) {
+          csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_hs1_x); 
+          wsum += temp->extra[SINK_C_E]/(l[n].rx/2.0 + nr*model->pack.r_hs1_x); 
+      }
+      /* western boundary	- edge cell has half the rx		*/
+      if (j == 0) {
+          csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_hs1_x); 
+          wsum += temp->extra[SINK_C_W]/(l[n].rx/2.0 + nr*model->pack.r_hs1_x); 
+      }
+  } else if ((n==subidx) && model->config.model_secondary) {
+      /* northern boundary - edge cell has half the ry	*/
+      if (i == 0) {
+          csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_sub1_y); 
+          wsum += temp->extra[SUB_N]/(l[n].ry/2.0 + nc*model->pack.r_sub1_y); 
+      }
+      /* southern boundary - edge cell has half the ry	*/
+      if (i == nr-1) {
+          csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_sub1_y); 
+          wsum += temp->extra[SUB_S]/(l[n].ry/2.0 + nc*model->pack.r_sub1_y); 
+      }
+      /* eastern boundary	 - edge cell has half the rx	*/
+      if (j == nc-1) {
+          csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_sub1_x); 
+          wsum += temp->extra[SUB_E]/(l[n].rx/2.0 + nr*model->pack.r_sub1_x); 
+      }
+      /* western boundary	- edge cell has half the rx		*/
+      if (j == 0) {
+          csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_sub1_x); 
+          wsum += temp->extra[SUB_W]/(l[n].rx/2.0 + nr*model->pack.r_sub1_x); 
+      } 
+  } else if ((n==solderidx) && model->config.model_secondary) {
+      /* northern boundary - edge cell has half the ry	*/
+      if (i == 0) {
+          csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_solder1_y); 
+          wsum += temp->extra[SOLDER_N]/(l[n].ry/2.0 + nc*model->pack.r_solder1_y); 
+      }
+      /* southern boundary - edge cell has half the ry	*/
+      if (i == nr-1) {
+          csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_solder1_y); 
+          wsum += temp->extra[SOLDER_S]/(l[n].ry/2.0 + nc*model->pack.r_solder1_y); 
+      }
+      /* eastern boundary	 - edge cell has half the rx	*/
+      if (j == nc-1) {
+          csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_solder1_x); 
+          wsum += temp->extra[SOLDER_E]/(l[n].rx/2.0 + nr*model->pack.r_solder1_x); 
+      }
+      /* western boundary	- edge cell has half the rx		*/
+      if (j == 0) {
+          csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_solder1_x); 
+          wsum += temp->extra[SOLDER_W]/(l[n].rx/2.0 + nr*model->pack.r_solder1_x); 
+      } 
+  } else if ((n==pcbidx) && model->config.model_secondary) {
+      /* shortcuts for cell width(cw) and cell height(ch)	*/
+      double cw = model->width / model->cols;
+      double ch = model->height / model->rows;
+
+      /* all nodes are connected to the ambient	*/
+      csum += 1.0/(model->config.r_convec_sec * 
+                   (model->config.s_pcb * model->config.s_pcb) / (cw * ch));
+      wsum += ambient/(model->config.r_convec_sec * 
+                          (model->config.s_pcb * model->config.s_pcb) / (cw * ch));
+      /* northern boundary - edge cell has half the ry	*/
+      if (i == 0) {
+          csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_pcb1_y); 
+          wsum += temp->extra[PCB_C_N]/(l[n].ry/2.0 + nc*model->pack.r_pcb1_y); 
+      }
+      /* southern boundary - edge cell has half the ry	*/
+      if (i == nr-1) {
+          csum += 1.0/(l[n].ry/2.0 + nc*model->pack.r_pcb1_y); 
+          wsum += temp->extra[PCB_C_S]/(l[n].ry/2.0 + nc*model->pack.r_pcb1_y); 
+      }
+      /* eastern boundary	 - edge cell has half the rx	*/
+      if (j == nc-1) {
+          csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_pcb1_x); 
+          wsum += temp->extra[PCB_C_E]/(l[n].rx/2.0 + nr*model->pack.r_pcb1_x); 
+      }
+      /* western boundary	- edge cell has half the rx		*/
+      if (j == 0) {
+          csum += 1.0/(l[n].rx/2.0 + nr*model->pack.r_pcb1_x); 
+          wsum += temp->extra[PCB_C_W]/(l[n].rx/2.0 + nr*model->pack.r_pcb1_x); 
+      }
+  }
+
+  /* implicit transient step - C/h is in parallel
+   * with the other conductances. the matching C/h * T
+   * term is part of the power vector
+   */
+  if (model->implicit_h > 0) {
+      if (baked)
+        csum += 1.0 / (model->inv_c[k] * model->implicit_h);
+      else
+        csum += l[n].c / model->implicit_h;
+  }
+
+  *csum_out = csum;
+  *wsum_out = wsum;
+}
+
+/* steady state update of grid cell (n, i, j) from its neighbours.
+ * with 'omega' other than 1, the update is over-relaxed (SOR).
+ * returns the change in the cell's temperature
+ */
+static inline double update_cell_steady_grid(grid_model_t *model, grid_model_vector_t *power,
+                                             grid_model_vector_t *temp, int n, int i, int j,
+                                             int baked, double ambient, double omega)
+{
+  double prev, csum, wsum;
+  double ***v = temp->cuboid;
+
+  sum_cell_steady_grid(model, temp, n, i, j, baked, ambient, &csum, &wsum);
 
-              /* update the current cell's temperature	*/	   
-              prev = v[n][i][j];
-              v[n][i][j] = (power->cuboid[n][i][j] + wsum) / csum;
+  /* update the current cell's temperature	*/	   
+  prev = v[n][i][j];
+  v[n][i][j] = (power->cuboid[n][i][j] + wsum) / csum;
+  if (omega != 1.0)
+    v[n][i][j] = prev + omega * (v[n][i][j] - prev);
+
+  return fabs(prev - v[n][i][j]);
+}
+
+/* single steady state iteration of grid solver - silicon part.
+ * 'ambient' is the ambient temperature and 'omega' the over-relaxation
+ * factor of the rbsor solver (the others ignore it)
+ */
+double single_iteration_steady_grid(grid_model_t *model, grid_model_vector_t *power,
+                                    grid_model_vector_t *temp, double ambient, 
+                                    double omega)
+{
+  int n, i, j, color;
+  double delta, max = 0;
+  int baked = (model->level < model->n_levels);
+  int nl = model->n_layers;
+  int nr = model->rows;
+  int nc = model->cols;
 
-              /* compute maximum delta	*/
-              delta =  fabs(prev - v[n][i][j]);
+  if (model->steady_solver == GRID_SOLVER_RBSOR) {
+      /* red-black ordering - all the six neighbours of a cell
+       * are of the other colour. so, the cells of one colour
+       * can be updated in any order, in parallel
+       */
+      for(color=0; color < 2; color++) {
+#ifdef _OPENMP
+#pragma omp parallel for collapse(2) private(j, delta) reduction(max:max) \
+          schedule(static) if(nl*nr*nc >= RBSOR_PAR_CELLS)
+#endif
+          for(n=0; n < nl; n++)
+            for(i=0; i < nr; i++)
+              for(j=(n+i+color) % 2; j < nc; j+=2) {
+                  delta = update_cell_steady_grid(model, power, temp, n, i, j, 
+                                                  baked, ambient, omega);
+                  if (delta > max)
+                    max = delta;
+              }
+      }
+  } else {
+      /* for each grid cell	*/
+      for(n=0; n < nl; n++)
+        for(i=0; i < nr; i++)
+          for(j=0; j < nc; j++) {
+              delta = update_cell_steady_grid(model, power, temp, n, i, j, 
+                                              baked, ambient, 1.0);
               if (delta > max)
                 max = delta;
           }
-      }
   }
   /* package part of the iteration	*/
-  return (MAX(max, single_iteration_steady_pack(model, power, temp)));
+  return (MAX(max, single_iteration_steady_pack(model, power, temp, ambient)));
 }
 
 /* restriction operator for multigrid solver. given a power vector
@@ -2546,6 +3042,76 @@ void multigrid_prolong_temp(grid_model_t *model, grid_model_vector_t *dst,
     copy_dvector(dst->extra, src->extra, EXTRA+EXTRA_SEC);
 }
 
+/* make the grid one level coarser (half the no. of rows and 
+ * cols) for the multigrid solvers
+ */
+static void coarsen_grid(grid_model_t *model)
+{
+  int n;
+
+  model->rows /= 2;
+  model->cols /= 2;
+  use_level_grid(model, model->level + 1);
+  for(n=0; n < model->n_layers; n++) {
+      /* only rz's and c's change. rx's and 
+       * ry's remain the same	
+       */
+      model->layers[n].rz /= 4;
+      if (model->c_ready)
+        model->layers[n].c *= 4;
+  }
+}
+
+/* undo the above	*/
+static void refine_grid(grid_model_t *model)
+{
+  int n;
+
+  model->rows *= 2;
+  model->cols *= 2;
+  use_level_grid(model, model->level - 1);
+  for(n=0; n < model->n_layers; n++) {
+      model->layers[n].rz *= 4;
+      if (model->c_ready)
+        model->layers[n].c /= 4;
+  }
+}
+
+static void residual_steady_grid(grid_model_t *model, grid_model_vector_t *power,
+                                 grid_model_vector_t *temp, double ambient,
+                                 double *res, double *diag);
+static void vcycle_grid(grid_model_t *model, grid_model_vector_t *r, 
+                        grid_model_vector_t *e);
+
+/* iterate multigrid V-cycles from 'temp' till convergence. each 
+ * cycle solves for the error in 'temp' (the solution with the 
+ * residual as the power and the ambient at zero) approximately
+ * and corrects it. returns the no. of cycles
+ */
+static int multigrid_correct_grid(grid_model_t *model, grid_model_vector_t *power,
+                                  grid_model_vector_t *temp, double ambient)
+{
+  int i, cycles = 0;
+  double delta;
+  int extra_nodes = model->config.model_secondary ? EXTRA + EXTRA_SEC : EXTRA;
+  int size = model->n_layers * model->rows * model->cols + extra_nodes;
+  grid_model_vector_t *r = model->work[model->level].r;
+  grid_model_vector_t *e = model->work[model->level].e;
+
+  do {
+      residual_steady_grid(model, power, temp, ambient, r->cuboid[0][0], NULL);
+      vcycle_grid(model, r, e);
+      scaleadd_dvector(temp->cuboid[0][0], temp->cuboid[0][0], e->cuboid[0][0], size, 1.0);
+      for(i=0, delta=0; i < size; i++)
+        delta = MAX(delta, fabs(e->cuboid[0][0][i]));
+      cycles++;
+  } while (!eq(delta, 0) && cycles < MG_MAX_ITER);
+
+  if (!eq(delta, 0))
+    warning("multigrid steady state solver did not converge\n");
+  return cycles;
+}
+
 /* recursive multigrid solver. it uses the Gauss-Seidel (GS) iterative 
  * solver to solve at a particular grid granularity. Although GS removes
  * high frequency errors in a solution estimate pretty quickly, it 
@@ -2563,84 +3129,303 @@ void multigrid_prolong_temp(grid_model_t *model, grid_model_vector_t *dst,
  * (http://meweb.ecn.purdue.edu/~jmurthy/me608/main.pdf - pg. 175-192)
  */ 
 void recursive_multigrid(grid_model_t *model, grid_model_vector_t *power,
-                         grid_model_vector_t *temp)
+                         grid_model_vector_t *temp, double ambient)
 {
   double delta;
 #if VERBOSE > 1
   unsigned int i = 0;
 #endif
   grid_model_vector_t *coarse_power, *coarse_temp;
-  int n;
   /* setup heuristic initial temperatures	at the coarsest level*/
   if (model->rows <= 1 || model->cols <= 1) {
-      set_heuristic_temp(model, power, temp);
+      set_heuristic_temp(model, power, temp, ambient);
 
       /* for finer grids. use coarser solutions as estimates	*/
   } else {
       /* make the grid coarser	*/
-      model->rows /= 2;
-      model->cols /= 2;
-      for(n=0; n < model->n_layers; n++) {
-          /* only rz's and c's change. rx's and 
-           * ry's remain the same	
-           */
-          model->layers[n].rz /= 4;
-          if (model->c_ready)
-            model->layers[n].c *= 4;
-      }
+      coarsen_grid(model);
 
       /* vectors for the coarse grid	*/
-      coarse_power = new_grid_model_vector(model);
-      coarse_temp = new_grid_model_vector(model);
+      coarse_power = model->work[model->level].power;
+      coarse_temp = model->work[model->level].temp;
 
       /* coarsen the power vector	*/
       multigrid_restrict_power(model, coarse_power, power);
 
       /* solve recursively	*/
-      recursive_multigrid(model, coarse_power, coarse_temp);
+      recursive_multigrid(model, coarse_power, coarse_temp, ambient);
 
       /* interpolate the solution to the current fine grid	*/
       multigrid_prolong_temp(model, temp, coarse_temp);
 
-      /* cleanup	*/
-      free_grid_model_vector(coarse_power);
-      free_grid_model_vector(coarse_temp);
-
       /* restore the grid */
-      model->rows *= 2;
-      model->cols *= 2;
-      for(n=0; n < model->n_layers; n++) {
-          model->layers[n].rz *= 4;
-          if (model->c_ready)
-            model->layers[n].c /= 4;
-      }
+      refine_grid(model);
   }
-  /* refine solution iteratively till convergence	*/
-  do {
-      delta = single_iteration_steady_grid(model, power, temp);
+  /* refine solution iteratively till convergence. in the detailed 
+   * 3D mode, the heterogeneous R's slow down the convergence of GS
+   * a lot even from a good estimate. but the coarser levels are 
+   * aggregated from the per cell R's. so, V-cycles over them can
+   * correct the error instead
+   */
+  if (model->n_levels > 1 && model->rows > 1 && model->cols > 1) {
 #if VERBOSE > 1
-      i++;
+      i = multigrid_correct_grid(model, power, temp, ambient);
+#else
+      multigrid_correct_grid(model, power, temp, ambient);
 #endif
-  } while (!eq(delta, 0));
+  } else
+    do {
+        delta = single_iteration_steady_grid(model, power, temp, ambient, 
+                                             model->config.grid_sor_omega);
+#if VERBOSE > 1
+        i++;
+#endif
+    } while (!eq(delta, 0));
 #if VERBOSE > 1
   fprintf(stdout, "no. of iterations for steady state convergence (%d x %d grid): %d\n", 
           model->rows, model->cols, i);
 #endif
 }
 
-void steady_state_temp_grid(grid_model_t *model, double *power, double *temp)
+/* residual (power - G * temp) of the steady state equations at 
+ * 'temp' with G the conductance matrix (the ambient is part of the 
+ * power). the diagonal of G goes into 'diag' if it is not NULL. 
+ * both are 1-d arrays over all the grid cells and package nodes
+ */
+static void residual_steady_grid(grid_model_t *model, grid_model_vector_t *power,
+                                 grid_model_vector_t *temp, double ambient,
+                                 double *res, double *diag)
 {
-  grid_model_vector_t *p;
-  double total;
-  double delta;
+  int n, i, j, k;
+  double csum, wsum;
+  int baked = (model->level < model->n_levels);
+  int nl = model->n_layers;
+  int nr = model->rows;
+  int nc = model->cols;
+  double *t = temp->cuboid[0][0];
+  double *p = power->cuboid[0][0];
+
+  for(n=0, k=0; n < nl; n++)
+    for(i=0; i < nr; i++)
+      for(j=0; j < nc; j++, k++) {
+          sum_cell_steady_grid(model, temp, n, i, j, baked, ambient, &csum, &wsum);
+          res[k] = p[k] + wsum - csum * t[k];
+          if (diag)
+            diag[k] = csum;
+      }
+  steady_pack_grid(model, power, temp, ambient, res + nl*nr*nc, 
+                   diag ? diag + nl*nr*nc : NULL);
+}
+
+/* q = G * d for the iterative solvers below. 'zero' should be
+ * an all zero power vector
+ */
+static void matvec_steady_grid(grid_model_t *model, grid_model_vector_t *zero,
+                               grid_model_vector_t *d, grid_model_vector_t *q, int size)
+{
+  int i;
+  double *x = q->cuboid[0][0];
+
+  residual_steady_grid(model, zero, d, 0, x, NULL);
+  for(i=0; i < size; i++)
+    x[i] = -x[i];
+}
+
+/* multigrid V-cycle: an approximate solution 'e' of G * e = r 
+ * with the ambient at zero. a few Gauss-Seidel sweeps smooth out 
+ * the high frequency error and the low frequency error that remains 
+ * is corrected recursively on a coarser grid. unlike the nested 
+ * iteration of recursive_multigrid, it is a fixed amount of work. 
+ * it serves as the preconditioner of pcg_steady_grid and corrects 
+ * the estimates of recursive_multigrid in the detailed 3D mode. 
+ * with rbsor, the red-black sweeps are not over-relaxed - that 
+ * would spoil the smoothing
+ */
+static void vcycle_grid(grid_model_t *model, grid_model_vector_t *r, 
+                        grid_model_vector_t *e)
+{
+  int i;
+  grid_model_vector_t *res, *coarse_r, *coarse_e;
+  int extra_nodes = model->config.model_secondary ? EXTRA + EXTRA_SEC : EXTRA;
+  int size = model->n_layers * model->rows * model->cols + extra_nodes;
+
+  zero_dvector(e->cuboid[0][0], size);
+
+  /* coarsest level - just iterate	*/
+  if (model->rows <= 1 || model->cols <= 1) {
+      for(i=0; i < PCG_MG_COARSE_SWEEPS; i++)
+        single_iteration_steady_grid(model, r, e, 0, 1.0);
+      return;
+  }
+
+  /* pre-smoothing	*/
+  for(i=0; i < PCG_MG_SWEEPS; i++)
+    single_iteration_steady_grid(model, r, e, 0, 1.0);
+
+  /* solve for the correction on the coarser grid	*/
+  res = model->work[model->level].res;
+  residual_steady_grid(model, r, e, 0, res->cuboid[0][0], NULL);
+  coarsen_grid(model);
+  coarse_r = model->work[model->level].r;
+  coarse_e = model->work[model->level].e;
+  multigrid_restrict_power(model, coarse_r, res);
+  vcycle_grid(model, coarse_r, coarse_e);
+  /* interpolate it back to the current grid	*/
+  multigrid_prolong_temp(model, res, coarse_e);
+  refine_grid(model);
+  scaleadd_dvector(e->cuboid[0][0], e->cuboid[0][0], res->cuboid[0][0], size, 1.0);
+
+  /* post-smoothing	*/
+  for(i=0; i < PCG_MG_SWEEPS; i++)
+    single_iteration_steady_grid(model, r, e, 0, 1.0);
+}
+
+/* z = M^-1 * r for the preconditioner M	*/
+static void precond_steady_grid(grid_model_t *model, grid_model_vector_t *r, 
+                                grid_model_vector_t *z, double *diag, int size)
+{
+  int i;
+
+  if (model->pcg_precond == PCG_PRECOND_MG)
+    vcycle_grid(model, r, z);
+  else
+    for(i=0; i < size; i++)
+      z->cuboid[0][0][i] = r->cuboid[0][0][i] / diag[i];
+}
+
+/* max. change in temperature a Jacobi update would make given 
+ * the residual 'r'. the iterative solvers below stop when it is 
+ * below DELTA - the convergence criterion of the Gauss-Seidel 
+ * solver
+ */
+static double jacobi_delta(double *r, double *diag, int size)
+{
+  int i;
+  double max = 0;
+
+  for(i=0; i < size; i++)
+    if (fabs(r[i] / diag[i]) > max)
+      max = fabs(r[i] / diag[i]);
+  return max;
+}
+
+/* matrix-free preconditioned conjugate gradient (PCG) steady state
+ * solver. it applies the same stencil as the Gauss-Seidel solver.
+ * 'temp' holds the initial estimate. in the detailed 3D mode, G is 
+ * not always symmetric. then, it uses the preconditioned BiCGSTAB 
+ * method instead
+ */
+static void pcg_steady_grid(grid_model_t *model, grid_model_vector_t *power,
+                            grid_model_vector_t *temp)
+{
+  int iter;
+  double rz, rz_old, alpha, beta, omega, rho, rho_old, tt;
+  int extra_nodes = model->config.model_secondary ? EXTRA + EXTRA_SEC : EXTRA;
+  int size = model->n_layers * model->rows * model->cols + extra_nodes;
+  grid_model_vector_t *r, *z, *d, *q, *zero, *rhat, *s, *t, *y;
+  double *x = temp->cuboid[0][0];
+  double *diag = model->pcg_diag;
+
+  r = model->pcg_vectors[0];
+  z = model->pcg_vectors[1];
+  d = model->pcg_vectors[2];
+  q = model->pcg_vectors[3];
+  zero = model->pcg_vectors[4];
+  s = model->pcg_vectors[5];
+  rhat = model->pcg_vectors[6];
+  t = model->pcg_vectors[7];
+  y = model->pcg_vectors[8];
+  zero_dvector(zero->cuboid[0][0], size);
+
+  /* r = P - G * T	*/
+  residual_steady_grid(model, power, temp, model->config.ambient, 
+                       r->cuboid[0][0], diag);
+  /* the rest of the iterations solve G * dT = r. so, the
+   * ambient drops out of the equations
+   */
+
+  if (model->g_symmetric) {
+      /* z_old is needed for the Polak-Ribiere form of beta, which 
+       * tolerates the slight asymmetry of the V-cycle preconditioner
+       */
+      precond_steady_grid(model, r, z, diag, size);
+      copy_dvector(d->cuboid[0][0], z->cuboid[0][0], size);
+      rz = dot_dvector(r->cuboid[0][0], z->cuboid[0][0], size);
+      for(iter=0; iter < PCG_MAX_ITER && 
+          !eq(jacobi_delta(r->cuboid[0][0], diag, size), 0); iter++) {
+          matvec_steady_grid(model, zero, d, q, size);
+          alpha = rz / dot_dvector(d->cuboid[0][0], q->cuboid[0][0], size);
+          scaleadd_dvector(x, x, d->cuboid[0][0], size, alpha);
+          scaleadd_dvector(r->cuboid[0][0], r->cuboid[0][0], q->cuboid[0][0], size, -alpha);
+          copy_dvector(s->cuboid[0][0], z->cuboid[0][0], size);
+          precond_steady_grid(model, r, z, diag, size);
+          rz_old = rz;
+          rz = dot_dvector(r->cuboid[0][0], z->cuboid[0][0], size);
+          beta = (rz - dot_dvector(r->cuboid[0][0], s->cuboid[0][0], size)) / rz_old;
+          scaleadd_dvector(d->cuboid[0][0], z->cuboid[0][0], d->cuboid[0][0], size, beta);
+      }
+  } else {
+      copy_dvector(rhat->cuboid[0][0], r->cuboid[0][0], size);
+      zero_dvector(d->cuboid[0][0], size);
+      zero_dvector(q->cuboid[0][0], size);
+      rho_old = alpha = omega = 1.0;
+      for(iter=0; iter < PCG_MAX_ITER && 
+          !eq(jacobi_delta(r->cuboid[0][0], diag, size), 0); iter++) {
+          rho = dot_dvector(rhat->cuboid[0][0], r->cuboid[0][0], size);
+          /* breakdown - restart with the current residual	*/
+          if (rho == 0 || omega == 0) {
+              copy_dvector(rhat->cuboid[0][0], r->cuboid[0][0], size);
+              zero_dvector(d->cuboid[0][0], size);
+              zero_dvector(q->cuboid[0][0], size);
+              rho_old = alpha = omega = 1.0;
+              rho = dot_dvector(rhat->cuboid[0][0], r->cuboid[0][0], size);
+          }
+          /* d = r + beta * (d - omega * q)	*/
+          beta = (rho / rho_old) * (alpha / omega);
+          scaleadd_dvector(d->cuboid[0][0], d->cuboid[0][0], q->cuboid[0][0], size, -omega);
+          scaleadd_dvector(d->cuboid[0][0], r->cuboid[0][0], d->cuboid[0][0], size, beta);
+          precond_steady_grid(model, d, y, diag, size);
+          matvec_steady_grid(model, zero, y, q, size);
+          alpha = rho / dot_dvector(rhat->cuboid[0][0], q->cuboid[0][0], size);
+          /* half step: s = r - alpha * q	*/
+          scaleadd_dvector(x, x, y->cuboid[0][0], size, alpha);
+          scaleadd_dvector(s->cuboid[0][0], r->cuboid[0][0], q->cuboid[0][0], size, -alpha);
+          if (eq(jacobi_delta(s->cuboid[0][0], diag, size), 0)) {
+              copy_dvector(r->cuboid[0][0], s->cuboid[0][0], size);
+              break;
+          }
+          precond_steady_grid(model, s, z, diag, size);
+          matvec_steady_grid(model, zero, z, t, size);
+          tt = dot_dvector(t->cuboid[0][0], t->cuboid[0][0], size);
+          omega = (tt > 0) ? dot_dvector(t->cuboid[0][0], s->cuboid[0][0], size) / tt : 0;
+          scaleadd_dvector(x, x, z->cuboid[0][0], size, omega);
+          scaleadd_dvector(r->cuboid[0][0], s->cuboid[0][0], t->cuboid[0][0], size, -omega);
+          rho_old = rho;
+      }
+  }
+
+  if (iter >= PCG_MAX_ITER) {
+      if (model->implicit_h > 0)
+        warning("pcg implicit transient solver did not converge\n");
+      else
+        warning("pcg steady state solver did not converge\n");
+  }
 #if VERBOSE > 1
-  unsigned int i = 0;
+  fprintf(stdout, "no. of %s iterations for steady state convergence (%d x %d grid): %d\n", 
+          model->g_symmetric ? "pcg" : "bicgstab", model->rows, model->cols, iter);
 #endif
+}
+
+void steady_state_temp_grid(grid_model_t *model, double *power, double *temp)
+{
+  grid_model_vector_t *p, *dt;
+  double total;
+  int extra_nodes = model->config.model_secondary ? EXTRA + EXTRA_SEC : EXTRA;
 
   if (!model->r_ready)
     fatal("R model not ready\n");
 
-  p = new_grid_model_vector(model);
+  p = model->work[0].power;
 
   /* package nodes' power numbers	*/
   set_internal_power_grid(model, power);
@@ -2660,36 +3445,47 @@ void steady_state_temp_grid(grid_model_t *model, double *power, double *temp)
   /* solve recursively. use grid model's internal 
    * state vector to store the grid temperatures
    */ 
-  if(model->config.detailed_3D_used){
-      /* For detailed 3D, we do not use multi_grid */
-      set_heuristic_temp(model, p, model->last_steady);
-      do {
-          delta = single_iteration_steady_grid(model, p, model->last_steady);
-#if VERBOSE > 1
-          i++;
-#endif
-      } while (!eq(delta, 0));
-#if VERBOSE > 1
-      fprintf(stdout, "no. of iterations for steady state convergence (%d x %d grid): %d\n", 
-              model->rows, model->cols, i);
-#endif
+  if (model->steady_solver == GRID_SOLVER_PCG) {
+      /* start from the last solution if it is a good estimate	*/
+      if (!model->steady_warm)
+        set_heuristic_temp(model, p, model->last_steady, model->config.ambient);
+      pcg_steady_grid(model, p, model->last_steady);
+  } else if (model->steady_warm) {
+      /* the problem is linear. so, starting from the last 
+       * solution, only the change in temperature due to 
+       * the change in power remains to be solved for. it
+       * is the solution with the ambient at zero. the change 
+       * in power overwrites steady_power, which is updated below
+       */
+      dt = model->work[0].temp;
+      scaleadd_dvector(model->steady_power->cuboid[0][0], p->cuboid[0][0], 
+                       model->steady_power->cuboid[0][0],
+                       model->n_layers * model->rows * model->cols + extra_nodes, -1.0);
+      recursive_multigrid(model, model->steady_power, dt, 0);
+      scaleadd_dvector(model->last_steady->cuboid[0][0], model->last_steady->cuboid[0][0], 
+                       dt->cuboid[0][0], 
+                       model->n_layers * model->rows * model->cols + extra_nodes, 1.0);
   }
   else{
-      recursive_multigrid(model, p, model->last_steady);
+      recursive_multigrid(model, p, model->last_steady, model->config.ambient);
   }
+  /* remember the power for the next warm start	*/
+  copy_dvector(model->steady_power->cuboid[0][0], p->cuboid[0][0], 
+               model->n_layers * model->rows * model->cols + extra_nodes);
 #endif
 
   /* map the temperature numbers back	*/
   xlate_temp_g2b(model, temp, model->last_steady);
-
-  free_grid_model_vector(p);
 }
 
 /* function to access a 1-d array as a 3-d matrix	*/
 #define A3D(array,n,i,j,nl,nr,nc)		(array[(n)*(nr)*(nc) + (i)*(nc) + (j)])
 
-/* compute the slope vector for the package nodes	*/
-void slope_fn_pack(grid_model_t *model, double *v, grid_model_vector_t *p, double *dv)
+/* compute the slope vector for the package nodes with the
+ * ambient at temperature 'ambient'
+ */
+void slope_fn_pack(grid_model_t *model, double *v, grid_model_vector_t *p, double *dv,
+                   double ambient)
 {
   int i, j;
   /* sum of the currents(power values)	*/
@@ -2697,7 +3493,6 @@ void slope_fn_pack(grid_model_t *model, double *v, grid_model_vector_t *p, doubl
 
   /* shortcuts	*/
   package_RC_t *pk = &model->pack;
-  thermal_config_t *c = &model->config;
   layer_t *l = model->layers;
   int nl = model->n_layers;
   int nr = model->rows;
@@ -2717,18 +3512,18 @@ void slope_fn_pack(grid_model_t *model, double *v, grid_model_vector_t *p, doubl
   }
 
   /* sink outer north/south	*/
-  psum = (c->ambient - x[SINK_N])/(pk->r_hs_per + pk->r_amb_per) + 
+  psum = (ambient - x[SINK_N])/(pk->r_hs_per + pk->r_amb_per) + 
     (x[SINK_C_N] - x[SINK_N])/(pk->r_hs2_y + pk->r_hs);
   dv[nl*nr*nc + SINK_N] = psum / (pk->c_hs_per + pk->c_amb_per);
-  psum = (c->ambient - x[SINK_S])/(pk->r_hs_per + pk->r_amb_per) + 
+  psum = (ambient - x[SINK_S])/(pk->r_hs_per + pk->r_amb_per) + 
     (x[SINK_C_S] - x[SINK_S])/(pk->r_hs2_y + pk->r_hs);
   dv[nl*nr*nc + SINK_S] = psum / (pk->c_hs_per + pk->c_amb_per);
 
   /* sink outer west/east	*/
-  psum = (c->ambient - x[SINK_W])/(pk->r_hs_per + pk->r_amb_per) + 
+  psum = (ambient - x[SINK_W])/(pk->r_hs_per + pk->r_amb_per) + 
     (x[SINK_C_W] - x[SINK_W])/(pk->r_hs2_x + pk->r_hs);
   dv[nl*nr*nc + SINK_W] = psum / (pk->c_hs_per + pk->c_amb_per);
-  psum = (c->ambient - x[SINK_E])/(pk->r_hs_per + pk->r_amb_per) + 
+  psum = (ambient - x[SINK_E])/(pk->r_hs_per + pk->r_amb_per) + 
     (x[SINK_C_E] - x[SINK_E])/(pk->r_hs2_x + pk->r_hs);
   dv[nl*nr*nc + SINK_E] = psum / (pk->c_hs_per + pk->c_amb_per);
 
@@ -2738,7 +3533,7 @@ void slope_fn_pack(grid_model_t *model, double *v, grid_model_vector_t *p, doubl
   for(j=0; j < nc; j++)
     psum += (A3D(v,hsidx,0,j,nl,nr,nc) - x[SINK_C_N]);
   psum /= (l[hsidx].ry / 2.0 + nc * pk->r_hs1_y);
-  psum += (c->ambient - x[SINK_C_N])/(pk->r_hs_c_per_y + pk->r_amb_c_per_y) + 
+  psum += (ambient - x[SINK_C_N])/(pk->r_hs_c_per_y + pk->r_amb_c_per_y) + 
     (x[SP_N] - x[SINK_C_N])/pk->r_sp_per_y +
     (x[SINK_N] - x[SINK_C_N])/(pk->r_hs2_y + pk->r_hs);
   dv[nl*nr*nc + SINK_C_N] = psum / (pk->c_hs_c_per_y + pk->c_amb_c_per_y);
@@ -2747,7 +3542,7 @@ void slope_fn_pack(grid_model_t *model, double *v, grid_model_vector_t *p, doubl
   for(j=0; j < nc; j++)
     psum += (A3D(v,hsidx,nr-1,j,nl,nr,nc) - x[SINK_C_S]);
   psum /= (l[hsidx].ry / 2.0 + nc * pk->r_hs1_y);
-  psum += (c->ambient - x[SINK_C_S])/(pk->r_hs_c_per_y + pk->r_amb_c_per_y) + 
+  psum += (ambient - x[SINK_C_S])/(pk->r_hs_c_per_y + pk->r_amb_c_per_y) + 
     (x[SP_S] - x[SINK_C_S])/pk->r_sp_per_y +
     (x[SINK_S] - x[SINK_C_S])/(pk->r_hs2_y + pk->r_hs);
   dv[nl*nr*nc + SINK_C_S] = psum / (pk->c_hs_c_per_y + pk->c_amb_c_per_y);
@@ -2758,7 +3553,7 @@ void slope_fn_pack(grid_model_t *model, double *v, grid_model_vector_t *p, doubl
   for(i=0; i < nr; i++)
     psum += (A3D(v,hsidx,i,0,nl,nr,nc) - x[SINK_C_W]);
   psum /= (l[hsidx].rx / 2.0 + nr * pk->r_hs1_x);
-  psum += (c->ambient - x[SINK_C_W])/(pk->r_hs_c_per_x + pk->r_amb_c_per_x) + 
+  psum += (ambient - x[SINK_C_W])/(pk->r_hs_c_per_x + pk->r_amb_c_per_x) + 
     (x[SP_W] - x[SINK_C_W])/pk->r_sp_per_x +
     (x[SINK_W] - x[SINK_C_W])/(pk->r_hs2_x + pk->r_hs);
   dv[nl*nr*nc + SINK_C_W] = psum / (pk->c_hs_c_per_x + pk->c_amb_c_per_x);
@@ -2767,7 +3562,7 @@ void slope_fn_pack(grid_model_t *model, double *v, grid_model_vector_t *p, doubl
   for(i=0; i < nr; i++)
     psum += (A3D(v,hsidx,i,nc-1,nl,nr,nc) - x[SINK_C_E]);
   psum /= (l[hsidx].rx / 2.0 + nr * pk->r_hs1_x);
-  psum += (c->ambient - x[SINK_C_E])/(pk->r_hs_c_per_x + pk->r_amb_c_per_x) + 
+  psum += (ambient - x[SINK_C_E])/(pk->r_hs_c_per_x + pk->r_amb_c_per_x) + 
     (x[SP_E] - x[SINK_C_E])/pk->r_sp_per_x +
     (x[SINK_E] - x[SINK_C_E])/(pk->r_hs2_x + pk->r_hs);
   dv[nl*nr*nc + SINK_C_E] = psum / (pk->c_hs_c_per_x + pk->c_amb_c_per_x);
@@ -2806,18 +3601,18 @@ void slope_fn_pack(grid_model_t *model, double *v, grid_model_vector_t *p, doubl
 
   if (model_secondary) {
       /* PCB outer north/south	*/
-      psum = (c->ambient - x[PCB_N])/(pk->r_amb_sec_per) + 
+      psum = (ambient - x[PCB_N])/(pk->r_amb_sec_per) + 
         (x[PCB_C_N] - x[PCB_N])/(pk->r_pcb2_y + pk->r_pcb);
       dv[nl*nr*nc + PCB_N] = psum / (pk->c_pcb_per + pk->c_amb_sec_per);
-      psum = (c->ambient - x[PCB_S])/(pk->r_amb_sec_per) + 
+      psum = (ambient - x[PCB_S])/(pk->r_amb_sec_per) + 
         (x[PCB_C_S] - x[PCB_S])/(pk->r_pcb2_y + pk->r_pcb);
       dv[nl*nr*nc + PCB_S] = psum / (pk->c_pcb_per + pk->c_amb_sec_per);
 
       /* PCB outer west/east	*/
-      psum = (c->ambient - x[PCB_W])/(pk->r_amb_sec_per) + 
+      psum = (ambient - x[PCB_W])/(pk->r_amb_sec_per) + 
         (x[PCB_C_W] - x[PCB_W])/(pk->r_pcb2_x + pk->r_pcb);
       dv[nl*nr*nc + PCB_W] = psum / (pk->c_pcb_per + pk->c_amb_sec_per);
-      psum = (c->ambient - x[PCB_E])/(pk->r_amb_sec_per) + 
+      psum = (ambient - x[PCB_E])/(pk->r_amb_sec_per) + 
         (x[PCB_C_E] - x[PCB_E])/(pk->r_pcb2_x + pk->r_pcb);
       dv[nl*nr*nc + PCB_E] = psum / (pk->c_pcb_per + pk->c_amb_sec_per);
 
@@ -2827,7 +3622,7 @@ void slope_fn_pack(grid_model_t *model, double *v, grid_model_vector_t *p, doubl
       for(j=0; j < nc; j++)
         psum += (A3D(v,pcbidx,0,j,nl,nr,nc) - x[PCB_C_N]);
       psum /= (l[pcbidx].ry / 2.0 + nc * pk->r_pcb1_y);
-      psum += (c->ambient - x[PCB_C_N])/(pk->r_amb_sec_c_per_y) + 
+      psum += (ambient - x[PCB_C_N])/(pk->r_amb_sec_c_per_y) + 
         (x[SOLDER_N] - x[PCB_C_N])/pk->r_pcb_c_per_y +
         (x[PCB_N] - x[PCB_C_N])/(pk->r_pcb2_y + pk->r_pcb);
       dv[nl*nr*nc + PCB_C_N] = psum / (pk->c_pcb_c_per_y + pk->c_amb_sec_c_per_y);
@@ -2836,7 +3631,7 @@ void slope_fn_pack(grid_model_t *model, double *v, grid_model_vector_t *p, doubl
       for(j=0; j < nc; j++)
         psum += (A3D(v,pcbidx,nr-1,j,nl,nr,nc) - x[PCB_C_S]);
       psum /= (l[pcbidx].ry / 2.0 + nc * pk->r_pcb1_y);
-      psum += (c->ambient - x[PCB_C_S])/(pk->r_amb_sec_c_per_y) + 
+      psum += (ambient - x[PCB_C_S])/(pk->r_amb_sec_c_per_y) + 
         (x[SOLDER_S] - x[PCB_C_S])/pk->r_pcb_c_per_y +
         (x[PCB_S] - x[PCB_C_S])/(pk->r_pcb2_y + pk->r_pcb);
       dv[nl*nr*nc + PCB_C_S] = psum / (pk->c_pcb_c_per_y + pk->c_amb_sec_c_per_y);
@@ -2847,7 +3642,7 @@ void slope_fn_pack(grid_model_t *model, double *v, grid_model_vector_t *p, doubl
       for(i=0; i < nr; i++)
         psum += (A3D(v,pcbidx,i,0,nl,nr,nc) - x[PCB_C_W]);
       psum /= (l[pcbidx].rx / 2.0 + nr * pk->r_pcb1_x);
-      psum += (c->ambient - x[PCB_C_W])/(pk->r_amb_sec_c_per_x) + 
+      psum += (ambient - x[PCB_C_W])/(pk->r_amb_sec_c_per_x) + 
         (x[SOLDER_W] - x[PCB_C_W])/pk->r_pcb_c_per_x +
         (x[PCB_W] - x[PCB_C_W])/(pk->r_pcb2_x + pk->r_pcb);
       dv[nl*nr*nc + PCB_C_W] = psum / (pk->c_pcb_c_per_x + pk->c_amb_sec_c_per_x);
@@ -2856,7 +3651,7 @@ void slope_fn_pack(grid_model_t *model, double *v, grid_model_vector_t *p, doubl
       for(i=0; i < nr; i++)
         psum += (A3D(v,pcbidx,i,nc-1,nl,nr,nc) - x[PCB_C_E]);
       psum /= (l[pcbidx].rx / 2.0 + nr * pk->r_pcb1_x);
-      psum += (c->ambient - x[PCB_C_E])/(pk->r_amb_sec_c_per_x) + 
+      psum += (ambient - x[PCB_C_E])/(pk->r_amb_sec_c_per_x) + 
         (x[SOLDER_E] - x[PCB_C_E])/pk->r_pcb_c_per_x +
         (x[PCB_E] - x[PCB_C_E])/(pk->r_pcb2_x + pk->r_pcb);
       dv[nl*nr*nc + PCB_C_E] = psum / (pk->c_pcb_c_per_x + pk->c_amb_sec_c_per_x);
@@ -2927,46 +3722,116 @@ void slope_fn_pack(grid_model_t *model, double *v, grid_model_vector_t *p, doubl
   }
 }
 
-/* macros for calculating currents(power values)	*/
-/* current(power) from the next cell north. zero if on northern boundary	*/
-# define NP(l,v,n,i,j,nl,nr,nc)		((i > 0) ? ((A3D(v,n,i-1,j,nl,nr,nc)-A3D(v,n,i,j,nl,nr,nc))/l[n].ry) : 0.0)
-/* current(power) from the next cell south. zero if on southern boundary	*/
-# define SP(l,v,n,i,j,nl,nr,nc)		((i < nr-1) ? ((A3D(v,n,i+1,j,nl,nr,nc)-A3D(v,n,i,j,nl,nr,nc))/l[n].ry) : 0.0)
-/* current(power) from the next cell east. zero if on eastern boundary	*/
-# define EP(l,v,n,i,j,nl,nr,nc)		((j < nc-1) ? ((A3D(v,n,i,j+1,nl,nr,nc)-A3D(v,n,i,j,nl,nr,nc))/l[n].rx) : 0.0)
-/* current(power) from the next cell west. zero if on western boundary	*/
-# define WP(l,v,n,i,j,nl,nr,nc)		((j > 0) ? ((A3D(v,n,i,j-1,nl,nr,nc)-A3D(v,n,i,j,nl,nr,nc))/l[n].rx) : 0.0)
-/* current(power) from the next cell below. zero if on bottom face		*/
-# define BP(l,v,n,i,j,nl,nr,nc)		((n < nl-1) ? ((A3D(v,n+1,i,j,nl,nr,nc)-A3D(v,n,i,j,nl,nr,nc))/l[n].rz) : 0.0)
-/* current(power) from the next cell above. zero if on top face			*/
-# define AP(l,v,n,i,j,nl,nr,nc)		((n > 0) ? ((A3D(v,n-1,i,j,nl,nr,nc)-A3D(v,n,i,j,nl,nr,nc))/l[n-1].rz) : 0.0)
-
-//BU_3D: These are the same macros as above except that they have to check
-//for a resistivity value first since the lc model is not uniform across the layer
-/* current(power) from the next cell north. zero if on northern boundary	*/
-# define NP_det3D(l,v,n,i,j,nl,nr,nc)		((i > 0) ? ((A3D(v,n,i-1,j,nl,nr,nc)-A3D(v,n,i,j,nl,nr,nc))/find_res_3D(n, i-1, j, model,2)) : 0.0)
-/* current(power) from the next cell south. zero if on southern boundary	*/
-# define SP_det3D(l,v,n,i,j,nl,nr,nc)		((i < nr-1) ? ((A3D(v,n,i+1,j,nl,nr,nc)-A3D(v,n,i,j,nl,nr,nc))/find_res_3D(n, i+1, j, model,2)) : 0.0)
-/* current(power) from the next cell east. zero if on eastern boundary	*/
-# define EP_det3D(l,v,n,i,j,nl,nr,nc)		((j < nc-1) ? ((A3D(v,n,i,j+1,nl,nr,nc)-A3D(v,n,i,j,nl,nr,nc))/find_res_3D(n, i, j+1, model,1)) : 0.0)
-/* current(power) from the next cell west. zero if on western boundary	*/
-# define WP_det3D(l,v,n,i,j,nl,nr,nc)		((j > 0) ? ((A3D(v,n,i,j-1,nl,nr,nc)-A3D(v,n,i,j,nl,nr,nc))/find_res_3D(n, i, j-1, model,1)) : 0.0)
-/* current(power) from the next cell below. zero if on bottom face		*/
-# define BP_det3D(l,v,n,i,j,nl,nr,nc)		((n < nl-1) ? ((A3D(v,n+1,i,j,nl,nr,nc)-A3D(v,n,i,j,nl,nr,nc))/find_res_3D(n, i, j, model,3)) : 0.0)
-/* current(power) from the next cell above. zero if on top face			*/
-# define AP_det3D(l,v,n,i,j,nl,nr,nc)		((n > 0) ? ((A3D(v,n-1,i,j,nl,nr,nc)-A3D(v,n,i,j,nl,nr,nc))/find_res_3D(n-1, i, j, model,3)) : 0.0)
-//end->BU_3D
+/* compute the slope of one row (i) of the grid cells in layer n
+ * from the per cell conductances. the neighbours across the grid 
+ * boundaries are taken to be the cell itself - the conductances 
+ * to them are zero anyway. so, the inner cells of the row need no 
+ * branches and the loop over them vectorizes. the package nodes 
+ * are accounted for separately by slope_periphery_grid and 
+ * slope_ambient_grid
+ */
+static void slope_row_grid(grid_model_t *model, double *v, double *p, double *dv, 
+                           int n, int i)
+{
+  int j;
+  int nl = model->n_layers;
+  int nr = model->rows;
+  int nc = model->cols;
+  int k = (n * nr + i) * nc;
+
+  /* the current row and its neighbours	*/
+  double *t = v + k;
+  double *tn = (i > 0) ? t - nc : t;
+  double *ts = (i < nr-1) ? t + nc : t;
+  double *ta = (n > 0) ? t - nr*nc : t;
+  double *tb = (n < nl-1) ? t + nr*nc : t;
+  double *gn = model->g_n + k, *gs = model->g_s + k, *ge = model->g_e + k;
+  double *gw = model->g_w + k, *ga = model->g_a + k, *gb = model->g_b + k;
+  double *ic = model->inv_c + k;
+  double *q = p + k;
+  double *d = dv + k;
+
+/* power dissipated in cell j plus the currents from the cells
+ * north, south, above and below it
+ */
+#define NSAB_SUM(j)	(q[j] + gn[j] * (tn[j] - t[j]) + gs[j] * (ts[j] - t[j]) + \
+                     ga[j] * (ta[j] - t[j]) + gb[j] * (tb[j] - t[j]))
+
+  /* cells with neighbours both east and west	*/
+#pragma omp simd
+  for(j=1; j < nc-1; j++)
+    d[j] = (NSAB_SUM(j) + ge[j] * (t[j+1] - t[j]) + gw[j] * (t[j-1] - t[j])) * ic[j];
+
+  /* western and eastern boundaries	*/
+  if (nc > 1) {
+      d[0] = (NSAB_SUM(0) + ge[0] * (t[1] - t[0])) * ic[0];
+      d[nc-1] = (NSAB_SUM(nc-1) + gw[nc-1] * (t[nc-2] - t[nc-1])) * ic[nc-1];
+  } else
+    d[0] = NSAB_SUM(0) * ic[0];
+
+#undef NSAB_SUM
+}
+
+/* add the currents from the package nodes (xn, xs, xe and xw) 
+ * surrounding layer n to the slopes of its boundary cells. r_y 
+ * and r_x are the package resistances partitioned among the nc 
+ * and nr boundary cells. edge cells have half the ry/rx
+ */
+static void slope_periphery_grid(grid_model_t *model, double *v, double *dv, int n,
+                                 double xn, double xs, double xe, double xw, 
+                                 double r_y, double r_x)
+{
+  int i, j, k;
+  int nr = model->rows;
+  int nc = model->cols;
+  double ry = model->layers[n].ry / 2.0 + nc * r_y;
+  double rx = model->layers[n].rx / 2.0 + nr * r_x;
+  double *ic = model->inv_c;
+
+  /* northern and southern boundaries	*/
+  for(j=0; j < nc; j++) {
+      k = (n * nr) * nc + j;
+      dv[k] += (xn - v[k]) / ry * ic[k];
+      k = (n * nr + nr-1) * nc + j;
+      dv[k] += (xs - v[k]) / ry * ic[k];
+  }
+  /* eastern and western boundaries	*/
+  for(i=0; i < nr; i++) {
+      k = (n * nr + i) * nc + nc-1;
+      dv[k] += (xe - v[k]) / rx * ic[k];
+      k = (n * nr + i) * nc;
+      dv[k] += (xw - v[k]) / rx * ic[k];
+  }
+}
+
+/* add the current from the ambient (at temperature 'ambient') 
+ * through resistance r to the slopes of all the cells in layer n
+ */
+static void slope_ambient_grid(grid_model_t *model, double *v, double *dv, int n,
+                               double r, double ambient)
+{
+  int k;
+  int lo = n * model->rows * model->cols;
+  int hi = lo + model->rows * model->cols;
 
+#ifdef _OPENMP
+#pragma omp parallel for simd schedule(static) if(hi-lo >= SLOPE_PAR_CELLS)
+#else
+#pragma omp simd
+#endif
+  for(k=lo; k < hi; k++)
+    dv[k] += (ambient - v[k]) / r * model->inv_c[k];
+}
 
 /* compute the slope vector for the grid cells. the transient
  * equation is CdV + sum{(T - Ti)/Ri} = P 
- * so, slope = dV = [P + sum{(Ti-T)/Ri}]/C
+ * so, slope = dV = [P + sum{(Ti-T)/Ri}]/C. the ambient is
+ * at temperature 'ambient'
  */
-void slope_fn_grid(grid_model_t *model, double *v, grid_model_vector_t *p, double *dv)
+static void slope_ambient_fn_grid(grid_model_t *model, double *v, grid_model_vector_t *p, 
+                                  double *dv, double ambient)
 {
-  int n, i, j;
-  /* sum of the currents(power values)	*/
-  double psum;
+  int n, i, i0, i1;
 
   /* shortcuts for cell width(cw) and cell height(ch)	*/
   double cw = model->width / model->cols;
@@ -2974,132 +3839,71 @@ void slope_fn_grid(grid_model_t *model, double *v, grid_model_vector_t *p, doubl
 
   /* shortcuts	*/
   thermal_config_t *c = &model->config;
-  layer_t *l = model->layers;
+  package_RC_t *pk = &model->pack;
   int nl = model->n_layers;
   int nr = model->rows;
-  int nc = model->cols;
-  int spidx, hsidx, subidx, solderidx, pcbidx;
-  int model_secondary = model->config.model_secondary;
+  int spidx, hsidx;
 
   /* pointer to the starting address of the extra nodes	*/
-  double *x = v + nl*nr*nc;
+  double *x = v + nl*nr*model->cols;
 
   spidx = nl - DEFAULT_PACK_LAYERS + LAYER_SP;
   hsidx = nl - DEFAULT_PACK_LAYERS + LAYER_SINK;
-  if (model_secondary) {
-      subidx = LAYER_SUB;
-      solderidx = LAYER_SOLDER;
-      pcbidx = LAYER_PCB;	
+
+  /* currents between the grid cells. the rows are processed in
+   * tiles of SLOPE_TILE_ROWS through all the layers so that the 
+   * rows of a layer are still in the cache as the neighbours 
+   * above of the next layer. the tiles write disjoint parts of 
+   * dv. so, each thread of the OpenMP team takes a slab of them
+   */
+#ifdef _OPENMP
+#pragma omp parallel for private(n, i, i1) schedule(static) \
+  if(nl*nr*model->cols >= SLOPE_PAR_CELLS)
+#endif
+  for(i0=0; i0 < nr; i0 += SLOPE_TILE_ROWS) {
+      i1 = MIN(i0 + SLOPE_TILE_ROWS, nr);
+      for(n=0; n < nl; n++)
+        for(i=i0; i < i1; i++)
+          slope_row_grid(model, v, p->cuboid[0][0], dv, n, i);
   }
 
-  /* for each grid cell	*/
-  for(n=0; n < nl; n++)
-    for(i=0; i < nr; i++)
-      for(j=0; j < nc; j++) {
-          /* sum the currents(power values) to cells north, south, 
-           * east, west, above and below
-           */
-          // BU_3D: uses grid specific values for all layers 
-          // spreader and heat sink layers will use uniform R
-          if(model->config.detailed_3D_used == 1){
-              psum = NP_det3D(l,v,n,i,j,nl,nr,nc) + SP_det3D(l,v,n,i,j,nl,nr,nc) + 
-                EP_det3D(l,v,n,i,j,nl,nr,nc) + WP_det3D(l,v,n,i,j,nl,nr,nc) + 
-                AP_det3D(l,v,n,i,j,nl,nr,nc) + BP_det3D(l,v,n,i,j,nl,nr,nc);
-          }
-          else{
-              psum = NP(l,v,n,i,j,nl,nr,nc) + SP(l,v,n,i,j,nl,nr,nc) + 
-                EP(l,v,n,i,j,nl,nr,nc) + WP(l,v,n,i,j,nl,nr,nc) + 
-                AP(l,v,n,i,j,nl,nr,nc) + BP(l,v,n,i,j,nl,nr,nc);
-          }//end->BU_3D
-
-          /* spreader core is connected to its periphery	*/
-          if (n == spidx) {
-              /* northern boundary - edge cell has half the ry	*/
-              if (i == 0)
-                psum += (x[SP_N] - A3D(v,n,i,j,nl,nr,nc))/(l[n].ry/2.0 + nc*model->pack.r_sp1_y); 
-              /* southern boundary - edge cell has half the ry	*/
-              if (i == nr-1)
-                psum += (x[SP_S] - A3D(v,n,i,j,nl,nr,nc))/(l[n].ry/2.0 + nc*model->pack.r_sp1_y); 
-              /* eastern boundary	 - edge cell has half the rx	*/
-              if (j == nc-1)
-                psum += (x[SP_E] - A3D(v,n,i,j,nl,nr,nc))/(l[n].rx/2.0 + nr*model->pack.r_sp1_x); 
-              /* western boundary	 - edge cell has half the rx	*/
-              if (j == 0)
-                psum += (x[SP_W] - A3D(v,n,i,j,nl,nr,nc))/(l[n].rx/2.0 + nr*model->pack.r_sp1_x); 
-              /* heatsink core is connected to its inner periphery and ambient	*/
-          } else if (n == hsidx) {
-              /* all nodes are connected to the ambient	*/
-              psum += (c->ambient - A3D(v,n,i,j,nl,nr,nc))/l[n].rz;
-              /* northern boundary - edge cell has half the ry	*/
-              if (i == 0)
-                psum += (x[SINK_C_N] - A3D(v,n,i,j,nl,nr,nc))/(l[n].ry/2.0 + nc*model->pack.r_hs1_y); 
-              /* southern boundary - edge cell has half the ry	*/
-              if (i == nr-1)
-                psum += (x[SINK_C_S] - A3D(v,n,i,j,nl,nr,nc))/(l[n].ry/2.0 + nc*model->pack.r_hs1_y); 
-              /* eastern boundary	 - edge cell has half the rx	*/
-              if (j == nc-1)
-                psum += (x[SINK_C_E] - A3D(v,n,i,j,nl,nr,nc))/(l[n].rx/2.0 + nr*model->pack.r_hs1_x); 
-              /* western boundary	 - edge cell has half the rx	*/
-              if (j == 0)
-                psum += (x[SINK_C_W] - A3D(v,n,i,j,nl,nr,nc))/(l[n].rx/2.0 + nr*model->pack.r_hs1_x); 
-          }	else if (n == pcbidx && model_secondary) {
-              /* all nodes are connected to the ambient	*/
-              psum += (c->ambient - A3D(v,n,i,j,nl,nr,nc))/(model->config.r_convec_sec * 
-                                                            (model->config.s_pcb * model->config.s_pcb) / (cw * ch));
-              /* northern boundary - edge cell has half the ry	*/
-              if (i == 0)
-                psum += (x[PCB_C_N] - A3D(v,n,i,j,nl,nr,nc))/(l[n].ry/2.0 + nc*model->pack.r_pcb1_y); 
-              /* southern boundary - edge cell has half the ry	*/
-              if (i == nr-1)
-                psum += (x[PCB_C_S] - A3D(v,n,i,j,nl,nr,nc))/(l[n].ry/2.0 + nc*model->pack.r_pcb1_y); 
-              /* eastern boundary	 - edge cell has half the rx	*/
-              if (j == nc-1)
-                psum += (x[PCB_C_E] - A3D(v,n,i,j,nl,nr,nc))/(l[n].rx/2.0 + nr*model->pack.r_pcb1_x); 
-              /* western boundary	 - edge cell has half the rx	*/
-              if (j == 0)
-                psum += (x[PCB_C_W] - A3D(v,n,i,j,nl,nr,nc))/(l[n].rx/2.0 + nr*model->pack.r_pcb1_x); 
-          }	else if (n == subidx && model_secondary) {
-              /* northern boundary - edge cell has half the ry	*/
-              if (i == 0)
-                psum += (x[SUB_N] - A3D(v,n,i,j,nl,nr,nc))/(l[n].ry/2.0 + nc*model->pack.r_sub1_y); 
-              /* southern boundary - edge cell has half the ry	*/
-              if (i == nr-1)
-                psum += (x[SUB_S] - A3D(v,n,i,j,nl,nr,nc))/(l[n].ry/2.0 + nc*model->pack.r_sub1_y); 
-              /* eastern boundary	 - edge cell has half the rx	*/
-              if (j == nc-1)
-                psum += (x[SUB_E] - A3D(v,n,i,j,nl,nr,nc))/(l[n].rx/2.0 + nr*model->pack.r_sub1_x); 
-              /* western boundary	 - edge cell has half the rx	*/
-              if (j == 0)
-                psum += (x[SUB_W] - A3D(v,n,i,j,nl,nr,nc))/(l[n].rx/2.0 + nr*model->pack.r_sub1_x); 
-          }	else if (n == solderidx && model_secondary) {
-              /* northern boundary - edge cell has half the ry	*/
-              if (i == 0)
-                psum += (x[SOLDER_N] - A3D(v,n,i,j,nl,nr,nc))/(l[n].ry/2.0 + nc*model->pack.r_solder1_y); 
-              /* southern boundary - edge cell has half the ry	*/
-              if (i == nr-1)
-                psum += (x[SOLDER_S] - A3D(v,n,i,j,nl,nr,nc))/(l[n].ry/2.0 + nc*model->pack.r_solder1_y); 
-              /* eastern boundary	 - edge cell has half the rx	*/
-              if (j == nc-1)
-                psum += (x[SOLDER_E] - A3D(v,n,i,j,nl,nr,nc))/(l[n].rx/2.0 + nr*model->pack.r_solder1_x); 
-              /* western boundary	 - edge cell has half the rx	*/
-              if (j == 0)
-                psum += (x[SOLDER_W] - A3D(v,n,i,j,nl,nr,nc))/(l[n].rx/2.0 + nr*model->pack.r_solder1_x); 
-          }
+  /* spreader core is connected to its periphery	*/
+  slope_periphery_grid(model, v, dv, spidx, x[SP_N], x[SP_S], x[SP_E], x[SP_W],
+                       pk->r_sp1_y, pk->r_sp1_x);
+  /* heatsink core is connected to its inner periphery and ambient	*/
+  slope_ambient_grid(model, v, dv, hsidx, model->layers[hsidx].rz, ambient);
+  slope_periphery_grid(model, v, dv, hsidx, x[SINK_C_N], x[SINK_C_S], x[SINK_C_E], 
+                       x[SINK_C_W], pk->r_hs1_y, pk->r_hs1_x);
+  if (c->model_secondary) {
+      /* pcb core is connected to its inner periphery and ambient	*/
+      slope_ambient_grid(model, v, dv, LAYER_PCB, c->r_convec_sec * 
+                         (c->s_pcb * c->s_pcb) / (cw * ch), ambient);
+      slope_periphery_grid(model, v, dv, LAYER_PCB, x[PCB_C_N], x[PCB_C_S], 
+                           x[PCB_C_E], x[PCB_C_W], pk->r_pcb1_y, pk->r_pcb1_x);
+      /* package substrate and solder balls are connected to their peripheries	*/
+      slope_periphery_grid(model, v, dv, LAYER_SUB, x[SUB_N], x[SUB_S], x[SUB_E], 
+                           x[SUB_W], pk->r_sub1_y, pk->r_sub1_x);
+      slope_periphery_grid(model, v, dv, LAYER_SOLDER, x[SOLDER_N], x[SOLDER_S], 
+                           x[SOLDER_E], x[SOLDER_W], pk->r_solder1_y, pk->r_solder1_x);
+  }
 
-          /* update the current cell's temperature	*/	   
-          if(model->config.detailed_3D_used == 1)//BU_3D: use find_cap_3D is detailed_3D model is used.
-            A3D(dv,n,i,j,nl,nr,nc) = (p->cuboid[n][i][j] + psum) / find_cap_3D(n, i, j, model);
-          else
-            A3D(dv,n,i,j,nl,nr,nc) = (p->cuboid[n][i][j] + psum) / l[n].c;
-      }
-  /* for each grid cell	*/
-  slope_fn_pack(model, v, p, dv);
+  /* the package nodes	*/
+  slope_fn_pack(model, v, p, dv, ambient);
+}
+
+/* slope function of the rk4 solver (see slope_ambient_fn_grid). 'ws' 
+ * is its workspace (unused: no scratch needed)
+ */
+void slope_fn_grid(grid_model_t *model, double *v, grid_model_vector_t *p, double *dv,
+                   rk4_workspace_t *ws)
+{
+  slope_ambient_fn_grid(model, v, p, dv, model->config.ambient);
 }
 
 void compute_temp_grid(grid_model_t *model, double *power, double *temp, double time_elapsed)
 {
-  double t, h, new_h;
-  int extra_nodes;
+  double t, h, req_h, new_h;
+  int extra_nodes, k, n_steps;
   grid_model_vector_t *p;
 #if VERBOSE > 1
   unsigned int i = 0;
@@ -3113,7 +3917,7 @@ void compute_temp_grid(grid_model_t *model, double *power, double *temp, double
   if (!model->r_ready || !model->c_ready)
     fatal("grid model not ready\n");
 
-  p = new_grid_model_vector(model);
+  p = model->work[0].power;
 
   /* package nodes' power numbers	*/
   set_internal_power_grid(model, power);
@@ -3130,13 +3934,38 @@ void compute_temp_grid(grid_model_t *model, double *power, double *temp, double
       model->last_temp = temp;
   }
 
+  /* implicit solvers are unconditionally stable. so, they 
+   * cover the whole interval in a few equal steps
+   */
+  if (model->transient_method == TRANSIENT_ADI) {
+      n_steps = adi_n_steps_grid(model, time_elapsed);
+      for (k=0; k < n_steps; k++)
+        adi_step_grid(model, model->last_trans->cuboid[0][0], p, 
+                      time_elapsed / n_steps);
+      xlate_temp_g2b(model, model->last_temp, model->last_trans);
+      return;
+  }
+  if (model->transient_method != TRANSIENT_RK4) {
+      for (k=0; k < model->config.implicit_steps; k++)
+        implicit_step(model, model->last_trans->cuboid[0][0], p, 
+                      model->rows * model->cols * model->n_layers + extra_nodes, 
+                      time_elapsed / model->config.implicit_steps, 
+                      model->transient_method, 
+                      (implicit_fn_ptr) implicit_solve_grid, model->rk4_ws);
+      xlate_temp_g2b(model, model->last_temp, model->last_trans);
+      return;
+  }
+
   /* Obtain temp at time (t+time_elapsed). 
    * Instead of getting the temperature at t+time_elapsed directly, we
    * do it in multiple steps with the correct step size at each time 
-   * provided by rk4. 
+   * provided by rk4. the first step is the one rk4 suggested at the
+   * end of the previous call instead of MIN_STEP. if it is too large,
+   * rk4 shrinks it anyway
    */
-  for (t = 0, new_h = MIN_STEP; t < time_elapsed && new_h >= MIN_STEP*DELTA; t+=h) {
-      h = new_h;
+  for (t = 0, new_h = MIN(model->rk4_h, time_elapsed); 
+       t < time_elapsed && new_h >= MIN_STEP*DELTA; t+=h) {
+      h = req_h = new_h;
       /* pass the entire grid and the tail of package nodes 
        * as a 1-d array
        */
@@ -3145,7 +3974,14 @@ void compute_temp_grid(grid_model_t *model, double *power, double *temp, double
                   model->rows * model->cols * model->n_layers + extra_nodes, &h,
                   model->last_trans->cuboid[0][0], 
                   /* the slope function callback is typecast accordingly */
-                  (slope_fn_ptr) slope_fn_grid);
+                  (slope_fn_ptr) slope_fn_grid, model->rk4_ws);
+      /* remember the step size rk4 suggests for the next call. 
+       * if this step was clipped to the end of the interval and 
+       * taken as such, the suggestion only reflects the clipped 
+       * step. so, the carried one stays then
+       */
+      if (req_h >= model->rk4_h || h < req_h)
+        model->rk4_h = new_h;
       new_h = MIN(new_h, time_elapsed-t-h);
 #if VERBOSE > 1
       i++;
@@ -3158,8 +3994,288 @@ void compute_temp_grid(grid_model_t *model, double *power, double *temp, double
 
   /* map the temperature numbers back	*/
   xlate_temp_g2b(model, model->last_temp, model->last_trans);
+}
+
+/* restart rk4 from MIN_STEP - e.g. after a discontinuous change in power	*/
+void reset_transient_step_grid(grid_model_t *model)
+{
+  model->rk4_h = MIN_STEP;
+}
+
+#if SUPERLU < 1
+/* the fastest time constant C/G of the grid cells and the package
+ * nodes, G being the sum of a node's conductances - the diagonal 
+ * of the steady state equations. the pcg work vectors are free 
+ * to hold the trial vectors
+ */
+static void impl_probe_grid(grid_model_t *model)
+{
+  int k;
+  int nl = model->n_layers;
+  int nr = model->rows;
+  int nc = model->cols;
+  int extra_nodes = model->config.model_secondary ? EXTRA + EXTRA_SEC : EXTRA;
+  grid_model_vector_t *zero = model->pcg_vectors[0];
+  double *diag = model->pcg_diag;
+  double min;
+
+  zero_dvector(zero->cuboid[0][0], nl*nr*nc + extra_nodes);
+  residual_steady_grid(model, zero, zero, 0, model->pcg_vectors[1]->cuboid[0][0], diag);
+  min = 1.0 / (model->inv_c[0] * diag[0]);
+  for(k=1; k < nl*nr*nc; k++)
+    min = MIN(min, 1.0 / (model->inv_c[k] * diag[k]));
+  for(k=0; k < extra_nodes; k++)
+    min = MIN(min, model->pack_cap[k] / diag[nl*nr*nc+k]);
+  model->impl_tau = min;
+}
+#endif
+
+/* backward Euler solve used by the implicit transient solvers:
+ * (C/h + G) y1 = C/h * y0 + p. this is the steady state problem 
+ * with each capacitance turned into a conductance C/h to a node 
+ * at y0. so, the steady state solvers solve it - SuperLU with 
+ * its factors cached for the step size h or else pcg, starting 
+ * from y0, which is already close to y1 for small h
+ */
+void implicit_solve_grid(grid_model_t *model, double *y0, grid_model_vector_t *p, 
+                         double *y1, double h)
+{
+  int i, k;
+#if SUPERLU < 1
+  int precond;
+#endif
+
+  /* shortcuts	*/
+  int nl = model->n_layers;
+  int nr = model->rows;
+  int nc = model->cols;
+  int extra_nodes = model->config.model_secondary ? EXTRA + EXTRA_SEC : EXTRA;
+  double *x = y0 + nl*nr*nc;
+  grid_model_vector_t *q = model->impl_power;
+
+  /* power = p + C/h * y0	*/
+  for(k=0; k < nl*nr*nc; k++)
+    q->cuboid[0][0][k] = p->cuboid[0][0][k] + y0[k] / (model->inv_c[k] * h);
+  for(i=0; i < extra_nodes; i++)
+    q->extra[i] = model->pack_cap[i] / h * x[i];
+
+#if SUPERLU > 0
+  direct_impl_SLU(model, q, model->impl_temp, h);
+#else
+  /* 
+   * with h up to the fastest time constant, the C/h terms are 
+   * at least half the diagonal. then, Jacobi preconditioning 
+   * converges in a handful of iterations and costs much less 
+   * than a V-cycle. the longer steps need the model's own
+   */
+  if (model->impl_tau == 0)
+    impl_probe_grid(model);
+  precond = model->pcg_precond;
+  if (h <= model->impl_tau)
+    model->pcg_precond = PCG_PRECOND_JACOBI;
+  /* iterate from y0 till convergence	*/
+  copy_dvector(model->impl_temp->cuboid[0][0], y0, nl*nr*nc + extra_nodes);
+  model->implicit_h = h;
+  pcg_steady_grid(model, q, model->impl_temp);
+  model->implicit_h = 0;
+  model->pcg_precond = precond;
+#endif
 
-  free_grid_model_vector(p);
+  copy_dvector(y1, model->impl_temp->cuboid[0][0], nl*nr*nc + extra_nodes);
+}
+
+/* LU factorize the tridiagonal systems (I - h A) of the ADI solver
+ * along axis 'dir'. the lines of cells are 'len' long with a 
+ * stride of 'stride' between successive cells. there are 'stride'
+ * of them in each of the 'blocks' blocks of len*stride cells. 'glo'
+ * and 'gup' are the conductances to the previous and the next cells 
+ * on the line. 'gd', if not NULL, is added to the diagonal
+ */
+static void adi_factor_grid(grid_model_t *model, int dir, double *glo, double *gup,
+                            double *gd, int blocks, int len, int stride, double h)
+{
+  int b, t, q, k;
+  double a, c, d;
+  double *ic = model->inv_c;
+  double *am = model->adi_am[dir];
+  double *m = model->adi_m[dir];
+  double *cp = model->adi_cp[dir];
+
+  for(b=0; b < blocks; b++)
+    for(t=0; t < len; t++)
+      for(q=0; q < stride; q++) {
+          k = (b * len + t) * stride + q;
+          /* the cells at the ends of a line have no neighbour beyond	*/
+          a = (t > 0) ? -h * ic[k] * glo[k] : 0;
+          c = (t < len-1) ? -h * ic[k] * gup[k] : 0;
+          d = 1.0 - a - c;
+          if (gd)
+            d += h * gd[k];
+          if (t > 0)
+            d -= a * cp[k-stride];
+          m[k] = 1.0 / d;
+          am[k] = a * m[k];
+          cp[k] = c * m[k];
+      }
+}
+
+/* solve (I - h A) y = rhs in place for all the lines of cells along
+ * axis 'dir' (laid out as in adi_factor_grid). ADI_BATCH adjacent 
+ * lines are eliminated together so that the inner loops run over
+ * contiguous cells. the batches are independent. so, they are 
+ * split among the threads of an OpenMP team
+ */
+static void adi_lines_grid(grid_model_t *model, int dir, double *y, 
+                           int blocks, int len, int stride)
+{
+  int b, q0, q1, t, q, k;
+  double *am = model->adi_am[dir];
+  double *m = model->adi_m[dir];
+  double *cp = model->adi_cp[dir];
+
+#ifdef _OPENMP
+#pragma omp parallel for collapse(2) private(q1, t, q, k) schedule(static) \
+  if(blocks*len*stride >= SLOPE_PAR_CELLS)
+#endif
+  for(b=0; b < blocks; b++)
+    for(q0=0; q0 < stride; q0 += ADI_BATCH) {
+        q1 = MIN(q0 + ADI_BATCH, stride);
+        /* forward elimination	*/
+        k = b * len * stride;
+        for(q=q0; q < q1; q++)
+          y[k+q] *= m[k+q];
+        for(t=1; t < len; t++) {
+            k = (b * len + t) * stride;
+#pragma omp simd
+            for(q=q0; q < q1; q++)
+              y[k+q] = y[k+q] * m[k+q] - am[k+q] * y[k+q-stride];
+        }
+        /* back substitution	*/
+        for(t=len-2; t >= 0; t--) {
+            k = (b * len + t) * stride;
+#pragma omp simd
+            for(q=q0; q < q1; q++)
+              y[k+q] -= cp[k+q] * y[k+q+stride];
+        }
+    }
+}
+
+/* find the links of the cells and the package nodes that ADI
+ * treats as diagonal terms. the slopes are linear in the 
+ * temperatures. so, with the power and the ambient at zero, 
+ * the slope of a cell when all the cells are at 1 degree and the
+ * package nodes at 0 is due to its links to the package nodes and 
+ * the ambient alone. similarly for a package node at 1 degree with
+ * every other node at 0. the work vectors of level 0 other than 
+ * the power are free to hold the trial vectors
+ */
+static void adi_probe_grid(grid_model_t *model)
+{
+  int k;
+  int nl = model->n_layers;
+  int nr = model->rows;
+  int nc = model->cols;
+  int extra_nodes = model->config.model_secondary ? EXTRA + EXTRA_SEC : EXTRA;
+  double max = 0;
+  double *v = model->work[0].temp->cuboid[0][0];
+  double *dv = model->work[0].r->cuboid[0][0];
+  grid_model_vector_t *zero = model->work[0].res;
+
+  zero_dvector(zero->cuboid[0][0], nl*nr*nc + extra_nodes);
+  zero_dvector(v, nl*nr*nc + extra_nodes);
+  for(k=0; k < nl*nr*nc; k++)
+    v[k] = 1.0;
+  slope_ambient_fn_grid(model, v, zero, dv, 0);
+  for(k=0; k < nl*nr*nc; k++)
+    model->adi_gd[k] = -dv[k];
+
+  zero_dvector(v, nl*nr*nc);
+  for(k=0; k < extra_nodes; k++) {
+      v[nl*nr*nc+k] = 1.0;
+      slope_fn_pack(model, v, zero, dv, 0);
+      model->adi_pack_d[k] = -dv[nl*nr*nc+k];
+      v[nl*nr*nc+k] = 0;
+  }
+
+  /* the fastest time constant of the z systems	*/
+  for(k=0; k < nl*nr*nc; k++)
+    max = MAX(max, model->inv_c[k] * (model->g_a[k] + model->g_b[k]) + 
+              model->adi_gd[k]);
+  model->adi_tau = 1.0 / max;
+}
+
+/* set up the ADI solver for step size h	*/
+static void adi_setup_grid(grid_model_t *model, double h)
+{
+  int nl = model->n_layers;
+  int nr = model->rows;
+  int nc = model->cols;
+
+  if (model->adi_tau == 0)
+    adi_probe_grid(model);
+  adi_factor_grid(model, 0, model->g_w, model->g_e, NULL, nl*nr, nc, 1, h);
+  adi_factor_grid(model, 1, model->g_n, model->g_s, NULL, nl, nr, nc, h);
+  adi_factor_grid(model, 2, model->g_a, model->g_b, model->adi_gd, 1, nl, nr*nc, h);
+  model->adi_h = h;
+}
+
+/* a step of the alternating direction implicit (ADI) method of 
+ * Douglas (theta = 1) in its delta form. with the slope 
+ * f(T) = P/C + (A_x + A_y + A_z) T, the change in temperature dT
+ * over the step solves (I - h A_x)(I - h A_y)(I - h A_z) dT = h f(T).
+ * each factor is a set of independent tridiagonal systems - one
+ * per line of cells along its axis. so, a step costs O(n). the 
+ * amplification factor of every mode lies in [0,1]. hence, the 
+ * step size is not limited by stability (but by accuracy - see 
+ * adi_n_steps_grid). the links of the cells 
+ * to the package nodes and the ambient are part of A_z as diagonal
+ * terms. the package nodes are implicit only in their own diagonal
+ * (their links to the cells lag by a step)
+ */
+void adi_step_grid(grid_model_t *model, double *y, grid_model_vector_t *p, double h)
+{
+  int k;
+  int nl = model->n_layers;
+  int nr = model->rows;
+  int nc = model->cols;
+  int extra_nodes = model->config.model_secondary ? EXTRA + EXTRA_SEC : EXTRA;
+  double *d = model->rk4_ws->k1;
+
+  if (model->adi_h != h)
+    adi_setup_grid(model, h);
+
+  /* explicit increment	*/
+  slope_fn_grid(model, y, p, d, model->rk4_ws);
+  for(k=0; k < nl*nr*nc + extra_nodes; k++)
+    d[k] *= h;
+
+  /* implicit corrections along the rows, the columns and across the layers	*/
+  adi_lines_grid(model, 0, d, nl*nr, nc, 1);
+  adi_lines_grid(model, 1, d, nl, nr, nc);
+  adi_lines_grid(model, 2, d, 1, nl, nr*nc);
+  for(k=0; k < extra_nodes; k++)
+    d[nl*nr*nc+k] /= 1.0 + h * model->adi_pack_d[k];
+
+  scaleadd_dvector(y, y, d, nl*nr*nc + extra_nodes, 1.0);
+}
+
+/* no. of equal ADI steps over an interval of time_elapsed. though
+ * stable at any step size, ADI is accurate only as long as the step 
+ * is not much longer than the time constants of the vertical links
+ * of the cells. otherwise, the cross terms of the factors (e.g. 
+ * h^2 A_x A_z) dominate the step and the temperatures lag behind
+ * even backward Euler's. so, the steps are at most ADI_MAX_STEP_TAU 
+ * times the fastest of those time constants and at least 
+ * implicit_steps in number
+ */
+int adi_n_steps_grid(grid_model_t *model, double time_elapsed)
+{
+  double n;
+
+  if (model->adi_tau == 0)
+    adi_probe_grid(model);
+  n = ceil(time_elapsed / (ADI_MAX_STEP_TAU * model->adi_tau));
+  return MAX(model->config.implicit_steps, (int) n);
 }
 
 /* debug print	*/
@@ -4596,18 +5712,40 @@ SuperMatrix build_steady_rhs_vector(grid_model_t *model, grid_model_vector_t *po
   return B;
 }
 
-void direct_SLU(grid_model_t *model, grid_model_vector_t *power, grid_model_vector_t *temp)
+static void free_slu_factors(slu_factors_t *f)
 {
-  SuperMatrix A, L, U, B;
-  double   *rhs;
-  int      *perm_r; /* row permutations from partial pivoting */
-  int      *perm_c; /* column permutation vector */
+  if (!f->ready)
+    return;
+  SUPERLU_FREE (f->perm_r);
+  SUPERLU_FREE (f->perm_c);
+  Destroy_SuperNode_Matrix(&f->L);
+  Destroy_CompCol_Matrix(&f->U);
+  f->ready = FALSE;
+}
+
+void free_SLU_factors(grid_model_t *model)
+{
+  free_slu_factors(&model->slu);
+  free_slu_factors(&model->slu_impl);
+  model->slu_impl_h = 0;
+}
+
+/* solve A * T = B with SuperLU and copy the solution to 'temp'. 
+ * A is G if h is zero and (C/h + G) otherwise. it is factorized
+ * only if the factors 'f' are not ready. otherwise, only the
+ * forward and back substitutions are done with them
+ */
+static void solve_SLU(grid_model_t *model, slu_factors_t *f, SuperMatrix *B, 
+                      grid_model_vector_t *temp, double h)
+{
+  SuperMatrix A;
   int      info;
   superlu_options_t options;
   SuperLUStat_t stat;
 
-  int          i, dim;
-  DNformat     *Astore;
+  int          i, j, k, dim;
+  DNformat     *Bstore;
+  NCformat     *Astore;
   double       *dp;
 
   /* shortcuts	*/
@@ -4620,39 +5758,94 @@ void direct_SLU(grid_model_t *model, grid_model_vector_t *power, grid_model_vect
   else
     dim = nl*nr*nc + EXTRA;
 
-  A = build_steady_grid_matrix(model);
-  B = build_steady_rhs_vector(model, power, &rhs);
-
-  if ( !(perm_r = intMalloc(dim)) ) fatal("Malloc fails for perm_r[].\n");
-  if ( !(perm_c = intMalloc(dim)) ) fatal("Malloc fails for perm_c[].\n");
-
-  /* Set the default input options. */
-  set_default_options(&options);
-  options.ColPerm = MMD_AT_PLUS_A;
-  options.DiagPivotThresh = 0.01;
-  options.SymmetricMode = YES;
-  options.Equil = YES;
-
   /* Initialize the statistics variables. */
   StatInit(&stat);
 
-  /* Solve the linear system. */
-  dgssv(&options, &A, perm_c, perm_r, &L, &U, &B, &stat, &info);
+  if (!f->ready) {
+      A = build_steady_grid_matrix(model);
+      /* each capacitance is a conductance C/h in parallel	*/
+      if (h > 0) {
+          Astore = (NCformat *) A.Store;
+          for(j=0; j < dim; j++)
+            for(k=Astore->colptr[j]; k < Astore->colptr[j+1]; k++)
+              if (Astore->rowind[k] == j)
+                ((double *) Astore->nzval)[k] += (j < nl*nr*nc) ? 
+                  1.0 / (model->inv_c[j] * h) : model->pack_cap[j-nl*nr*nc] / h;
+      }
+
+      if ( !(f->perm_r = intMalloc(dim)) ) fatal("Malloc fails for perm_r[].\n");
+      if ( !(f->perm_c = intMalloc(dim)) ) fatal("Malloc fails for perm_c[].\n");
+
+      /* Set the default input options. */
+      set_default_options(&options);
+      options.ColPerm = MMD_AT_PLUS_A;
+      options.DiagPivotThresh = 0.01;
+      options.SymmetricMode = YES;
+      options.Equil = YES;
+
+      /* Factorize and solve the linear system. */
+      dgssv(&options, &A, f->perm_c, f->perm_r, &f->L, &f->U, B, &stat, &info);
+      Destroy_CompCol_Matrix(&A);
+      if (info)
+        fatal("SuperLU factorization of the conductance matrix failed\n");
+      f->ready = TRUE;
+  } else {
+      /* Solve with the cached factors. */
+      dgstrs(NOTRANS, &f->L, &f->U, f->perm_c, f->perm_r, B, &stat, &info);
+      if (info)
+        fatal("SuperLU solve with the cached factors failed\n");
+  }
 
-  Astore = (DNformat *) B.Store;
-  dp = (double *) Astore->nzval;
-  //copy results back to last_steady
+  Bstore = (DNformat *) B->Store;
+  dp = (double *) Bstore->nzval;
   for(i=0; i<dim; ++i){
-      model->last_steady->cuboid[0][0][i] = dp[i];
+      temp->cuboid[0][0][i] = dp[i];
+  }
+
+  StatFree(&stat);
+}
+
+/* solve G * T = P with SuperLU. G is factorized only the first 
+ * time (or after the R's change). the subsequent calls just do 
+ * the forward and back substitutions with the cached factors
+ */
+void direct_SLU(grid_model_t *model, grid_model_vector_t *power, grid_model_vector_t *temp)
+{
+  SuperMatrix B;
+  double   *rhs;
+
+  B = build_steady_rhs_vector(model, power, &rhs);
+  solve_SLU(model, &model->slu, &B, temp, 0);
+
+  SUPERLU_FREE (rhs);
+  Destroy_SuperMatrix_Store(&B);
+}
+
+/* solve (C/h + G) * T = P with SuperLU for the implicit transient
+ * solvers. power->extra holds the C/h * T terms of the package
+ * nodes. (C/h + G) is factorized again only when h changes (or
+ * the R's or C's do)
+ */
+void direct_impl_SLU(grid_model_t *model, grid_model_vector_t *power, 
+                     grid_model_vector_t *temp, double h)
+{
+  SuperMatrix B;
+  double   *rhs;
+  int      i;
+  int      extra_nodes = model->config.model_secondary ? EXTRA + EXTRA_SEC : EXTRA;
+  int      base_idx = model->n_layers * model->rows * model->cols;
+
+  if (model->slu_impl_h != h) {
+      free_slu_factors(&model->slu_impl);
+      model->slu_impl_h = h;
   }
 
+  B = build_steady_rhs_vector(model, power, &rhs);
+  for(i=0; i < extra_nodes; i++)
+    rhs[base_idx + i] += power->extra[i];
+  solve_SLU(model, &model->slu_impl, &B, temp, h);
+
   SUPERLU_FREE (rhs);
-  SUPERLU_FREE (perm_r);
-  SUPERLU_FREE (perm_c);
-  Destroy_CompCol_Matrix(&A);
   Destroy_SuperMatrix_Store(&B);
-  Destroy_SuperNode_Matrix(&L);
-  Destroy_CompCol_Matrix(&U);
-  StatFree(&stat);
 }
 #endif
@@ -56,6 +56,44 @@
    Effective only when the detailed 3D modeling is turned on. */
 #define OCCUPANCY_THRESHOLD 0.95
 
+/* red-black SOR sweeps over smaller grids (no. of cells)
+ * are not worth parallelizing (e.g. coarse multigrid levels)
+ */
+#define RBSOR_PAR_CELLS		4096
+
+/* multigrid V-cycle preconditioner of the pcg solver: Gauss-Seidel 
+ * sweeps before and after the coarse grid correction and at the 
+ * coarsest level
+ */
+#define PCG_MG_SWEEPS			2
+#define PCG_MG_COARSE_SWEEPS	50
+/* give up on the pcg solver after these many iterations	*/
+#define PCG_MAX_ITER			10000
+/* give up on the V-cycle corrections of the multigrid solver 
+ * after these many cycles (see multigrid_correct_grid)
+ */
+#define MG_MAX_ITER				1000
+/* no. of work vectors of the pcg/bicgstab solver	*/
+#define PCG_N_VECTORS			9
+
+/* no. of adjacent lines of cells the ADI transient solver 
+ * eliminates together (see adi_lines_grid)
+ */
+#define ADI_BATCH			64
+/* the ADI steps are at most these many times the fastest time 
+ * constant of the vertical links of the cells. beyond it, the 
+ * splitting error of those stiff links makes ADI lag behind
+ * (see adi_n_steps_grid)
+ */
+#define ADI_MAX_STEP_TAU	16
+
+/* no. of grid rows per tile of the transient slope computation	*/
+#define SLOPE_TILE_ROWS		8
+/* the tiles are computed in parallel (OpenMP) only for grids 
+ * larger than this (no. of cells)
+ */
+#define SLOPE_PAR_CELLS		4096
+
 /* block list: block to grid mapping data structure.
  * list of blocks mapped to a grid cell	
  */
@@ -129,6 +167,37 @@ typedef struct grid_model_vector_t_st
   double *extra;
 }grid_model_vector_t;
 
+/* per cell conductances and inverse capacitances of one 
+ * multigrid level (see grid_model_t)
+ */
+typedef struct grid_cells_t_st
+{
+  double *g_n, *g_s, *g_e, *g_w, *g_a, *g_b;
+  double *inv_c;
+}grid_cells_t;
+
+/* work vectors of the multigrid solvers at one level (see grid_model_t)	*/
+typedef struct grid_work_t_st
+{
+  /* power and temperature of the nested iteration	*/
+  grid_model_vector_t *power, *temp;
+  /* right hand side and solution of the V-cycles and
+   * the residual of the latter
+   */
+  grid_model_vector_t *r, *e, *res;
+}grid_work_t;
+
+#if SUPERLU > 0
+/* a cached SuperLU factorization (see grid_model_t)	*/
+typedef struct slu_factors_t_st
+{
+  int ready;
+  SuperMatrix L, U;
+  int *perm_r;	/* row permutations from partial pivoting	*/
+  int *perm_c;	/* column permutation vector	*/
+}slu_factors_t;
+#endif
+
 /* grid thermal model	*/
 typedef struct grid_model_t_st
 {
@@ -153,6 +222,10 @@ typedef struct grid_model_t_st
   int total_n_blocks;
   /* grid-to-block mapping mode	*/
   int map_mode;
+  /* steady state solver (GRID_SOLVER_*)	*/
+  int steady_solver;
+  /* and the preconditioner of pcg (PCG_PRECOND_*)	*/
+  int pcg_precond;
 
   /* flags	*/
   int r_ready;	/* are the R's initialized?	*/
@@ -163,6 +236,13 @@ typedef struct grid_model_t_st
    * steady state temperatures
    */
   grid_model_vector_t *last_steady;
+  /* and the power vector they correspond to	*/
+  grid_model_vector_t *steady_power;
+  /* start the next steady state solution from last_steady
+   * instead of from scratch? (e.g., in the temperature-leakage 
+   * loop, where successive solutions are close)
+   */
+  int steady_warm;
   /* internal state - most recently computed 
    * transient temperatures
    */
@@ -170,6 +250,112 @@ typedef struct grid_model_t_st
   grid_model_vector_t *last_trans;
   /* block temperatures	*/
   double *last_temp;
+  /* last step size suggested by rk4. the next call
+   * to compute_temp_grid resumes from it
+   */
+  double rk4_h;
+  /* scratch space of rk4	*/
+  rk4_workspace_t *rk4_ws;
+
+  /* transient solver (TRANSIENT_*)	*/
+  int transient_method;
+  /* implicit solvers: the steady state solvers solve 
+   * (C/implicit_h + G) T = P instead of G T = P when 
+   * implicit_h is non-zero
+   */
+  double implicit_h;
+  /* fastest time constant C/G of the cells and the package nodes
+   * (0 if stale). pcg solves the implicit steps up to it with the 
+   * Jacobi preconditioner (see implicit_solve_grid)
+   */
+  double impl_tau;
+  /* capacitances of the package nodes	*/
+  double pack_cap[EXTRA+EXTRA_SEC];
+  /* scratch power and temperature vectors	*/
+  grid_model_vector_t *impl_power, *impl_temp;
+  /* alternating direction implicit (ADI) solver: the systems 
+   * (I - h A) of the couplings along x, y and z (indices 0-2)
+   * are tridiagonal along every line of cells. their LU factors
+   * for the step size adi_h (0 if stale) - with the sub, main and 
+   * super diagonals a, b and c, m is the inverse of the pivot,
+   * am = a * m and cp = c * m. indexed like the 1-d view of a 
+   * grid_model_vector
+   */
+  double adi_h;
+  double *adi_am[3], *adi_m[3], *adi_cp[3];
+  /* conductances (times the inverse capacitances) of the cells to
+   * the package nodes and the ambient. they are part of the z 
+   * systems. adi_pack_d is the same for the package nodes' links 
+   * to all their neighbours. adi_tau is the fastest time constant
+   * of the z systems. all three are valid if adi_tau is non-zero
+   */
+  double *adi_gd;
+  double adi_pack_d[EXTRA+EXTRA_SEC];
+  double adi_tau;
+
+  /* per cell conductances to the cells north, south, east, west,
+   * above and below (zero at the boundaries) and the inverse of 
+   * the cell capacitances as flat arrays indexed like the 1-d view 
+   * of a grid_model_vector. they are baked for the full resolution 
+   * grid when the R's and C's are populated so that the stencil 
+   * loops need not look them up (e.g. in the b2gmap in the detailed 
+   * 3D mode). the coarser multigrid levels use the per layer values
+   */
+  double *g_n, *g_s, *g_e, *g_w, *g_a, *g_b;
+  double *inv_c;
+  /* is the conductance matrix symmetric? (in the detailed 3D 
+   * mode, a cell's conductance to its neighbour depends on the
+   * neighbour's R. so, the two directions can differ)
+   */
+  int g_symmetric;
+  /* the above for every multigrid level (level 0 is the full 
+   * resolution grid). in the detailed 3D mode, the coarser levels
+   * are aggregated from the finer ones so that the multigrid 
+   * solvers see the heterogeneous R's and C's. otherwise, they 
+   * use the per layer values and there is only level 0. the 
+   * arrays above point to those of the current level
+   */
+  grid_cells_t *levels;
+  int n_levels;
+  int level;
+  /* work vectors of the solvers at every multigrid level down 
+   * to the coarsest one (a single row or column) indexed by
+   * 'level'. they are allocated along with the model so that
+   * repeated steady state and transient solutions allocate 
+   * nothing. work[0].power is the grid power vector of the 
+   * main interfaces
+   */
+  grid_work_t *work;
+  int n_work;
+  /* work vectors of the pcg solver (GRID_SOLVER_PCG and the 
+   * implicit transient solvers only)
+   */
+  grid_model_vector_t *pcg_vectors[PCG_N_VECTORS];
+  double *pcg_diag;
+
+#if SUPERLU > 0
+  /* SuperLU factorization of the steady state conductance matrix. 
+   * it depends only on the R's. so, it is computed by the first 
+   * steady state solution and reused by the rest (only the right
+   * hand side changes) until the R's are populated again
+   */
+  slu_factors_t slu;
+  /* that of (C/h + G) for the implicit transient solvers. it is
+   * reused while the step size stays slu_impl_h and the R's and
+   * C's stay the same
+   */
+  slu_factors_t slu_impl;
+  double slu_impl_h;
+#endif
+
+  /* the block-grid maps of all the layers as sparse matrices
+   * so that translating between block and grid vectors is a
+   * matrix-vector product. b2g_power and b2g_temp have a row
+   * per grid cell (1-d view of a grid_model_vector) and a column
+   * per block. g2b is the other way round. it exists only for 
+   * the mapping modes that are linear (GRID_AVG and GRID_CENTER)
+   */
+  sparse_matrix_t *b2g_power, *b2g_temp, *g2b;
 
   /* to allow for resizing	*/
   int base_n_units;
@@ -190,6 +376,15 @@ void populate_C_model_grid(grid_model_t *model, flp_t *flp);
 /* hotspot main interfaces - temperature.c	*/
 void steady_state_temp_grid(grid_model_t *model, double *power, double *temp);
 void compute_temp_grid(grid_model_t *model, double *power, double *temp, double time_elapsed);
+/* restart rk4 from MIN_STEP - e.g. after a discontinuous change in power	*/
+void reset_transient_step_grid(grid_model_t *model);
+/* backward Euler solve of the implicit transient solvers	*/
+void implicit_solve_grid(grid_model_t *model, double *y0, grid_model_vector_t *p, 
+                         double *y1, double h);
+/* a step of size h of the alternating direction implicit solver	*/
+void adi_step_grid(grid_model_t *model, double *y, grid_model_vector_t *p, double h);
+/* no. of equal steps of the ADI solver over an interval	*/
+int adi_n_steps_grid(grid_model_t *model, double time_elapsed);
 
 /* differs from 'dvector()' in that memory for internal nodes is also allocated	*/
 double *hotspot_vector_grid(grid_model_t *model);
@@ -206,6 +401,10 @@ void dump_top_layer_temp_grid(grid_model_t *model, char *file, grid_model_vector
 void dump_steady_temp_grid (grid_model_t *model, char *file);
 void dump_temp_grid (grid_model_t *model, double *temp, char *file);
 void copy_temp_grid (grid_model_t *model, double *dst, double *src);
+/* snapshot and restore of the transient state	*/
+int thermal_state_size_grid(grid_model_t *model);
+void save_thermal_state_grid(grid_model_t *model, double *temp, double *state);
+void restore_thermal_state_grid(grid_model_t *model, double *temp, double *state);
 void read_temp_grid (grid_model_t *model, double *temp, char *file, int clip);
 void dump_power_grid(grid_model_t *model, double *power, char *file);
 void read_power_grid (grid_model_t *model, double *power, char *file);
@@ -228,6 +427,11 @@ void debug_print_grid(grid_model_t *model);
 #if SUPERLU > 0
 /* steady-state solver */
 void direct_SLU(grid_model_t *model, grid_model_vector_t *power, grid_model_vector_t *temp);
+/* the above for the implicit transient solvers' (C/h + G)	*/
+void direct_impl_SLU(grid_model_t *model, grid_model_vector_t *power, 
+                     grid_model_vector_t *temp, double h);
+/* discard the cached factorizations of the above	*/
+void free_SLU_factors(grid_model_t *model);
 SuperMatrix build_steady_grid_matrix(grid_model_t *model);
 SuperMatrix build_steady_rhs_vector(grid_model_t *model, grid_model_vector_t *power, double **rhs);
 #endif
@@ -322,7 +322,7 @@ int read_str_pairs(str_pair *table, int max_entries, char *file)
 	int i=0;
 	char str[LINE_SIZE], copy[LINE_SIZE];
 	char name[STR_SIZE];
-	char *ptr;
+	char *ptr, *save;
 	FILE *fp = fopen (file, "r");
 	if (!fp) {
 		sprintf (str,"error: %s could not be opened for reading\n", file);
@@ -335,7 +335,7 @@ int read_str_pairs(str_pair *table, int max_entries, char *file)
 		strcpy(copy, str);
 
 		/* ignore comments and empty lines  */
-		ptr = strtok(str, " \r\t\n");
+		ptr = strtok_r(str, " \r\t\n", &save);
 		if (!ptr || ptr[0] == '#') 
 			continue;
 
@@ -515,7 +515,7 @@ unsigned int ones8(register unsigned char n)
  */
 int count_significant_lines(FILE *fp)
 {
-    char str[LINE_SIZE], *ptr;
+    char str[LINE_SIZE], *ptr, *save;
     int count = 0;
 
 	fseek(fp, 0, SEEK_SET);
@@ -525,7 +525,7 @@ int count_significant_lines(FILE *fp)
 			break;
 
 		/* ignore comments and empty lines	*/
-		ptr = strtok(str, " \r\t\n");
+		ptr = strtok_r(str, " \r\t\n", &save);
 		if (!ptr || ptr[0] == '#')
 			continue;
 